@@ -0,0 +1,102 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  main.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Entry point for the offline benchmark harness.
+
+// Local headers
+#include "photomosaicBenchmark.h"
+
+// Standard C++ headers
+#include <iostream>
+#include <sstream>
+#include <cstring>
+
+// wxWidgets headers
+#include <wx/app.h>
+
+void PrintUsage(const char* name)
+{
+	std::cout << "Usage:  " << name << " [--seed <n>] [--sizes <n>[,<n>...]] [--tiles <columns>x<rows>] [--files <n>] [--directory <path>]\n"
+		<< "  --seed       Seed for the synthetic corpus (default 1)\n"
+		<< "  --sizes      Library sizes for the scoring benchmarks (default 1000,10000,100000)\n"
+		<< "  --tiles      Mosaic dimensions, in tiles (default 48x32)\n"
+		<< "  --files      Number of images to write for the decode and end-to-end benchmarks (default 1000)\n"
+		<< "  --directory  Scratch directory for generated files (removed when complete)" << std::endl;
+}
+
+bool ParseArguments(int argc, char *argv[], PhotomosaicBenchmark::Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (i + 1 == argc)
+			return false;
+
+		std::istringstream value(argv[++i]);
+		if (strcmp(argv[i - 1], "--seed") == 0)
+			value >> options.seed;
+		else if (strcmp(argv[i - 1], "--sizes") == 0)
+		{
+			options.librarySizes.clear();
+			unsigned int size;
+			while (value >> size)
+			{
+				options.librarySizes.push_back(size);
+				if (value.peek() == ',')
+					value.ignore();
+			}
+
+			if (options.librarySizes.empty() || !value.eof())
+				return false;
+			value.clear();
+		}
+		else if (strcmp(argv[i - 1], "--tiles") == 0)
+		{
+			char separator;
+			value >> options.tileColumns >> separator >> options.tileRows;
+			if (separator != 'x' || options.tileColumns == 0 || options.tileRows == 0)
+				return false;
+		}
+		else if (strcmp(argv[i - 1], "--files") == 0)
+			value >> options.fileCount;
+		else if (strcmp(argv[i - 1], "--directory") == 0)
+			options.workingDirectory = argv[i];
+		else
+			return false;
+
+		if (value.fail())
+			return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (!wxInitialize())
+		return 1;
+
+	PhotomosaicBenchmark::Options options;
+	options.workingDirectory = (stdfs::temp_directory_path() / "photomosaicBenchmark").generic_string();
+	if (!ParseArguments(argc, argv, options))
+	{
+		PrintUsage(argv[0]);
+		wxUninitialize();
+		return 1;
+	}
+
+	wxInitAllImageHandlers();
+
+	PhotomosaicBenchmark benchmark(options);
+	const bool passed(benchmark.Run());
+
+	wxUninitialize();
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,957 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  photomosaicBenchmark.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Offline benchmarks for each stage of mosaic construction, using a synthetic corpus.
+
+// Local headers
+#include "photomosaicBenchmark.h"
+
+// Standard C++ headers
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <set>
+
+namespace
+{
+
+// Photomosaic reports its progress as it goes; that isn't wanted in the middle of the benchmark table
+class QuietOutput
+{
+public:
+	QuietOutput() : original(std::cout.rdbuf(nullptr)) {}
+	~QuietOutput() { std::cout.rdbuf(original); }
+
+private:
+	std::streambuf* const original;
+};
+
+}
+
+PhotomosaicBenchmark::PhotomosaicBenchmark(const Options& options) : options(options), corpus(options.seed)
+{
+}
+
+bool PhotomosaicBenchmark::Run()
+{
+	std::cout << "Seed " << options.seed << ", " << options.tileColumns << "x" << options.tileRows << " tiles, "
+		<< options.subSamples * options.subSamples << " samples per tile, " << Executor::GetShared().GetThreadCount() << " threads\n\n";
+	std::cout << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(10) << "Size"
+		<< std::setw(12) << "Time (s)" << "  Throughput" << std::endl;
+
+	BenchmarkColorInformation();
+	BenchmarkThumbnailScaling();
+	for (const auto& size : options.librarySizes)
+		BenchmarkScoring(size);
+	BenchmarkCascade(options.librarySizes.back());
+	BenchmarkQuantized(options.librarySizes.back());
+	BenchmarkEuclidean(options.librarySizes.back());
+	BenchmarkDuplicateSearch(options.librarySizes.back());
+	BenchmarkComposition();
+
+	const stdfs::path libraryDirectory(stdfs::path(options.workingDirectory) / "library");
+	std::error_code errorCode;
+	stdfs::remove_all(options.workingDirectory, errorCode);
+	if (!stdfs::create_directories(libraryDirectory, errorCode))
+	{
+		std::cerr << "Failed to create '" << libraryDirectory.generic_string() << "'" << std::endl;
+		return false;
+	}
+
+	if (Check(corpus.WriteLibrary(libraryDirectory.generic_string(), options.fileCount, 320, 240), "write synthetic library"))
+	{
+		BenchmarkDecode(libraryDirectory.generic_string());
+		BenchmarkEndToEnd(libraryDirectory.generic_string());
+	}
+
+	stdfs::remove_all(options.workingDirectory, errorCode);
+
+	if (failureCount > 0)
+	{
+		std::cout << '\n' << failureCount << " check(s) failed" << std::endl;
+		return false;
+	}
+
+	std::cout << "\nAll checks passed" << std::endl;
+	return true;
+}
+
+PhotomosaicConfig PhotomosaicBenchmark::GetConfig() const
+{
+	PhotomosaicConfig config;
+	config.thumbnailSize = options.thumbnailSize;
+	config.subDivisionSize = 20;
+	config.subSamples = options.subSamples;
+	config.candidateCount = options.candidateCount;
+	config.hueErrorWeight = 1.0;
+	config.saturationErrorWeight = 1.0;
+	config.valueErrorWeight = 1.0;
+	config.distancePenaltyCountThreshold = 0;
+	config.distancePenaltyScale = 0.0;
+	config.distancePenaltyRadius = 8;
+	config.distancePenaltyIterations = 20;
+	return config;
+}
+
+void PhotomosaicBenchmark::BenchmarkColorInformation()
+{
+	const unsigned int imageCount(2000);
+	std::vector<wxImage> images(imageCount);
+	for (auto& image : images)
+		image = corpus.MakeImage(options.thumbnailSize, options.thumbnailSize);
+
+	const double megapixels(static_cast<double>(imageCount) * options.thumbnailSize * options.thumbnailSize * 1.0e-6);
+	std::vector<InfoGrid> fast(imageCount), reference(imageCount);
+	const double fastTime(Time([&]()
+	{
+		for (unsigned int i = 0; i < imageCount; ++i)
+			fast[i] = Photomosaic::GetColorInformation(images[i], options.subSamples);
+	}));
+	Report("GetColorInformation", imageCount, fastTime, megapixels, "MP/s");
+
+	const double referenceTime(Time([&]()
+	{
+		for (unsigned int i = 0; i < imageCount; ++i)
+			reference[i] = Photomosaic::GetColorInformationReference(images[i], options.subSamples);
+	}));
+	Report("GetColorInformation (reference)", imageCount, referenceTime, megapixels, "MP/s");
+
+	double maxError(0.0);
+	for (unsigned int i = 0; i < imageCount; ++i)
+	{
+		for (unsigned int x = 0; x < options.subSamples; ++x)
+		{
+			for (unsigned int y = 0; y < options.subSamples; ++y)
+			{
+				const double hueError(std::abs(fast[i][x][y].hue - reference[i][x][y].hue));
+				maxError = std::max(maxError, std::min(hueError, 1.0 - hueError));// Hue wraps around
+				maxError = std::max(maxError, std::abs(fast[i][x][y].saturation - reference[i][x][y].saturation));
+				maxError = std::max(maxError, std::abs(fast[i][x][y].value - reference[i][x][y].value));
+			}
+		}
+	}
+
+	std::ostringstream description;
+	description << "color information matches reference (max error " << maxError << ")";
+	Check(maxError < 1.0e-9, description.str());
+}
+
+// Landscape images, center cropped, as for a typical library
+void PhotomosaicBenchmark::BenchmarkThumbnailScaling()
+{
+	const unsigned int imageCount(100);
+	const unsigned int width(800), height(600);
+	const unsigned int left((width - height) / 2);
+	const unsigned int size(options.thumbnailSize);
+	std::vector<wxImage> images(imageCount);
+	for (auto& image : images)
+		image = corpus.MakeImage(width, height);
+
+	const double megapixels(static_cast<double>(imageCount) * height * height * 1.0e-6);
+	const size_t thumbnailBytes(static_cast<size_t>(size) * size * 3);
+	const std::pair<ThumbnailScaler::Filter, std::string> filters[] = {
+		std::make_pair(ThumbnailScaler::Filter::Area, std::string("area")), std::make_pair(ThumbnailScaler::Filter::Box, std::string("box")) };
+	for (const auto& filter : filters)
+	{
+		std::vector<unsigned char> thumbnails(thumbnailBytes * imageCount);
+		const double scaleTime(Time([&]()
+		{
+			for (unsigned int i = 0; i < imageCount; ++i)
+				ThumbnailScaler::CropAndScale(images[i].GetData(), width * 3, left, 0, height, size, filter.first, thumbnails.data() + i * thumbnailBytes);
+		}));
+		Report("Crop and scale (" + filter.second + ")", imageCount, scaleTime, megapixels, "MP/s");
+
+		int maxError(0);
+		std::vector<unsigned char> reference(thumbnailBytes);
+		for (unsigned int i = 0; i < imageCount; ++i)
+		{
+			if (filter.first == ThumbnailScaler::Filter::Area)
+				ScaleAreaReference(images[i], left, height, size, reference.data());
+			else
+				ScaleBoxReference(images[i], left, height, size, reference.data());
+
+			for (size_t j = 0; j < thumbnailBytes; ++j)
+				maxError = std::max(maxError, std::abs(static_cast<int>(reference[j]) - thumbnails[i * thumbnailBytes + j]));
+		}
+
+		std::ostringstream description;
+		description << filter.second << " filter matches reference (max error " << maxError << ")";
+		Check(maxError <= (filter.first == ThumbnailScaler::Filter::Area ? 1 : 0), description.str());
+	}
+
+	const double wxTime(Time([&]()
+	{
+		for (unsigned int i = 0; i < imageCount; ++i)
+		{
+			wxImage image(images[i]);
+			image.Resize(wxSize(height, height), wxPoint(-static_cast<int>(left), 0));
+			image.Rescale(size, size);
+		}
+	}));
+	Report("Crop and scale (wxImage)", imageCount, wxTime, megapixels, "MP/s");
+}
+
+void PhotomosaicBenchmark::BenchmarkScoring(const unsigned int& librarySize)
+{
+	const Photomosaic::TargetInfo targetInfo(MakeTargetInfo(options.tileColumns, options.tileRows));
+	std::vector<Photomosaic::ImageInfo> thumbnailInfo(librarySize);
+	for (auto& thumbnail : thumbnailInfo)
+		thumbnail.info = corpus.MakeInfoGrid(options.subSamples);
+
+	const PhotomosaicConfig config(GetConfig());
+	const Photomosaic photomosaic(config);
+	const double cellCount(static_cast<double>(options.tileColumns) * options.tileRows);
+	const double pairCount(cellCount * librarySize);
+
+	// The scalar path is far too slow to run against the largest libraries, so it is timed against a sample
+	const unsigned int sampleSize(std::min(librarySize, 10000U));
+	double sink(0.0);
+	const double scalarTime(Time([&]()
+	{
+		for (const auto& column : targetInfo)
+		{
+			for (const auto& target : column)
+			{
+				for (unsigned int i = 0; i < sampleSize; ++i)
+					sink += photomosaic.ComputeScore(target, thumbnailInfo[i].info);
+			}
+		}
+	}));
+	Report("ComputeScore (scalar)", sampleSize, scalarTime, cellCount * sampleSize, "pairs/s");
+	if (sink < 0.0)
+		std::cout << sink;// Keeps the loop from being optimized away
+
+	// Kernel results are single precision (see ScoringKernel)
+	const double kernelTolerance(1.0e-5 * (config.hueErrorWeight + config.saturationErrorWeight + config.valueErrorWeight)
+		* config.subSamples * config.subSamples);
+
+	std::vector<const InfoGrid*> thumbnailGrids(librarySize);
+	for (unsigned int i = 0; i < librarySize; ++i)
+		thumbnailGrids[i] = &thumbnailInfo[i].info;
+	FeaturePlanes planes;
+	planes.Build(thumbnailGrids, config.subSamples);
+
+	const int bestInstructionSet(static_cast<int>(ScoringKernel::GetBestSupportedInstructionSet()));
+	Photomosaic::ScoreGrid candidates;
+	for (int i = 0; i <= bestInstructionSet; ++i)
+	{
+		const ScoringKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight,
+			static_cast<ScoringKernel::InstructionSet>(i));
+		candidates = Photomosaic::ScoreGrid(targetInfo.size());
+		const double kernelTime(Time([&]()
+		{
+			Executor::GetShared().ParallelFor(targetInfo.size(), [&](const size_t& x)
+			{
+				Photomosaic::ScoreColumnTopK(kernel, planes, targetInfo[x], config.candidateCount, candidates[x]);
+			});
+		}));
+
+		const std::string name(std::string("Top-K scoring (") + ScoringKernel::GetName(kernel.GetInstructionSet()) + ")");
+		Report(name, librarySize, kernelTime, pairCount, "pairs/s");
+		CheckCandidates(name, photomosaic, candidates, targetInfo, thumbnailInfo, kernelTolerance);
+	}
+
+	Photomosaic::ScoreGrid treeCandidates;
+	const double treeTime(Time([&]()
+	{
+		QuietOutput quiet;
+		treeCandidates = photomosaic.FindCandidates(targetInfo, thumbnailInfo);
+	}));
+	Report("Search index (build and query)", librarySize, treeTime, pairCount, "pairs/s");
+	CheckCandidates("Search index", photomosaic, treeCandidates, targetInfo, thumbnailInfo, 1.0e-12);
+
+	// The full score cube needs memory proportional to cells * thumbnails, so only run it when that's reasonable
+	const double maxLegacyPairs(4.0e6);
+	if (pairCount <= maxLegacyPairs)
+	{
+		Photomosaic::ScoreGrid sortedScores;
+		const double legacyTime(Time([&]()
+		{
+			std::vector<std::vector<std::vector<double>>> scores(librarySize);
+			for (unsigned int i = 0; i < librarySize; ++i)
+				scores[i] = photomosaic.ScoreAllThumbnailsOnGrid(targetInfo, thumbnailInfo[i].info);
+			sortedScores = Photomosaic::CreateSortedScoreGrid(scores);
+		}));
+		Report("CreateSortedScoreGrid (reference)", librarySize, legacyTime, pairCount, "pairs/s");
+		CheckCandidates("CreateSortedScoreGrid", photomosaic, sortedScores, targetInfo, thumbnailInfo, 1.0e-12);
+	}
+
+	if (librarySize == options.librarySizes.back())
+		BenchmarkSelection(candidates, targetInfo, thumbnailInfo);
+}
+
+// The cascade's pruning depends on how well a square's overall color predicts its subsamples, so it is
+// compared with the fastest kernel on both the usual corpus (independent subsamples, the worst case) and
+// a smooth one
+void PhotomosaicBenchmark::BenchmarkCascade(const unsigned int& librarySize)
+{
+	const PhotomosaicConfig config(GetConfig());
+	const Photomosaic photomosaic(config);
+	const double pairCount(static_cast<double>(options.tileColumns) * options.tileRows * librarySize);
+	const double kernelTolerance(1.0e-5 * (config.hueErrorWeight + config.saturationErrorWeight + config.valueErrorWeight)
+		* config.subSamples * config.subSamples);
+
+	for (const bool& smooth : { false, true })
+	{
+		const std::string corpusName(smooth ? "smooth" : "independent");
+		const auto makeInfoGrid([this, smooth]()
+		{
+			return smooth ? corpus.MakeSmoothInfoGrid(options.subSamples) : corpus.MakeInfoGrid(options.subSamples);
+		});
+
+		Photomosaic::TargetInfo targetInfo(options.tileColumns, std::vector<InfoGrid>(options.tileRows));
+		for (auto& column : targetInfo)
+		{
+			for (auto& target : column)
+				target = makeInfoGrid();
+		}
+
+		std::vector<Photomosaic::ImageInfo> thumbnailInfo(librarySize);
+		std::vector<const InfoGrid*> thumbnailGrids(librarySize);
+		for (unsigned int i = 0; i < librarySize; ++i)
+		{
+			thumbnailInfo[i].info = makeInfoGrid();
+			thumbnailGrids[i] = &thumbnailInfo[i].info;
+		}
+
+		FeaturePlanes planes;
+		planes.Build(thumbnailGrids, config.subSamples);
+		const ScoringKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+		Photomosaic::ScoreGrid candidates(targetInfo.size());
+		const double kernelTime(Time([&]()
+		{
+			Executor::GetShared().ParallelFor(targetInfo.size(), [&](const size_t& x)
+			{
+				Photomosaic::ScoreColumnTopK(kernel, planes, targetInfo[x], config.candidateCount, candidates[x]);
+			});
+		}));
+		Report("Top-K scoring (" + corpusName + ", " + ScoringKernel::GetName(kernel.GetInstructionSet()) + ")",
+			librarySize, kernelTime, pairCount, "pairs/s");
+
+		// Exact, and then allowing scores up to 10% worse than the best possible
+		for (const double& slack : { 0.0, 0.1 })
+		{
+			ScoreCascade cascade(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight, slack);
+			cascade.Build(thumbnailGrids, config.subSamples);
+			std::vector<ScoreCascade::Statistics> statistics(targetInfo.size());
+			const double cascadeTime(Time([&]()
+			{
+				Executor::GetShared().ParallelFor(targetInfo.size(), [&](const size_t& x)
+				{
+					Photomosaic::ScoreColumnCascade(cascade, targetInfo[x], config.candidateCount, candidates[x], statistics[x]);
+				});
+			}));
+
+			uint64_t scoredCount(0);
+			for (const auto& columnStatistics : statistics)
+				scoredCount += columnStatistics.scored;
+
+			std::ostringstream name;
+			name << "Top-K scoring (" << corpusName << ", cascade " << slack << ")";
+			Report(name.str(), librarySize, cascadeTime, pairCount, "pairs/s");
+			name << " scored " << std::setprecision(3) << 100.0 * scoredCount / pairCount << "% of pairs;";
+			CheckCandidates(name.str(), photomosaic, candidates, targetInfo, thumbnailInfo, kernelTolerance, slack);
+		}
+	}
+}
+
+// Compares the compact library store with the single-precision planes:  size, speed, and how far its
+// choices are from those of the double-precision path
+void PhotomosaicBenchmark::BenchmarkQuantized(const unsigned int& librarySize)
+{
+	const Photomosaic::TargetInfo targetInfo(MakeTargetInfo(options.tileColumns, options.tileRows));
+	std::vector<Photomosaic::ImageInfo> thumbnailInfo(librarySize);
+	std::vector<const InfoGrid*> thumbnailGrids(librarySize);
+	for (unsigned int i = 0; i < librarySize; ++i)
+	{
+		thumbnailInfo[i].info = corpus.MakeInfoGrid(options.subSamples);
+		thumbnailGrids[i] = &thumbnailInfo[i].info;
+	}
+
+	const PhotomosaicConfig config(GetConfig());
+	const Photomosaic photomosaic(config);
+	const double pairCount(static_cast<double>(options.tileColumns) * options.tileRows * librarySize);
+	const unsigned int sampleCount(config.subSamples * config.subSamples);
+	const double megabytesPerMillion(1.0e6 / (1024.0 * 1024.0));
+
+	Photomosaic::ScoreGrid candidates(targetInfo.size());
+	{
+		FeaturePlanes planes;
+		planes.Build(thumbnailGrids, config.subSamples);
+		const ScoringKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+		const double kernelTime(Time([&]()
+		{
+			Executor::GetShared().ParallelFor(targetInfo.size(), [&](const size_t& x)
+			{
+				Photomosaic::ScoreColumnTopK(kernel, planes, targetInfo[x], config.candidateCount, candidates[x]);
+			});
+		}));
+		Report(std::string("Top-K scoring (float, ") + ScoringKernel::GetName(kernel.GetInstructionSet()) + ")",
+			librarySize, kernelTime, pairCount, "pairs/s");
+		std::cout << "  float features:  " << sampleCount * 3 * sizeof(float) << " bytes per thumbnail ("
+			<< sampleCount * 3 * sizeof(float) * megabytesPerMillion << " MB per million)" << std::endl;
+	}
+
+	for (const unsigned int& bits : { 8U, 16U })
+	{
+		QuantizedPlanes planes(bits);
+		planes.Build(thumbnailGrids, config.subSamples);
+		const QuantizedKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+		const double kernelTime(Time([&]()
+		{
+			Executor::GetShared().ParallelFor(targetInfo.size(), [&](const size_t& x)
+			{
+				Photomosaic::ScoreColumnTopK(kernel, planes, targetInfo[x], config.candidateCount, candidates[x]);
+			});
+		}));
+
+		std::ostringstream name;
+		name << "Top-K scoring (" << bits << "-bit, " << ScoringKernel::GetName(kernel.GetInstructionSet()) << ")";
+		Report(name.str(), librarySize, kernelTime, pairCount, "pairs/s");
+
+		// Accuracy loss is the extra (exact) cost of each location's best quantized candidate over its true best
+		const unsigned int locationStride(97);
+		const unsigned int rows(targetInfo.front().size());
+		unsigned int locationCount(0), sameCount(0);
+		double totalLoss(0.0), maxLoss(0.0);
+		for (unsigned int location = 0; location < targetInfo.size() * rows; location += locationStride)
+		{
+			const unsigned int x(location / rows), y(location % rows);
+			const auto exact(FindBestByExhaustiveSearch(photomosaic, targetInfo[x][y], thumbnailInfo, 1));
+			const double loss(photomosaic.ComputeScore(targetInfo[x][y], thumbnailInfo[candidates[x][y].front().thumbnailIndex].info)
+				- exact.front().score);
+			++locationCount;
+			if (candidates[x][y].front().thumbnailIndex == exact.front().thumbnailIndex)
+				++sameCount;
+			totalLoss += loss;
+			maxLoss = std::max(maxLoss, loss);
+		}
+
+		const size_t bytesPerThumbnail(planes.GetSizeInBytes() / planes.GetPaddedCount());
+		std::cout << "  " << bits << "-bit features:  " << bytesPerThumbnail << " bytes per thumbnail (" << bytesPerThumbnail * megabytesPerMillion
+			<< " MB per million); same best thumbnail at " << 100.0 * sameCount / locationCount << "% of locations, mean loss "
+			<< totalLoss / locationCount << ", max loss " << maxLoss << std::endl;
+		CheckCandidates(name.str(), photomosaic, candidates, targetInfo, thumbnailInfo, kernel.GetTolerance(planes));
+	}
+}
+
+// Matrix-product scoring in each Euclidean color space, against the HSV kernel it would replace
+void PhotomosaicBenchmark::BenchmarkEuclidean(const unsigned int& librarySize)
+{
+	const Photomosaic::TargetInfo targetInfo(MakeTargetInfo(options.tileColumns, options.tileRows));
+	std::vector<Photomosaic::ImageInfo> thumbnailInfo(librarySize);
+	std::vector<const InfoGrid*> thumbnailGrids(librarySize);
+	for (unsigned int i = 0; i < librarySize; ++i)
+	{
+		thumbnailInfo[i].info = corpus.MakeInfoGrid(options.subSamples);
+		thumbnailGrids[i] = &thumbnailInfo[i].info;
+	}
+
+	const double pairCount(static_cast<double>(options.tileColumns) * options.tileRows * librarySize);
+	Photomosaic::ScoreGrid candidates(targetInfo.size());
+	{
+		const PhotomosaicConfig config(GetConfig());
+		FeaturePlanes planes;
+		planes.Build(thumbnailGrids, config.subSamples);
+		const ScoringKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+		const double kernelTime(Time([&]()
+		{
+			Executor::GetShared().ParallelFor(targetInfo.size(), [&](const size_t& x)
+			{
+				Photomosaic::ScoreColumnTopK(kernel, planes, targetInfo[x], config.candidateCount, candidates[x]);
+			});
+		}));
+		Report(std::string("Top-K scoring (HSV, ") + ScoringKernel::GetName(kernel.GetInstructionSet()) + ")",
+			librarySize, kernelTime, pairCount, "pairs/s");
+	}
+
+	for (const auto& space : { PhotomosaicConfig::ColorSpace::Lab, PhotomosaicConfig::ColorSpace::YCbCr })
+	{
+		PhotomosaicConfig config(GetConfig());
+		config.colorSpace = space;
+		const Photomosaic photomosaic(config);
+		const EuclideanFeatures& features(photomosaic.GetEuclideanFeatures());
+		EuclideanPlanes planes;
+		planes.Build(thumbnailGrids, features);
+
+		// Single precision, relative to squared norms of at most about 2.5 per subsample for unit weights
+		const double kernelTolerance(1.0e-5 * (config.lightnessWeight + 2.0 * config.chromaWeight) * config.subSamples * config.subSamples);
+
+		const int bestInstructionSet(static_cast<int>(ScoringKernel::GetBestSupportedInstructionSet()));
+		for (int i = 0; i <= bestInstructionSet; ++i)
+		{
+			const EuclideanKernel kernel(static_cast<ScoringKernel::InstructionSet>(i));
+			if (static_cast<int>(kernel.GetInstructionSet()) != i)
+				continue;// Falls back to a kernel which has already been timed
+
+			const double kernelTime(Time([&]()
+			{
+				Executor::GetShared().ParallelFor(targetInfo.size(), [&](const size_t& x)
+				{
+					Photomosaic::ScoreColumnTopK(kernel, features, planes, targetInfo[x], config.candidateCount, candidates[x]);
+				});
+			}));
+
+			const std::string name(std::string("Top-K scoring (") + EuclideanFeatures::GetName(features.GetSpace()) + ", "
+				+ ScoringKernel::GetName(kernel.GetInstructionSet()) + " matrix)");
+			Report(name, librarySize, kernelTime, pairCount, "pairs/s");
+			CheckCandidates(name, photomosaic, candidates, targetInfo, thumbnailInfo, kernelTolerance);
+		}
+	}
+}
+
+// Near-duplicate search over perceptual hashes, against comparing every pair
+void PhotomosaicBenchmark::BenchmarkDuplicateSearch(const unsigned int& librarySize)
+{
+	const unsigned int maxDistance(6);
+	const std::vector<uint64_t> hashes(corpus.MakeHashes(librarySize, maxDistance));
+
+	std::vector<std::vector<unsigned int>> neighbors(librarySize);
+	const double indexTime(Time([&]()
+	{
+		const HammingIndex index(hashes, maxDistance);
+		Executor::GetShared().ParallelFor(librarySize, [&](const size_t& i)
+		{
+			index.FindNeighbors(static_cast<unsigned int>(i), neighbors[i]);
+		});
+	}));
+	Report("Duplicate search (Hamming index)", librarySize, indexTime, librarySize, "images/s");
+
+	// All pairs is quadratic, so only a sample of queries is checked
+	const unsigned int sampleSize(std::min(librarySize, 1000U));
+	bool matches(true);
+	const double bruteForceTime(Time([&]()
+	{
+		for (unsigned int i = 0; i < sampleSize; ++i)
+		{
+			std::vector<unsigned int> expected;
+			for (unsigned int j = 0; j < librarySize; ++j)
+			{
+				if (j != i && PerceptualHash::GetDistance(hashes[i], hashes[j]) <= maxDistance)
+					expected.push_back(j);
+			}
+
+			if (expected != neighbors[i])
+				matches = false;
+		}
+	}));
+	Report("Duplicate search (all pairs)", librarySize, bruteForceTime * librarySize / sampleSize, librarySize, "images/s");
+
+	std::ostringstream description;
+	description << "Hamming index finds the same neighbors as all pairs for " << sampleSize << " queries";
+	Check(matches, description.str());
+}
+
+void PhotomosaicBenchmark::BenchmarkSelection(const Photomosaic::ScoreGrid& candidates, const Photomosaic::TargetInfo& targetInfo,
+	const std::vector<Photomosaic::ImageInfo>& thumbnailInfo)
+{
+	const unsigned int cellCount(options.tileColumns * options.tileRows);
+	PhotomosaicConfig config(GetConfig());
+	const std::vector<std::vector<unsigned int>> greedyTiles(Photomosaic::ChooseTiles(candidates, config));
+
+	config.distancePenaltyScale = 0.01;
+	std::vector<std::vector<unsigned int>> penaltyTiles;
+	const double penaltyTime(Time([&]()
+	{
+		QuietOutput quiet;
+		penaltyTiles = Photomosaic::ChooseTiles(candidates, config);
+	}));
+	Report("Distance penalty", cellCount, penaltyTime, cellCount, "cells/s");
+
+	const double greedyEnergy(ComputeRepeatEnergy(candidates, greedyTiles, config));
+	const double penaltyEnergy(ComputeRepeatEnergy(candidates, penaltyTiles, config));
+	std::ostringstream description;
+	description << "distance penalty lowers total cost (" << greedyEnergy << " -> " << penaltyEnergy << ")";
+	Check(penaltyEnergy <= greedyEnergy * (1.0 + 1.0e-12), description.str());
+
+	bool repeatable;
+	{
+		QuietOutput quiet;
+		repeatable = Photomosaic::ChooseTiles(candidates, config) == penaltyTiles;
+	}
+	Check(repeatable, "distance penalty chooses the same tiles on every run");
+
+	if (thumbnailInfo.size() < cellCount)
+		return;
+
+	config = GetConfig();
+	config.allowMultipleOccurrences = false;
+	const Photomosaic photomosaic(config);
+	std::vector<std::vector<unsigned int>> uniqueTiles;
+	const double uniqueTime(Time([&]()
+	{
+		QuietOutput quiet;
+		uniqueTiles = photomosaic.ChooseUniqueTiles(candidates, targetInfo, thumbnailInfo);
+	}));
+	Report("Unique assignment", cellCount, uniqueTime, cellCount, "cells/s");
+
+	// The best thumbnail for every location, ignoring the constraint, is a lower bound on the cost
+	double uniqueCost(0.0), lowerBound(0.0);
+	std::set<unsigned int> used;
+	bool valid(uniqueTiles.size() == targetInfo.size());
+	for (unsigned int x = 0; valid && x < targetInfo.size(); ++x)
+	{
+		valid = uniqueTiles[x].size() == targetInfo[x].size();
+		for (unsigned int y = 0; valid && y < targetInfo[x].size(); ++y)
+		{
+			valid = uniqueTiles[x][y] < thumbnailInfo.size() && used.insert(uniqueTiles[x][y]).second;
+			if (valid)
+			{
+				uniqueCost += photomosaic.ComputeScore(targetInfo[x][y], thumbnailInfo[uniqueTiles[x][y]].info);
+				lowerBound += candidates[x][y].front().score;
+			}
+		}
+	}
+
+	description.str("");
+	description << "unique assignment uses each thumbnail once (cost " << uniqueCost << ", lower bound " << lowerBound << ")";
+	Check(valid, description.str());
+
+	CheckUniqueAssignmentWithZeroCosts();
+}
+
+// Flat target regions which exactly match flat library images score zero.  Every location shares the same
+// few candidates, so most must be retried against the rest of the library.
+void PhotomosaicBenchmark::CheckUniqueAssignmentWithZeroCosts()
+{
+	const unsigned int columns(8), rows(8), thumbnailCount(columns * rows + 16), candidateCount(4);
+	const InfoGrid flat(options.subSamples, std::vector<SquareInfo>(options.subSamples, SquareInfo{ 0.25, 0.5, 0.5 }));
+	const Photomosaic::TargetInfo targetInfo(columns, std::vector<InfoGrid>(rows, flat));
+	std::vector<Photomosaic::ImageInfo> thumbnailInfo(thumbnailCount);
+	for (auto& thumbnail : thumbnailInfo)
+		thumbnail.info = flat;
+
+	Photomosaic::ScoreGrid candidates(columns, std::vector<std::vector<Photomosaic::TileScore>>(rows));
+	for (auto& column : candidates)
+	{
+		for (auto& cellCandidates : column)
+		{
+			for (unsigned int i = 0; i < candidateCount; ++i)
+				cellCandidates.push_back(Photomosaic::TileScore{ i, 0.0 });
+		}
+	}
+
+	PhotomosaicConfig config(GetConfig());
+	config.allowMultipleOccurrences = false;
+	const Photomosaic photomosaic(config);
+	std::vector<std::vector<unsigned int>> uniqueTiles;
+	{
+		QuietOutput quiet;
+		uniqueTiles = photomosaic.ChooseUniqueTiles(candidates, targetInfo, thumbnailInfo);
+	}
+
+	std::set<unsigned int> used;
+	bool valid(uniqueTiles.size() == columns);
+	for (unsigned int x = 0; valid && x < columns; ++x)
+	{
+		valid = uniqueTiles[x].size() == rows;
+		for (unsigned int y = 0; valid && y < rows; ++y)
+			valid = uniqueTiles[x][y] < thumbnailCount && used.insert(uniqueTiles[x][y]).second;
+	}
+
+	Check(valid, "unique assignment fills every location when all costs are zero");
+}
+
+void PhotomosaicBenchmark::BenchmarkComposition()
+{
+	const unsigned int thumbnailCount(2000);
+	std::vector<Photomosaic::ImageInfo> thumbnailInfo(thumbnailCount);
+	for (auto& thumbnail : thumbnailInfo)
+		thumbnail.image = corpus.MakeImage(options.thumbnailSize, options.thumbnailSize);
+
+	std::mt19937 generator(options.seed);
+	std::uniform_int_distribution<unsigned int> distribution(0, thumbnailCount - 1);
+	std::vector<std::vector<unsigned int>> chosenTiles(options.tileColumns, std::vector<unsigned int>(options.tileRows));
+	for (auto& column : chosenTiles)
+	{
+		for (auto& tile : column)
+			tile = distribution(generator);
+	}
+
+	const Photomosaic photomosaic(GetConfig());
+	wxImage mosaic;
+	const double compositionTime(Time([&]()
+	{
+		mosaic = photomosaic.BuildOutputImage(chosenTiles, thumbnailInfo);
+	}));
+
+	const unsigned int size(options.thumbnailSize);
+	const double megabytes(static_cast<double>(mosaic.GetWidth()) * mosaic.GetHeight() * 3 * 1.0e-6);
+	Report("BuildOutputImage", options.tileColumns * options.tileRows, compositionTime, megabytes, "MB/s");
+
+	wxImage reference(options.tileColumns * size, options.tileRows * size);
+	const double referenceTime(Time([&]()
+	{
+		for (unsigned int x = 0; x < options.tileColumns; ++x)
+		{
+			for (unsigned int y = 0; y < options.tileRows; ++y)
+			{
+				const wxImage& thumbnail(thumbnailInfo[chosenTiles[x][y]].image);
+				for (unsigned int i = 0; i < size; ++i)
+				{
+					for (unsigned int j = 0; j < size; ++j)
+						reference.SetRGB(x * size + i, y * size + j, thumbnail.GetRed(i, j), thumbnail.GetGreen(i, j), thumbnail.GetBlue(i, j));
+				}
+			}
+		}
+	}));
+	Report("BuildOutputImage (reference)", options.tileColumns * options.tileRows, referenceTime, megabytes, "MB/s");
+
+	Check(mosaic.GetWidth() == reference.GetWidth() && mosaic.GetHeight() == reference.GetHeight() &&
+		memcmp(mosaic.GetData(), reference.GetData(), static_cast<size_t>(mosaic.GetWidth()) * mosaic.GetHeight() * 3) == 0,
+		"composited image matches reference");
+}
+
+// Runs the same ingest pipeline as the application:  read, decode, crop and scale, then color information and
+// perceptual hash, without a library index so every file is processed
+void PhotomosaicBenchmark::BenchmarkDecode(const std::string& libraryDirectory)
+{
+	uint64_t totalBytes(0);
+	for (const auto& entry : stdfs::directory_iterator(libraryDirectory))
+	{
+		LibraryIndex::Key key;
+		if (Photomosaic::GetIndexKey(entry, Photomosaic::CropHint::Center, key))
+			totalBytes += key.fileSize;
+	}
+
+	PhotomosaicConfig config(GetConfig());
+	config.centerFocusSourceDirectory = libraryDirectory;
+	Photomosaic photomosaic(config);
+	std::vector<Photomosaic::ImageInfo> thumbnailInfo;
+	const double decodeTime(Time([&]()
+	{
+		QuietOutput quiet;
+		thumbnailInfo = photomosaic.GetThumbnailInfo();
+	}));
+
+	Report("Decode and analyze thumbnails", options.fileCount, decodeTime, totalBytes * 1.0e-6, "MB/s");
+	Report("Decode and analyze thumbnails", options.fileCount, decodeTime, options.fileCount, "images/s");
+	Check(thumbnailInfo.size() == options.fileCount, "all synthetic library images decoded");
+}
+
+void PhotomosaicBenchmark::BenchmarkEndToEnd(const std::string& libraryDirectory)
+{
+	PhotomosaicConfig config(GetConfig());
+	config.centerFocusSourceDirectory = libraryDirectory;
+	config.targetImageFileName = (stdfs::path(options.workingDirectory) / "target.jpg").generic_string();
+	if (!Check(corpus.MakeImage(options.tileColumns * config.subDivisionSize, options.tileRows * config.subDivisionSize)
+		.SaveFile(config.targetImageFileName, wxBITMAP_TYPE_JPEG), "write synthetic target"))
+		return;
+
+	const double pairCount(static_cast<double>(options.tileColumns) * options.tileRows * options.fileCount);
+	const auto build([this, &pairCount](const std::string& name, const PhotomosaicConfig& config)
+	{
+		wxImage mosaic;
+		const double buildTime(Time([&]()
+		{
+			QuietOutput quiet;
+			Photomosaic photomosaic(config);
+			mosaic = photomosaic.Build();
+		}));
+
+		Report("End-to-end (" + name + ")", options.fileCount, buildTime, pairCount, "pairs/s");
+		Check(static_cast<unsigned int>(mosaic.GetWidth()) == options.tileColumns * options.thumbnailSize &&
+			static_cast<unsigned int>(mosaic.GetHeight()) == options.tileRows * options.thumbnailSize, "end-to-end (" + name + ") built mosaic");
+		return mosaic;
+	});
+
+	config.candidateCount = 0;
+	const wxImage reference(build("full scoring", config));
+
+	config.candidateCount = options.candidateCount;
+	build("top-K", config);// Single precision, so near-ties may be broken differently than the reference
+
+	config.useSearchIndex = true;
+	const wxImage searchIndex(build("search index", config));
+	Check(reference.IsOk() && searchIndex.IsOk() && memcmp(reference.GetData(), searchIndex.GetData(),
+		static_cast<size_t>(reference.GetWidth()) * reference.GetHeight() * 3) == 0, "search index mosaic matches full scoring");
+
+	config.useSearchIndex = false;
+	config.distancePenaltyScale = 0.01;
+	build("distance penalty", config);
+
+	if (options.fileCount >= options.tileColumns * options.tileRows)
+	{
+		config.distancePenaltyScale = 0.0;
+		config.allowMultipleOccurrences = false;
+		build("unique", config);
+	}
+}
+
+Photomosaic::TargetInfo PhotomosaicBenchmark::MakeTargetInfo(const unsigned int& columns, const unsigned int& rows)
+{
+	Photomosaic::TargetInfo targetInfo(columns, std::vector<InfoGrid>(rows));
+	for (auto& column : targetInfo)
+	{
+		for (auto& target : column)
+			target = corpus.MakeInfoGrid(options.subSamples);
+	}
+
+	return targetInfo;
+}
+
+std::vector<Photomosaic::TileScore> PhotomosaicBenchmark::FindBestByExhaustiveSearch(const Photomosaic& photomosaic, const InfoGrid& target,
+	const std::vector<Photomosaic::ImageInfo>& thumbnailInfo, const unsigned int& count)
+{
+	TopKSelector<Photomosaic::TileScore> selector(count);
+	for (unsigned int i = 0; i < thumbnailInfo.size(); ++i)
+		selector.Push(Photomosaic::TileScore{ i, photomosaic.ComputeScore(target, thumbnailInfo[i].info) });
+	return selector.TakeSorted();
+}
+
+// Ties may be broken differently, so compare scores rank by rank rather than thumbnail indices
+bool PhotomosaicBenchmark::CheckCandidates(const std::string& name, const Photomosaic& photomosaic, const Photomosaic::ScoreGrid& candidates,
+	const Photomosaic::TargetInfo& targetInfo, const std::vector<Photomosaic::ImageInfo>& thumbnailInfo, const double& tolerance, const double& slack)
+{
+	const unsigned int locationStride(97);
+	const unsigned int rows(targetInfo.front().size());
+	double maxError(0.0);
+	bool valid(candidates.size() == targetInfo.size());
+	for (unsigned int location = 0; valid && location < targetInfo.size() * rows; location += locationStride)
+	{
+		const unsigned int x(location / rows), y(location % rows);
+		const auto expected(FindBestByExhaustiveSearch(photomosaic, targetInfo[x][y], thumbnailInfo, options.candidateCount));
+		const auto& actual(candidates[x][y]);
+		valid = actual.size() >= expected.size();
+		for (unsigned int i = 0; valid && i < expected.size(); ++i)
+		{
+			if (slack > 0.0)// Only an upper bound is guaranteed
+				maxError = std::max(maxError, actual[i].score - (1.0 + slack) * expected[i].score);
+			else
+				maxError = std::max(maxError, std::abs(actual[i].score - expected[i].score));
+			maxError = std::max(maxError, std::abs(actual[i].score -
+				photomosaic.ComputeScore(targetInfo[x][y], thumbnailInfo[actual[i].thumbnailIndex].info)));
+		}
+	}
+
+	std::ostringstream description;
+	description << name << " finds the best candidates (max error " << maxError << ")";
+	return Check(valid && maxError <= tolerance, description.str());
+}
+
+void PhotomosaicBenchmark::ScaleAreaReference(const wxImage& image, const unsigned int& left, const unsigned int& cropSize,
+	const unsigned int& size, unsigned char* destination)
+{
+	const double scale(static_cast<double>(cropSize) / size);
+	for (unsigned int y = 0; y < size; ++y)
+	{
+		for (unsigned int x = 0; x < size; ++x)
+		{
+			double sum[3] = { 0.0, 0.0, 0.0 };
+			for (unsigned int sy = static_cast<unsigned int>(y * scale); sy < std::min<double>(cropSize, (y + 1) * scale); ++sy)
+			{
+				const double yOverlap(std::min(sy + 1.0, (y + 1) * scale) - std::max<double>(sy, y * scale));
+				for (unsigned int sx = static_cast<unsigned int>(x * scale); sx < std::min<double>(cropSize, (x + 1) * scale); ++sx)
+				{
+					const double weight(yOverlap * (std::min(sx + 1.0, (x + 1) * scale) - std::max<double>(sx, x * scale)));
+					sum[0] += weight * image.GetRed(left + sx, sy);
+					sum[1] += weight * image.GetGreen(left + sx, sy);
+					sum[2] += weight * image.GetBlue(left + sx, sy);
+				}
+			}
+
+			for (unsigned int c = 0; c < 3; ++c)
+				destination[(y * size + x) * 3 + c] = static_cast<unsigned char>(std::min(255.0, sum[c] / (scale * scale) + 0.5));
+		}
+	}
+}
+
+void PhotomosaicBenchmark::ScaleBoxReference(const wxImage& image, const unsigned int& left, const unsigned int& cropSize,
+	const unsigned int& size, unsigned char* destination)
+{
+	const unsigned int block(std::max(cropSize / size, 1U));
+	for (unsigned int y = 0; y < size; ++y)
+	{
+		for (unsigned int x = 0; x < size; ++x)
+		{
+			unsigned int sum[3] = { 0, 0, 0 };
+			for (unsigned int sy = y * cropSize / size; sy < y * cropSize / size + block; ++sy)
+			{
+				for (unsigned int sx = x * cropSize / size; sx < x * cropSize / size + block; ++sx)
+				{
+					sum[0] += image.GetRed(left + sx, sy);
+					sum[1] += image.GetGreen(left + sx, sy);
+					sum[2] += image.GetBlue(left + sx, sy);
+				}
+			}
+
+			for (unsigned int c = 0; c < 3; ++c)
+				destination[(y * size + x) * 3 + c] = static_cast<unsigned char>((sum[c] + block * block / 2) / (block * block));
+		}
+	}
+}
+
+// The quantity RepeatOptimizer minimizes:  the sum of the chosen scores, plus the penalty for each pair of repeats within the radius
+double PhotomosaicBenchmark::ComputeRepeatEnergy(const Photomosaic::ScoreGrid& candidates, const std::vector<std::vector<unsigned int>>& chosenTiles,
+	const PhotomosaicConfig& config)
+{
+	const int xCount(static_cast<int>(chosenTiles.size()));
+	const int yCount(static_cast<int>(chosenTiles.front().size()));
+	const double refDistance(static_cast<double>(xCount) * xCount + static_cast<double>(yCount) * yCount);
+	const int r(static_cast<int>(config.distancePenaltyRadius));
+
+	double energy(0.0);
+	for (int x = 0; x < xCount; ++x)
+	{
+		for (int y = 0; y < yCount; ++y)
+		{
+			for (const auto& candidate : candidates[x][y])
+			{
+				if (candidate.thumbnailIndex == chosenTiles[x][y])
+				{
+					energy += candidate.score;
+					break;
+				}
+			}
+
+			// Each pair is visited from both ends
+			for (int nx = std::max(x - r, 0); nx <= std::min(x + r, xCount - 1); ++nx)
+			{
+				for (int ny = std::max(y - r, 0); ny <= std::min(y + r, yCount - 1); ++ny)
+				{
+					const int distanceSquared((nx - x) * (nx - x) + (ny - y) * (ny - y));
+					if (distanceSquared > 0 && distanceSquared <= r * r && chosenTiles[nx][ny] == chosenTiles[x][y])
+						energy += 0.5 * config.distancePenaltyScale * refDistance / distanceSquared;
+				}
+			}
+		}
+	}
+
+	return energy;
+}
+
+template<typename Function>
+double PhotomosaicBenchmark::Time(const Function& function)
+{
+	const auto start(std::chrono::steady_clock::now());
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PhotomosaicBenchmark::Report(const std::string& name, const unsigned int& size, const double& seconds, const double& amount, const std::string& unit)
+{
+	std::cout << std::left << std::setw(40) << name << std::right << std::setw(10) << size
+		<< std::setw(12) << std::fixed << std::setprecision(4) << seconds << "  "
+		<< std::defaultfloat << std::setprecision(4) << amount / std::max(seconds, 1.0e-9) << ' ' << unit << std::endl;
+}
+
+bool PhotomosaicBenchmark::Check(const bool& passed, const std::string& description)
+{
+	std::cout << (passed ? "  passed:  " : "  FAILED:  ") << description << std::endl;
+	if (!passed)
+		++failureCount;
+
+	return passed;
+}
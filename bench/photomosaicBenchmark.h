@@ -0,0 +1,94 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  photomosaicBenchmark.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Offline benchmarks for each stage of mosaic construction, using a synthetic corpus.
+
+#ifndef PHOTOMOSAIC_BENCHMARK_H_
+#define PHOTOMOSAIC_BENCHMARK_H_
+
+// Local headers
+#include "photomosaic.h"
+#include "syntheticCorpus.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+
+// Times each stage in isolation and checks every fast path against the reference implementation it
+// replaced, so a regression in either speed or results shows up in the same run.  Run() returns false
+// if any check fails.
+class PhotomosaicBenchmark
+{
+public:
+	struct Options
+	{
+		unsigned int seed = 1;
+		std::vector<unsigned int> librarySizes = { 1000, 10000, 100000 };// Feature-level benchmarks only, so these can be large
+		unsigned int tileColumns = 48;
+		unsigned int tileRows = 32;
+		unsigned int subSamples = 2;
+		unsigned int thumbnailSize = 32;
+		unsigned int candidateCount = 16;
+		unsigned int fileCount = 1000;// Library images written to disk for the decode and end-to-end benchmarks
+		std::string workingDirectory;
+	};
+
+	explicit PhotomosaicBenchmark(const Options& options);
+
+	bool Run();
+
+private:
+	const Options options;
+	SyntheticCorpus corpus;
+	unsigned int failureCount = 0;
+
+	PhotomosaicConfig GetConfig() const;
+
+	void BenchmarkColorInformation();
+	void BenchmarkThumbnailScaling();
+	void BenchmarkScoring(const unsigned int& librarySize);
+	void BenchmarkCascade(const unsigned int& librarySize);
+	void BenchmarkQuantized(const unsigned int& librarySize);
+	void BenchmarkEuclidean(const unsigned int& librarySize);
+	void BenchmarkDuplicateSearch(const unsigned int& librarySize);
+	void BenchmarkSelection(const Photomosaic::ScoreGrid& candidates, const Photomosaic::TargetInfo& targetInfo,
+		const std::vector<Photomosaic::ImageInfo>& thumbnailInfo);
+	void CheckUniqueAssignmentWithZeroCosts();
+	void BenchmarkComposition();
+	void BenchmarkDecode(const std::string& libraryDirectory);
+	void BenchmarkEndToEnd(const std::string& libraryDirectory);
+
+	Photomosaic::TargetInfo MakeTargetInfo(const unsigned int& columns, const unsigned int& rows);
+
+	// Best candidates for one location, by exhaustive search with Photomosaic::ComputeScore()
+	static std::vector<Photomosaic::TileScore> FindBestByExhaustiveSearch(const Photomosaic& photomosaic, const InfoGrid& target,
+		const std::vector<Photomosaic::ImageInfo>& thumbnailInfo, const unsigned int& count);
+	bool CheckCandidates(const std::string& name, const Photomosaic& photomosaic, const Photomosaic::ScoreGrid& candidates,
+		const Photomosaic::TargetInfo& targetInfo, const std::vector<Photomosaic::ImageInfo>& thumbnailInfo, const double& tolerance,
+		const double& slack = 0.0);// Scores may be up to (1 + slack) times the best possible
+
+	// Straightforward per-pixel versions of the ThumbnailScaler filters
+	static void ScaleAreaReference(const wxImage& image, const unsigned int& left, const unsigned int& cropSize,
+		const unsigned int& size, unsigned char* destination);
+	static void ScaleBoxReference(const wxImage& image, const unsigned int& left, const unsigned int& cropSize,
+		const unsigned int& size, unsigned char* destination);
+
+	static double ComputeRepeatEnergy(const Photomosaic::ScoreGrid& candidates, const std::vector<std::vector<unsigned int>>& chosenTiles,
+		const PhotomosaicConfig& config);
+
+	template<typename Function>
+	static double Time(const Function& function);
+
+	static void Report(const std::string& name, const unsigned int& size, const double& seconds, const double& amount, const std::string& unit);
+	bool Check(const bool& passed, const std::string& description);
+};
+
+#endif// PHOTOMOSAIC_BENCHMARK_H_
@@ -0,0 +1,152 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  syntheticCorpus.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Reproducible synthetic images and color information for benchmarking.
+
+// Local headers
+#include "syntheticCorpus.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+
+wxImage SyntheticCorpus::MakeImage(const unsigned int& width, const unsigned int& height)
+{
+	wxImage image(width, height, false);
+	unsigned char* data(image.GetData());
+
+	double corners[4][3];
+	for (auto& corner : corners)
+	{
+		for (auto& channel : corner)
+			channel = Uniform(0.0, 255.0);
+	}
+
+	std::normal_distribution<double> noise(0.0, 6.0);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const double v(static_cast<double>(y) / std::max(height - 1, 1U));
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			const double u(static_cast<double>(x) / std::max(width - 1, 1U));
+			unsigned char* pixel(data + (static_cast<size_t>(y) * width + x) * 3);
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				const double value((1.0 - u) * (1.0 - v) * corners[0][c] + u * (1.0 - v) * corners[1][c]
+					+ (1.0 - u) * v * corners[2][c] + u * v * corners[3][c] + noise(generator));
+				pixel[c] = static_cast<unsigned char>(std::min(255.0, std::max(0.0, value)));
+			}
+		}
+	}
+
+	const unsigned int shapeCount(static_cast<unsigned int>(Uniform(1.0, 4.0)));
+	for (unsigned int i = 0; i < shapeCount; ++i)
+	{
+		const unsigned int x0(static_cast<unsigned int>(Uniform(0.0, width)));
+		const unsigned int y0(static_cast<unsigned int>(Uniform(0.0, height)));
+		const unsigned int x1(std::min(width, x0 + static_cast<unsigned int>(Uniform(1.0, width / 2.0 + 1.0))));
+		const unsigned int y1(std::min(height, y0 + static_cast<unsigned int>(Uniform(1.0, height / 2.0 + 1.0))));
+		const unsigned char color[3] = { static_cast<unsigned char>(Uniform(0.0, 255.0)),
+			static_cast<unsigned char>(Uniform(0.0, 255.0)), static_cast<unsigned char>(Uniform(0.0, 255.0)) };
+		for (unsigned int y = y0; y < y1; ++y)
+		{
+			for (unsigned int x = x0; x < x1; ++x)
+				std::copy(color, color + 3, data + (static_cast<size_t>(y) * width + x) * 3);
+		}
+	}
+
+	return image;
+}
+
+InfoGrid SyntheticCorpus::MakeInfoGrid(const unsigned int& subSamples)
+{
+	const unsigned int clusterCount(8);
+	const double clusterHue(std::floor(Uniform(0.0, clusterCount)) / clusterCount);
+
+	InfoGrid info(subSamples, std::vector<SquareInfo>(subSamples));
+	for (auto& column : info)
+	{
+		for (auto& square : column)
+		{
+			square.hue = std::fmod(clusterHue + Uniform(0.0, 0.1), 1.0);
+			square.saturation = Uniform(0.0, 1.0);
+			square.value = Uniform(0.0, 1.0);
+		}
+	}
+
+	return info;
+}
+
+InfoGrid SyntheticCorpus::MakeSmoothInfoGrid(const unsigned int& subSamples)
+{
+	const unsigned int clusterCount(8);
+	const double hue(std::floor(Uniform(0.0, clusterCount)) / clusterCount + Uniform(0.0, 0.1));
+	const double saturation(Uniform(0.1, 0.9));
+	const double value(Uniform(0.1, 0.9));
+
+	InfoGrid info(subSamples, std::vector<SquareInfo>(subSamples));
+	for (auto& column : info)
+	{
+		for (auto& square : column)
+		{
+			square.hue = std::fmod(hue + Uniform(0.0, 0.02), 1.0);
+			square.saturation = saturation + Uniform(-0.1, 0.1);
+			square.value = value + Uniform(-0.1, 0.1);
+		}
+	}
+
+	return info;
+}
+
+std::vector<uint64_t> SyntheticCorpus::MakeHashes(const unsigned int& count, const unsigned int& maxFlips)
+{
+	std::vector<uint64_t> hashes(count);
+	std::uniform_int_distribution<uint64_t> hashDistribution;
+	std::uniform_int_distribution<unsigned int> bitDistribution(0, 63), flipDistribution(0, maxFlips);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (i % 10 == 9)
+		{
+			hashes[i] = hashes[i - 1];
+			const unsigned int flips(flipDistribution(generator));
+			for (unsigned int j = 0; j < flips; ++j)
+				hashes[i] ^= 1ULL << bitDistribution(generator);
+		}
+		else
+			hashes[i] = hashDistribution(generator);
+	}
+
+	return hashes;
+}
+
+bool SyntheticCorpus::WriteLibrary(const std::string& directory, const unsigned int& count, const unsigned int& width, const unsigned int& height)
+{
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		std::ostringstream fileName;
+		fileName << directory << "/synthetic" << std::setw(7) << std::setfill('0') << i << ".jpg";
+		if (!MakeImage(width, height).SaveFile(fileName.str(), wxBITMAP_TYPE_JPEG))
+		{
+			std::cerr << "Failed to write '" << fileName.str() << "'" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+double SyntheticCorpus::Uniform(const double& low, const double& high)
+{
+	return std::uniform_real_distribution<double>(low, high)(generator);
+}
@@ -0,0 +1,58 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  syntheticCorpus.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Reproducible synthetic images and color information for benchmarking.
+
+#ifndef SYNTHETIC_CORPUS_H_
+#define SYNTHETIC_CORPUS_H_
+
+// Local headers
+#include "colorInfo.h"
+
+// wxWidgets headers
+#include <wx/image.h>
+
+// Standard C++ headers
+#include <random>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything is generated from the seed alone, so the same seed always produces the same corpus
+class SyntheticCorpus
+{
+public:
+	explicit SyntheticCorpus(const unsigned int& seed) : generator(seed) {}
+
+	// Smooth gradients with a few hard-edged shapes and some noise, loosely resembling a photo
+	wxImage MakeImage(const unsigned int& width, const unsigned int& height);
+
+	// Colors are drawn from a handful of clusters, as real libraries tend to have many similar photos
+	InfoGrid MakeInfoGrid(const unsigned int& subSamples);
+
+	// Like MakeInfoGrid(), but the subsamples differ only slightly from one overall color, as they do for
+	// most photos at tile resolution
+	InfoGrid MakeSmoothInfoGrid(const unsigned int& subSamples);
+
+	// Random 64-bit perceptual hashes, where every tenth is a copy of the one before with up to maxFlips bits
+	// changed, as for a library containing some recompressed or resized copies
+	std::vector<uint64_t> MakeHashes(const unsigned int& count, const unsigned int& maxFlips);
+
+	// Writes count JPEG files of the specified size to directory
+	bool WriteLibrary(const std::string& directory, const unsigned int& count, const unsigned int& width, const unsigned int& height);
+
+private:
+	std::mt19937 generator;
+
+	double Uniform(const double& low, const double& high);
+};
+
+#endif// SYNTHETIC_CORPUS_H_
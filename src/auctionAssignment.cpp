@@ -0,0 +1,260 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  auctionAssignment.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Auction algorithm for sparse minimum-cost assignment problems.
+
+// Local headers
+#include "auctionAssignment.h"
+#include "executor.h"
+
+// Standard C++ headers
+#include <algorithm>
+
+const unsigned int AuctionAssignment::unassigned(std::numeric_limits<unsigned int>::max());
+const double AuctionAssignment::relativeEpsilon(1.0e-4);
+const unsigned int AuctionAssignment::minBiddersPerChunk(256);
+
+std::vector<unsigned int> AuctionAssignment::Solve(const std::vector<std::vector<Candidate>>& candidates,
+	const unsigned int& objectCount, const double& unassignedCost)
+{
+	const unsigned int bidderCount(static_cast<unsigned int>(candidates.size()));
+	std::vector<unsigned int> assignment(bidderCount, unassigned);
+	if (bidderCount == 0)
+		return assignment;
+
+	double minCost(unassignedCost);
+	double maxCost(unassignedCost);
+	for (const auto& list : candidates)
+	{
+		for (const auto& c : list)
+		{
+			minCost = std::min(minCost, c.cost);
+			maxCost = std::max(maxCost, c.cost);
+		}
+	}
+
+	const double costRange(std::max(maxCost - minCost, 1.0e-12));
+	const double finalEpsilon(costRange * relativeEpsilon);
+	const double epsilonReduction(5.0);
+
+	std::vector<double> prices(objectCount, 0.0);
+	std::vector<unsigned int> owner(objectCount, unassigned);
+	std::vector<unsigned int> bidders;
+
+	// Each phase starts with no assignments, but keeps the prices from the previous (coarser) phase
+	for (double epsilon = costRange / epsilonReduction; ; epsilon = std::max(epsilon / epsilonReduction, finalEpsilon))
+	{
+		std::fill(assignment.begin(), assignment.end(), unassigned);
+		std::fill(owner.begin(), owner.end(), unassigned);
+		bidders.resize(bidderCount);
+		for (unsigned int i = 0; i < bidderCount; ++i)
+			bidders[i] = i;
+
+		RunAuction(candidates, unassignedCost, epsilon, bidders, prices, owner, assignment);
+		if (epsilon <= finalEpsilon)
+			break;
+	}
+
+	RestorePriceCondition(candidates, unassignedCost, finalEpsilon, prices, owner, assignment);
+
+	return assignment;
+}
+
+// Jacobi-style auction:  all unassigned bidders bid at once (in parallel), then each object goes to its
+// highest bidder, displacing any previous owner
+void AuctionAssignment::RunAuction(const std::vector<std::vector<Candidate>>& candidates, const double& unassignedCost,
+	const double& epsilon, std::vector<unsigned int>& bidders, std::vector<double>& prices,
+	std::vector<unsigned int>& owner, std::vector<unsigned int>& assignment)
+{
+	std::vector<double> bestBid(prices.size());
+	std::vector<unsigned int> bestBidder(prices.size(), unassigned);
+	std::vector<unsigned int> contested;
+	std::vector<unsigned int> nextBidders;
+	std::vector<Bid> bids;
+	while (!bidders.empty())
+	{
+		bids.resize(bidders.size());
+		Executor::GetShared().ParallelForChunks(bidders.size(), [&](const size_t& begin, const size_t& end)
+		{
+			ComputeBids(candidates, prices, bidders, begin, end, unassignedCost, epsilon, bids);
+		}, minBiddersPerChunk);
+
+		contested.clear();
+		nextBidders.clear();
+		for (unsigned int i = 0; i < bidders.size(); ++i)
+		{
+			const Bid& bid(bids[i]);
+			if (bid.object == unassigned)
+				continue;// Bidder prefers to remain unassigned, and since prices only increase, it always will
+
+			if (bestBidder[bid.object] == unassigned)
+			{
+				contested.push_back(bid.object);
+				bestBid[bid.object] = bid.price;
+				bestBidder[bid.object] = bidders[i];
+			}
+			else if (bid.price > bestBid[bid.object])
+			{
+				nextBidders.push_back(bestBidder[bid.object]);
+				bestBid[bid.object] = bid.price;
+				bestBidder[bid.object] = bidders[i];
+			}
+			else
+				nextBidders.push_back(bidders[i]);
+		}
+
+		for (const auto& object : contested)
+		{
+			if (owner[object] != unassigned)
+			{
+				assignment[owner[object]] = unassigned;
+				nextBidders.push_back(owner[object]);
+			}
+
+			owner[object] = bestBidder[object];
+			assignment[bestBidder[object]] = object;
+			prices[object] = bestBid[object];
+			bestBidder[object] = unassigned;
+		}
+
+		bidders.swap(nextBidders);
+	}
+}
+
+// With more objects than bidders, the result is only near-optimal if objects left unassigned are no more
+// expensive than those that are assigned (Bertsekas and Castanon, 1992).  Objects that were assigned in a
+// coarser phase may have been left with inflated prices, so run reverse auction iterations in which each
+// such object either lowers its price or bids for the bidder that values it most.
+void AuctionAssignment::RestorePriceCondition(const std::vector<std::vector<Candidate>>& candidates, const double& unassignedCost,
+	const double& epsilon, std::vector<double>& prices, std::vector<unsigned int>& owner, std::vector<unsigned int>& assignment)
+{
+	struct Interest
+	{
+		unsigned int bidder;
+		double cost;
+	};
+
+	std::vector<std::vector<Interest>> interested(prices.size());
+	std::vector<double> assignedCost(candidates.size(), unassignedCost);
+	for (unsigned int i = 0; i < candidates.size(); ++i)
+	{
+		for (const auto& c : candidates[i])
+		{
+			interested[c.object].push_back(Interest{ i, c.cost });
+			if (c.object == assignment[i])
+				assignedCost[i] = c.cost;
+		}
+	}
+
+	const auto profit([&](const unsigned int& bidder)
+	{
+		if (assignment[bidder] == unassigned)
+			return -unassignedCost;
+		return -assignedCost[bidder] - prices[assignment[bidder]];
+	});
+
+	// Remaining unassigned is like holding a private object with a price of zero
+	double lambda(std::numeric_limits<double>::max());
+	for (unsigned int j = 0; j < prices.size(); ++j)
+	{
+		if (owner[j] != unassigned)
+			lambda = std::min(lambda, prices[j]);
+	}
+
+	if (std::find(assignment.begin(), assignment.end(), unassigned) != assignment.end())
+		lambda = std::min(lambda, 0.0);
+
+	std::vector<unsigned int> overpriced;
+
+	for (unsigned int j = 0; j < prices.size(); ++j)
+	{
+		if (owner[j] == unassigned && prices[j] > lambda)
+			overpriced.push_back(j);
+	}
+
+	while (!overpriced.empty())
+	{
+		const unsigned int object(overpriced.back());
+		overpriced.pop_back();
+
+		double bestValue(-std::numeric_limits<double>::max());
+		double secondValue(-std::numeric_limits<double>::max());
+		unsigned int bestBidder(unassigned);
+		double bestCost(0.0);
+		for (const auto& interest : interested[object])
+		{
+			const double value(-interest.cost - profit(interest.bidder));
+			if (value > bestValue)
+			{
+				secondValue = bestValue;
+				bestValue = value;
+				bestBidder = interest.bidder;
+				bestCost = interest.cost;
+			}
+			else if (value > secondValue)
+				secondValue = value;
+		}
+
+		if (bestBidder == unassigned || lambda >= bestValue - epsilon)
+		{
+			prices[object] = lambda;
+			continue;
+		}
+
+		prices[object] = std::max(lambda, secondValue - epsilon);
+		const unsigned int previousObject(assignment[bestBidder]);
+		if (previousObject != unassigned)
+		{
+			owner[previousObject] = unassigned;
+			if (prices[previousObject] > lambda)
+				overpriced.push_back(previousObject);
+		}
+
+		assignment[bestBidder] = object;
+		assignedCost[bestBidder] = bestCost;
+		owner[object] = bestBidder;
+	}
+}
+
+void AuctionAssignment::ComputeBids(const std::vector<std::vector<Candidate>>& candidates, const std::vector<double>& prices,
+	const std::vector<unsigned int>& bidders, const size_t& begin, const size_t& end,
+	const double& unassignedCost, const double& epsilon, std::vector<Bid>& bids)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		// Values are negative costs net of price, so higher is better
+		double bestValue(-std::numeric_limits<double>::max());
+		double secondValue(-std::numeric_limits<double>::max());
+		unsigned int bestObject(unassigned);
+		for (const auto& c : candidates[bidders[i]])
+		{
+			const double value(-c.cost - prices[c.object]);
+			if (value > bestValue)
+			{
+				secondValue = bestValue;
+				bestValue = value;
+				bestObject = c.object;
+			}
+			else if (value > secondValue)
+				secondValue = value;
+		}
+
+		// Remaining unassigned is always available (and never contested), but loses ties
+		if (-unassignedCost > bestValue)
+			bestObject = unassigned;
+		else
+			secondValue = std::max(secondValue, -unassignedCost);
+
+		bids[i].object = bestObject;
+		if (bestObject != unassigned)
+			bids[i].price = prices[bestObject] + bestValue - secondValue + epsilon;
+	}
+}
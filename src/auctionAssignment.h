@@ -0,0 +1,68 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  auctionAssignment.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Auction algorithm for sparse minimum-cost assignment problems.
+
+#ifndef AUCTION_ASSIGNMENT_H_
+#define AUCTION_ASSIGNMENT_H_
+
+// Standard C++ headers
+#include <vector>
+#include <limits>
+#include <cstddef>
+
+// Assigns each bidder (mosaic tile) to a distinct object (library photo), minimizing the total
+// cost.  Each bidder only considers its own list of candidate objects, so problem size scales
+// with the total number of candidates rather than bidders x objects.
+//
+// Uses Bertsekas' forward auction with epsilon-scaling, with bids computed in parallel (Jacobi
+// style) and conflicts resolved in favor of the highest bid.  Because candidate lists are sparse, the problem may be
+// infeasible (or only feasible at very high prices); to guarantee termination every bidder also has
+// a private "unassigned" option costing unassignedCost.  Bidders which end up unassigned are
+// reported so the caller can retry them with wider candidate lists.  Each bidder's cost is within
+// epsilon (relativeEpsilon times the range of costs) of its best choice at the final prices.
+class AuctionAssignment
+{
+public:
+	static const unsigned int unassigned;
+
+	struct Candidate
+	{
+		unsigned int object;
+		double cost;
+	};
+
+	// Returns the object assigned to each bidder, or unassigned.  unassignedCost must be greater than every
+	// candidate's cost, or bidders may prefer to remain unassigned.
+	static std::vector<unsigned int> Solve(const std::vector<std::vector<Candidate>>& candidates,
+		const unsigned int& objectCount, const double& unassignedCost);
+
+private:
+	static const double relativeEpsilon;
+	static const unsigned int minBiddersPerChunk;
+
+	struct Bid
+	{
+		unsigned int object;
+		double price;
+	};
+
+	static void RunAuction(const std::vector<std::vector<Candidate>>& candidates, const double& unassignedCost,
+		const double& epsilon, std::vector<unsigned int>& bidders, std::vector<double>& prices,
+		std::vector<unsigned int>& owner, std::vector<unsigned int>& assignment);
+	static void RestorePriceCondition(const std::vector<std::vector<Candidate>>& candidates, const double& unassignedCost,
+		const double& epsilon, std::vector<double>& prices, std::vector<unsigned int>& owner, std::vector<unsigned int>& assignment);
+	static void ComputeBids(const std::vector<std::vector<Candidate>>& candidates, const std::vector<double>& prices,
+		const std::vector<unsigned int>& bidders, const size_t& begin, const size_t& end,
+		const double& unassignedCost, const double& epsilon, std::vector<Bid>& bids);
+};
+
+#endif// AUCTION_ASSIGNMENT_H_
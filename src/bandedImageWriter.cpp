@@ -0,0 +1,426 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  bandedImageWriter.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Scanline image encoders which accept an image a few rows at a time, so the
+//        full frame never needs to be held in memory.
+
+// Local headers
+#include "bandedImageWriter.h"
+
+// Standard C++ headers
+#include <cstdio>
+#include <csetjmp>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+
+#ifdef HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif// HAVE_LIBJPEG
+
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#endif// HAVE_LIBPNG
+
+namespace
+{
+
+#ifdef HAVE_LIBJPEG
+class JpegWriter : public BandedImageWriter
+{
+public:
+	~JpegWriter();
+
+	bool Open(const std::string& fileName, const unsigned int& width, const unsigned int& height) override;
+	bool WriteRows(const unsigned char* data, const unsigned int& rowCount) override;
+	bool Close() override;
+
+private:
+	static const int quality = 75;// Same as the wxWidgets default
+
+	struct ErrorManager
+	{
+		jpeg_error_mgr base;
+		jmp_buf jumpBuffer;
+	};
+
+	jpeg_compress_struct info;
+	ErrorManager error;
+	FILE* file = nullptr;
+	bool started = false;
+	unsigned int width = 0;
+
+	static void HandleError(j_common_ptr info);
+	void Abort();
+};
+
+JpegWriter::~JpegWriter()
+{
+	Abort();
+}
+
+void JpegWriter::HandleError(j_common_ptr info)
+{
+	char message[JMSG_LENGTH_MAX];
+	(*info->err->format_message)(info, message);
+	std::cerr << "JPEG encoder error:  " << message << std::endl;
+	longjmp(reinterpret_cast<ErrorManager*>(info->err)->jumpBuffer, 1);
+}
+
+void JpegWriter::Abort()
+{
+	if (started)
+		jpeg_destroy_compress(&info);
+	started = false;
+
+	if (file)
+		fclose(file);
+	file = nullptr;
+}
+
+bool JpegWriter::Open(const std::string& fileName, const unsigned int& width, const unsigned int& height)
+{
+	file = fopen(fileName.c_str(), "wb");
+	if (!file)
+	{
+		std::cerr << "Failed to open '" << fileName << "' for output" << std::endl;
+		return false;
+	}
+
+	this->width = width;
+	info.err = jpeg_std_error(&error.base);
+	error.base.error_exit = &HandleError;
+	if (setjmp(error.jumpBuffer))
+	{
+		Abort();
+		return false;
+	}
+
+	jpeg_create_compress(&info);
+	started = true;
+	jpeg_stdio_dest(&info, file);
+	info.image_width = width;
+	info.image_height = height;
+	info.input_components = 3;
+	info.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, quality, TRUE);
+	jpeg_start_compress(&info, TRUE);
+	return true;
+}
+
+bool JpegWriter::WriteRows(const unsigned char* data, const unsigned int& rowCount)
+{
+	if (setjmp(error.jumpBuffer))
+	{
+		Abort();
+		return false;
+	}
+
+	for (unsigned int i = 0; i < rowCount; ++i)
+	{
+		JSAMPROW row(const_cast<JSAMPROW>(data + static_cast<size_t>(i) * width * 3));
+		jpeg_write_scanlines(&info, &row, 1);
+	}
+
+	return true;
+}
+
+bool JpegWriter::Close()
+{
+	if (!started)
+		return false;
+
+	if (setjmp(error.jumpBuffer))
+	{
+		Abort();
+		return false;
+	}
+
+	jpeg_finish_compress(&info);
+	jpeg_destroy_compress(&info);
+	started = false;
+
+	const bool ok(fclose(file) == 0);
+	file = nullptr;
+	return ok;
+}
+#endif// HAVE_LIBJPEG
+
+#ifdef HAVE_LIBPNG
+class PngWriter : public BandedImageWriter
+{
+public:
+	~PngWriter();
+
+	bool Open(const std::string& fileName, const unsigned int& width, const unsigned int& height) override;
+	bool WriteRows(const unsigned char* data, const unsigned int& rowCount) override;
+	bool Close() override;
+
+private:
+	png_structp png = nullptr;
+	png_infop info = nullptr;
+	FILE* file = nullptr;
+	unsigned int width = 0;
+
+	void Abort();
+};
+
+PngWriter::~PngWriter()
+{
+	Abort();
+}
+
+void PngWriter::Abort()
+{
+	if (png)
+		png_destroy_write_struct(&png, info ? &info : nullptr);
+	png = nullptr;
+	info = nullptr;
+
+	if (file)
+		fclose(file);
+	file = nullptr;
+}
+
+bool PngWriter::Open(const std::string& fileName, const unsigned int& width, const unsigned int& height)
+{
+	file = fopen(fileName.c_str(), "wb");
+	if (!file)
+	{
+		std::cerr << "Failed to open '" << fileName << "' for output" << std::endl;
+		return false;
+	}
+
+	this->width = width;
+	png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if (png)
+		info = png_create_info_struct(png);
+	if (!info)
+	{
+		Abort();
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(png)))
+	{
+		Abort();
+		return false;
+	}
+
+	png_init_io(png, file);
+	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+	return true;
+}
+
+bool PngWriter::WriteRows(const unsigned char* data, const unsigned int& rowCount)
+{
+	if (setjmp(png_jmpbuf(png)))
+	{
+		Abort();
+		return false;
+	}
+
+	for (unsigned int i = 0; i < rowCount; ++i)
+		png_write_row(png, data + static_cast<size_t>(i) * width * 3);
+
+	return true;
+}
+
+bool PngWriter::Close()
+{
+	if (!png)
+		return false;
+
+	if (setjmp(png_jmpbuf(png)))
+	{
+		Abort();
+		return false;
+	}
+
+	png_write_end(png, nullptr);
+	png_destroy_write_struct(&png, &info);
+	png = nullptr;
+	info = nullptr;
+
+	const bool ok(fclose(file) == 0);
+	file = nullptr;
+	return ok;
+}
+#endif// HAVE_LIBPNG
+
+// Baseline uncompressed TIFF, written without any library:  header, then the pixel data as a
+// single strip, then the image file directory.  Since the size of the pixel data is known up
+// front, everything can be written in order.
+class TiffWriter : public BandedImageWriter
+{
+public:
+	~TiffWriter();
+
+	bool Open(const std::string& fileName, const unsigned int& width, const unsigned int& height) override;
+	bool WriteRows(const unsigned char* data, const unsigned int& rowCount) override;
+	bool Close() override;
+
+private:
+	FILE* file = nullptr;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	uint32_t dataSize = 0;
+
+	std::vector<unsigned char> buffer;
+
+	void Append16(const uint16_t& v);
+	void Append32(const uint32_t& v);
+	void AppendEntry(const uint16_t& tag, const uint16_t& type, const uint32_t& count, const uint32_t& value);
+};
+
+TiffWriter::~TiffWriter()
+{
+	if (file)
+		fclose(file);
+}
+
+// TIFF files specify their byte order, so we always write little-endian regardless of the host
+void TiffWriter::Append16(const uint16_t& v)
+{
+	buffer.push_back(static_cast<unsigned char>(v & 0xff));
+	buffer.push_back(static_cast<unsigned char>(v >> 8));
+}
+
+void TiffWriter::Append32(const uint32_t& v)
+{
+	Append16(static_cast<uint16_t>(v & 0xffff));
+	Append16(static_cast<uint16_t>(v >> 16));
+}
+
+void TiffWriter::AppendEntry(const uint16_t& tag, const uint16_t& type, const uint32_t& count, const uint32_t& value)
+{
+	Append16(tag);
+	Append16(type);
+	Append32(count);
+	if (type == 3 && count == 1)// SHORT values are left-justified in the value field
+	{
+		Append16(static_cast<uint16_t>(value));
+		Append16(0);
+	}
+	else
+		Append32(value);
+}
+
+bool TiffWriter::Open(const std::string& fileName, const unsigned int& width, const unsigned int& height)
+{
+	const uint64_t size(static_cast<uint64_t>(width) * height * 3);
+	if (size + 1024 > UINT32_MAX)
+	{
+		std::cerr << "Image is too large for TIFF output; use JPEG or PNG instead" << std::endl;
+		return false;
+	}
+
+	file = fopen(fileName.c_str(), "wb");
+	if (!file)
+	{
+		std::cerr << "Failed to open '" << fileName << "' for output" << std::endl;
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+	dataSize = static_cast<uint32_t>(size);
+
+	buffer.clear();
+	buffer.push_back('I');
+	buffer.push_back('I');
+	Append16(42);
+	Append32(8 + dataSize + (dataSize % 2));// IFD offset (word aligned)
+	return fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+}
+
+bool TiffWriter::WriteRows(const unsigned char* data, const unsigned int& rowCount)
+{
+	const size_t bytes(static_cast<size_t>(width) * rowCount * 3);
+	return fwrite(data, 1, bytes, file) == bytes;
+}
+
+bool TiffWriter::Close()
+{
+	if (!file)
+		return false;
+
+	const uint32_t ifdOffset(8 + dataSize + (dataSize % 2));
+	const uint16_t entryCount(13);
+	const uint32_t extraOffset(ifdOffset + 2 + entryCount * 12 + 4);// Out-of-line values follow the IFD
+	const uint32_t bitsPerSampleOffset(extraOffset);
+	const uint32_t resolutionOffset(extraOffset + 6);
+
+	buffer.clear();
+	if (dataSize % 2 != 0)
+		buffer.push_back(0);
+
+	const uint16_t shortType(3), longType(4), rationalType(5);
+	Append16(entryCount);
+	AppendEntry(256, longType, 1, width);// ImageWidth
+	AppendEntry(257, longType, 1, height);// ImageLength
+	AppendEntry(258, shortType, 3, bitsPerSampleOffset);// BitsPerSample
+	AppendEntry(259, shortType, 1, 1);// Compression = none
+	AppendEntry(262, shortType, 1, 2);// PhotometricInterpretation = RGB
+	AppendEntry(273, longType, 1, 8);// StripOffsets
+	AppendEntry(277, shortType, 1, 3);// SamplesPerPixel
+	AppendEntry(278, longType, 1, height);// RowsPerStrip
+	AppendEntry(279, longType, 1, dataSize);// StripByteCounts
+	AppendEntry(282, rationalType, 1, resolutionOffset);// XResolution
+	AppendEntry(283, rationalType, 1, resolutionOffset);// YResolution
+	AppendEntry(284, shortType, 1, 1);// PlanarConfiguration = chunky
+	AppendEntry(296, shortType, 1, 2);// ResolutionUnit = inch
+	Append32(0);// No more IFDs
+
+	Append16(8);
+	Append16(8);
+	Append16(8);
+	Append32(72);
+	Append32(1);
+
+	const bool ok(fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size());
+	const bool closed(fclose(file) == 0);
+	file = nullptr;
+	return ok && closed;
+}
+
+}
+
+std::unique_ptr<BandedImageWriter> BandedImageWriter::Create(const std::string& fileName)
+{
+	const auto dot(fileName.find_last_of('.'));
+	std::string extension(dot == std::string::npos ? std::string() : fileName.substr(dot + 1));
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](const char& c)
+	{
+		return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	});
+
+#ifdef HAVE_LIBJPEG
+	if (extension == "jpg" || extension == "jpeg")
+		return std::make_unique<JpegWriter>();
+#endif// HAVE_LIBJPEG
+
+#ifdef HAVE_LIBPNG
+	if (extension == "png")
+		return std::make_unique<PngWriter>();
+#endif// HAVE_LIBPNG
+
+	if (extension == "tif" || extension == "tiff")
+		return std::make_unique<TiffWriter>();
+
+	std::cerr << "Banded output is not supported for '." << extension << "' files" << std::endl;
+	return nullptr;
+}
@@ -0,0 +1,37 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  bandedImageWriter.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Scanline image encoders which accept an image a few rows at a time, so the
+//        full frame never needs to be held in memory.
+
+#ifndef BANDED_IMAGE_WRITER_H_
+#define BANDED_IMAGE_WRITER_H_
+
+// Standard C++ headers
+#include <string>
+#include <memory>
+
+class BandedImageWriter
+{
+public:
+	virtual ~BandedImageWriter() = default;
+
+	// Chooses the encoder based on the file extension; returns nullptr if the format is not supported
+	static std::unique_ptr<BandedImageWriter> Create(const std::string& fileName);
+
+	virtual bool Open(const std::string& fileName, const unsigned int& width, const unsigned int& height) = 0;
+
+	// Data is packed 8-bit RGB rows, top to bottom, with no padding between rows
+	virtual bool WriteRows(const unsigned char* data, const unsigned int& rowCount) = 0;
+	virtual bool Close() = 0;
+};
+
+#endif// BANDED_IMAGE_WRITER_H_
@@ -0,0 +1,100 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  batchManifest.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  List of mosaics to build from a single library.
+
+// Local headers
+#include "batchManifest.h"
+
+// Standard C++ headers
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+
+bool BatchManifest::Read(const std::string& fileName, const PhotomosaicConfig& libraryConfig, std::vector<PhotomosaicConfig>& targets)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open batch manifest '" << fileName << "'" << std::endl;
+		return false;
+	}
+
+	targets.clear();
+	bool ok(true);
+	std::string line;
+	for (unsigned int lineNumber = 1; std::getline(file, line); ++lineNumber)
+	{
+		std::istringstream ss(line);
+		std::string targetImageFileName;
+		if (!(ss >> std::quoted(targetImageFileName)) || (!targetImageFileName.empty() && targetImageFileName.front() == '#'))
+			continue;
+
+		if (targetImageFileName.empty())
+		{
+			std::cerr << fileName << ':' << lineNumber << ":  Missing target image file name" << std::endl;
+			ok = false;
+			continue;
+		}
+
+		PhotomosaicConfig config(libraryConfig);
+		config.targetImageFileName = targetImageFileName;
+		if (!(ss >> std::quoted(config.outputFileName)) || config.outputFileName.empty())
+		{
+			std::cerr << fileName << ':' << lineNumber << ":  Missing output file name" << std::endl;
+			ok = false;
+			continue;
+		}
+
+		std::string setting;
+		while (ss >> setting)
+		{
+			const std::string::size_type equals(setting.find('='));
+			if (equals == std::string::npos || !ApplyOverride(setting.substr(0, equals), setting.substr(equals + 1), config))
+			{
+				std::cerr << fileName << ':' << lineNumber << ":  Invalid setting '" << setting << "'" << std::endl;
+				ok = false;
+			}
+		}
+
+		targets.push_back(config);
+	}
+
+	if (ok && targets.empty())
+	{
+		std::cerr << "Batch manifest '" << fileName << "' contains no targets" << std::endl;
+		return false;
+	}
+
+	return ok;
+}
+
+bool BatchManifest::ApplyOverride(const std::string& key, const std::string& value, PhotomosaicConfig& config)
+{
+	if (key == "SUBDIVISION_SIZE")
+		return Parse(value, config.subDivisionSize) && config.subDivisionSize > 0;
+	else if (key == "HUE_WEIGHT")
+		return Parse(value, config.hueErrorWeight) && config.hueErrorWeight >= 0.0;
+	else if (key == "SAT_WEIGHT")
+		return Parse(value, config.saturationErrorWeight) && config.saturationErrorWeight >= 0.0;
+	else if (key == "VAL_WEIGHT")
+		return Parse(value, config.valueErrorWeight) && config.valueErrorWeight >= 0.0;
+
+	return false;
+}
+
+template<typename T>
+bool BatchManifest::Parse(const std::string& value, T& t)
+{
+	std::istringstream ss(value);
+	return (ss >> t) && ss.eof();
+}
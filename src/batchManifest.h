@@ -0,0 +1,44 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  batchManifest.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  List of mosaics to build from a single library.
+
+#ifndef BATCH_MANIFEST_H_
+#define BATCH_MANIFEST_H_
+
+// Local headers
+#include "photomosaicConfig.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+
+// Each line names a target image and an output file, optionally followed by overrides of the
+// configuration file's settings, for example:
+//   sunset.jpg sunset-mosaic.jpg SUBDIVISION_SIZE=12 HUE_WEIGHT=2
+// Names containing spaces may be quoted.  Blank lines and lines beginning with # are ignored.  Only
+// settings which don't affect the library (and so can differ from one mosaic to the next) may be
+// overridden:  SUBDIVISION_SIZE, HUE_WEIGHT, SAT_WEIGHT and VAL_WEIGHT.
+class BatchManifest
+{
+public:
+	static bool Read(const std::string& fileName, const PhotomosaicConfig& libraryConfig, std::vector<PhotomosaicConfig>& targets);
+
+	// Returns false for keys which can't be overridden, or invalid values
+	static bool ApplyOverride(const std::string& key, const std::string& value, PhotomosaicConfig& config);
+
+private:
+
+	template<typename T>
+	static bool Parse(const std::string& value, T& t);
+};
+
+#endif// BATCH_MANIFEST_H_
@@ -0,0 +1,29 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  colorInfo.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Color information types shared between the photomosaic modules.
+
+#ifndef COLOR_INFO_H_
+#define COLOR_INFO_H_
+
+// Standard C++ headers
+#include <vector>
+
+struct SquareInfo
+{
+	double hue;
+	double saturation;
+	double value;
+};
+
+typedef std::vector<std::vector<SquareInfo>> InfoGrid;
+
+#endif// COLOR_INFO_H_
@@ -0,0 +1,163 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  colorStatistics.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Table-driven computation of average HSV color directly from packed RGB buffers.
+
+// Local headers
+#include "colorStatistics.h"
+
+// Standard C++ headers
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+const double pi(3.14159265358979323846);
+}
+
+// Photomosaic::RGBToHSV() takes (red, blue, green) but is called with (red, green, blue), so the
+// hue it computes is mirrored relative to the usual convention.  Distances between hues are
+// unaffected, but we reproduce it here so the two implementations agree.  In terms of the
+// actual pixel components, the hue angle is pi / 3 * (h + 1), where
+//   max == R:  h = (B - G) / chroma
+//   max == B:  h = (G - R) / chroma + 2
+//   max == G:  h = (R - B) / chroma + 4
+// (checked in that order).  Each case is a sector center (pi / 3, pi or 5 * pi / 3) plus an offset
+// of at most pi / 3 which depends only on the integers delta and chroma, so the trig can be
+// tabulated and the sector rotation applied with a few multiplications.
+ColorStatistics::Tables::Tables()
+{
+	const unsigned int triangleSize(256 * 257 / 2);
+	cosOffset.resize(triangleSize);
+	sinOffset.resize(triangleSize);
+	saturation.resize(triangleSize);
+
+	for (unsigned int chroma = 0; chroma < 256; ++chroma)
+	{
+		for (unsigned int delta = 0; delta <= chroma; ++delta)
+		{
+			const double angle(chroma == 0 ? 0.0 : static_cast<double>(delta) / chroma * pi / 3.0);
+			cosOffset[chroma * (chroma + 1) / 2 + delta] = cos(angle);
+			sinOffset[chroma * (chroma + 1) / 2 + delta] = sin(angle);
+		}
+	}
+
+	// Same operations as RGBToHSV() so the per-pixel values are identical
+	for (unsigned int maxColor = 0; maxColor < 256; ++maxColor)
+	{
+		for (unsigned int chroma = 0; chroma <= maxColor; ++chroma)
+		{
+			const double maxValue(maxColor / 255.0);
+			const double chromaValue(maxValue - (maxColor - chroma) / 255.0);
+			saturation[maxColor * (maxColor + 1) / 2 + chroma] = maxColor == 0 ? 0.0 : chromaValue / maxValue;
+		}
+	}
+
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		sectorCos[i] = cos((2 * i + 1) * pi / 3.0);
+		sectorSin[i] = sin((2 * i + 1) * pi / 3.0);
+	}
+}
+
+const ColorStatistics::Tables& ColorStatistics::GetTables()
+{
+	static const Tables tables;// Thread-safe initialization
+	return tables;
+}
+
+ColorStatistics::PixelStatistics ColorStatistics::ComputePixel(const unsigned char* rgb)
+{
+	const Tables& tables(GetTables());
+	const int red(rgb[0]);
+	const int green(rgb[1]);
+	const int blue(rgb[2]);
+	const int maxColor(std::max(std::max(red, green), blue));
+	const int chroma(maxColor - std::min(std::min(red, green), blue));
+
+	int delta;
+	unsigned int sector;
+	if (maxColor == red)
+	{
+		delta = blue - green;
+		sector = 0;
+	}
+	else if (maxColor == blue)
+	{
+		delta = green - red;
+		sector = 1;
+	}
+	else
+	{
+		delta = red - blue;
+		sector = 2;
+	}
+
+	const unsigned int offsetIndex(chroma * (chroma + 1) / 2 + std::abs(delta));
+	const double cosOffset(tables.cosOffset[offsetIndex]);
+	const double sinOffset(delta < 0 ? -tables.sinOffset[offsetIndex] : tables.sinOffset[offsetIndex]);
+
+	PixelStatistics p;
+	p.hueX = tables.sectorCos[sector] * cosOffset - tables.sectorSin[sector] * sinOffset;
+	p.hueY = tables.sectorSin[sector] * cosOffset + tables.sectorCos[sector] * sinOffset;
+	p.saturation = tables.saturation[maxColor * (maxColor + 1) / 2 + chroma];
+	p.value = maxColor;
+	return p;
+}
+
+void ColorStatistics::Accumulate(const unsigned char* data, const unsigned int& stride, const unsigned int& x0,
+	const unsigned int& y0, const unsigned int& width, const unsigned int& height, Accumulator& accumulator)
+{
+	for (unsigned int y = y0; y < y0 + height; ++y)
+	{
+		const unsigned char* pixel(data + static_cast<size_t>(y) * stride + x0 * 3);
+		for (unsigned int x = 0; x < width; ++x, pixel += 3)
+		{
+			const PixelStatistics p(ComputePixel(pixel));
+			accumulator.hueX += p.hueX;
+			accumulator.hueY += p.hueY;
+			accumulator.saturation += p.saturation;
+			accumulator.value += p.value;
+		}
+	}
+
+	accumulator.count += width * height;
+}
+
+void ColorStatistics::ComputeInfoGrid(const unsigned char* data, const unsigned int& stride, const unsigned int& x0,
+	const unsigned int& y0, const unsigned int& size, const unsigned int& subSamples, InfoGrid& info)
+{
+	if (info.size() != subSamples)
+		info.resize(subSamples);
+
+	const unsigned int sampleDimension(size / subSamples);
+	for (unsigned int x = 0; x < subSamples; ++x)
+	{
+		if (info[x].size() != subSamples)
+			info[x].resize(subSamples);
+
+		for (unsigned int y = 0; y < subSamples; ++y)
+		{
+			Accumulator accumulator;
+			Accumulate(data, stride, x0 + x * sampleDimension, y0 + y * sampleDimension, sampleDimension, sampleDimension, accumulator);
+			info[x][y] = accumulator.GetAverage();
+		}
+	}
+}
+
+SquareInfo ColorStatistics::Accumulator::GetAverage() const
+{
+	SquareInfo si;
+	si.hue = atan2(hueY, hueX) / 2.0 / pi;
+	si.saturation = saturation / count;
+	si.value = value / 255.0 / count;
+	return si;
+}
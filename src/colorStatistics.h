@@ -0,0 +1,81 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  colorStatistics.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Table-driven computation of average HSV color directly from packed RGB buffers.
+
+#ifndef COLOR_STATISTICS_H_
+#define COLOR_STATISTICS_H_
+
+// Local headers
+#include "colorInfo.h"
+
+// Standard C++ headers
+#include <vector>
+#include <cstdint>
+
+class ColorStatistics
+{
+public:
+	// Running sums from which an average color can be computed.  Hue is averaged as a unit vector so
+	// that hues on either side of the wrap point average correctly.
+	struct Accumulator
+	{
+		double hueX = 0.0;
+		double hueY = 0.0;
+		double saturation = 0.0;
+		uint64_t value = 0;// Sum of max(R, G, B); scaled to [0, 1] in GetAverage()
+		unsigned int count = 0;
+
+		SquareInfo GetAverage() const;
+	};
+
+	// Contribution of a single pixel to an Accumulator
+	struct PixelStatistics
+	{
+		double hueX;
+		double hueY;
+		double saturation;
+		unsigned int value;
+	};
+
+	static PixelStatistics ComputePixel(const unsigned char* rgb);
+
+	// Data is packed 8-bit RGB, with stride bytes between rows
+	static void Accumulate(const unsigned char* data, const unsigned int& stride, const unsigned int& x0,
+		const unsigned int& y0, const unsigned int& width, const unsigned int& height, Accumulator& accumulator);
+
+	// Divides the size x size square at (x0, y0) into subSamples x subSamples regions (as
+	// Photomosaic::GetColorInformation() does) and computes the average color of each.  info
+	// is only reallocated if it isn't already the correct size.
+	static void ComputeInfoGrid(const unsigned char* data, const unsigned int& stride, const unsigned int& x0,
+		const unsigned int& y0, const unsigned int& size, const unsigned int& subSamples, InfoGrid& info);
+
+private:
+	struct Tables
+	{
+		Tables();
+
+		// Indexed by chroma * (chroma + 1) / 2 + |delta|, where delta is the numerator of the
+		// hue fraction within a sector.  Holds cos and sin of the angle offset from the sector center.
+		std::vector<double> cosOffset;
+		std::vector<double> sinOffset;
+
+		// Indexed by max * (max + 1) / 2 + chroma
+		std::vector<double> saturation;
+
+		double sectorCos[3];
+		double sectorSin[3];
+	};
+
+	static const Tables& GetTables();
+};
+
+#endif// COLOR_STATISTICS_H_
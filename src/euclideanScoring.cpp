@@ -0,0 +1,304 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  euclideanScoring.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Scoring by squared Euclidean distance in CIELAB or YCbCr, as a blocked matrix product.
+
+// Local headers
+#include "euclideanScoring.h"
+
+// Standard C++ headers
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHOTOMOSAIC_X86
+#include <immintrin.h>
+#endif
+
+// See scoringKernel.cpp
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+EuclideanFeatures::EuclideanFeatures(const Space& space, const double& lightnessWeight, const double& chromaWeight)
+	: space(space), lightnessScale(std::sqrt(lightnessWeight)), chromaScale(std::sqrt(chromaWeight))
+{
+}
+
+std::vector<float> EuclideanFeatures::Convert(const InfoGrid& square) const
+{
+	std::vector<float> features(square.size() * square.size() * 3);
+	float* components(features.data());
+	for (const auto& column : square)
+	{
+		for (const auto& s : column)
+		{
+			ConvertColor(s, components);
+			components += 3;
+		}
+	}
+
+	return features;
+}
+
+// See ColorStatistics for the hue convention:  the usual hue angle is 60 deg minus this one
+void EuclideanFeatures::ConvertColor(const SquareInfo& color, float* components) const
+{
+	const double turns(1.0 / 6.0 - color.hue);
+	const double sector((turns - std::floor(turns)) * 6.0);
+	const double chroma(color.value * color.saturation);
+	const double x(chroma * (1.0 - std::fabs(std::fmod(sector, 2.0) - 1.0)));
+	const double m(color.value - chroma);
+
+	double red(m), green(m), blue(m);
+	switch (static_cast<int>(sector))
+	{
+	case 0: red += chroma; green += x; break;
+	case 1: red += x; green += chroma; break;
+	case 2: green += chroma; blue += x; break;
+	case 3: green += x; blue += chroma; break;
+	case 4: red += x; blue += chroma; break;
+	default: red += chroma; blue += x; break;
+	}
+
+	double lightness, chroma1, chroma2;
+	if (space == Space::YCbCr)// ITU-R BT.601, full range
+	{
+		lightness = 0.299 * red + 0.587 * green + 0.114 * blue;
+		chroma1 = -0.168736 * red - 0.331264 * green + 0.5 * blue;
+		chroma2 = 0.5 * red - 0.418688 * green - 0.081312 * blue;
+	}
+	else// sRGB to CIELAB, D65 white
+	{
+		const auto linearize([](const double& c)
+		{
+			return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+		});
+		const double r(linearize(red)), g(linearize(green)), b(linearize(blue));
+
+		const auto f([](const double& t)
+		{
+			const double delta(6.0 / 29.0);
+			return t > delta * delta * delta ? std::cbrt(t) : t / (3.0 * delta * delta) + 4.0 / 29.0;
+		});
+		const double fx(f((0.4124 * r + 0.3576 * g + 0.1805 * b) / 0.95047));
+		const double fy(f(0.2126 * r + 0.7152 * g + 0.0722 * b));
+		const double fz(f((0.0193 * r + 0.1192 * g + 0.9505 * b) / 1.08883));
+
+		lightness = (116.0 * fy - 16.0) / 100.0;
+		chroma1 = 5.0 * (fx - fy);
+		chroma2 = 2.0 * (fy - fz);
+	}
+
+	components[0] = static_cast<float>(lightness * lightnessScale);
+	components[1] = static_cast<float>(chroma1 * chromaScale);
+	components[2] = static_cast<float>(chroma2 * chromaScale);
+}
+
+double EuclideanFeatures::GetDistance(const std::vector<float>& a, const std::vector<float>& b)
+{
+	assert(a.size() == b.size());
+	double distance(0.0);
+	for (unsigned int i = 0; i < a.size(); ++i)
+	{
+		const double difference(static_cast<double>(a[i]) - b[i]);
+		distance += difference * difference;
+	}
+
+	return distance;
+}
+
+const char* EuclideanFeatures::GetName(const Space& space)
+{
+	switch (space)
+	{
+	case Space::Lab:
+		return "CIELAB";
+
+	default:
+		return "YCbCr";
+	}
+}
+
+void EuclideanPlanes::Build(const std::vector<const InfoGrid*>& thumbnails, const EuclideanFeatures& features)
+{
+	count = static_cast<unsigned int>(thumbnails.size());
+	paddedCount = (count + padding - 1) / padding * padding;
+	dimension = thumbnails.empty() ? 0 : static_cast<unsigned int>(thumbnails.front()->size() * thumbnails.front()->size() * 3);
+	data.assign(static_cast<size_t>(dimension + 1) * paddedCount, 0.0f);
+
+	float* norms(data.data() + dimension * paddedCount);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const std::vector<float> components(features.Convert(*thumbnails[i]));
+		for (unsigned int d = 0; d < dimension; ++d)
+		{
+			data[d * paddedCount + i] = components[d];
+			norms[i] += components[d] * components[d];
+		}
+	}
+}
+
+namespace
+{
+
+// targets holds rows rounded up to a multiple of EuclideanKernel::targetBlockSize (the extra entries repeat
+// the last target), but only the first rows results are stored
+void ScoreScalar(const float* const* targets, const float* targetNorms, const unsigned int& rows, const EuclideanPlanes& planes,
+	const unsigned int& begin, const unsigned int& count, float* scores, const size_t& stride)
+{
+	for (unsigned int r = 0; r < rows; ++r)
+	{
+		float* rowScores(scores + r * stride);
+		std::fill(rowScores, rowScores + count, 0.0f);
+		for (unsigned int d = 0; d < planes.GetDimension(); ++d)
+		{
+			const float component(targets[r][d]);
+			const float* plane(planes.GetPlane(d) + begin);
+			for (unsigned int i = 0; i < count; ++i)
+				rowScores[i] += component * plane[i];
+		}
+
+		const float* norms(planes.GetNorms() + begin);
+		for (unsigned int i = 0; i < count; ++i)
+			rowScores[i] = std::max(0.0f, targetNorms[r] + norms[i] - 2.0f * rowScores[i]);
+	}
+}
+
+#ifdef PHOTOMOSAIC_X86
+
+TARGET_AVX2
+inline void StoreAVX2(const __m256& dot, const float& targetNorm, const __m256& norms, float* scores)
+{
+	const __m256 distance(_mm256_fnmadd_ps(_mm256_set1_ps(2.0f), dot, _mm256_add_ps(_mm256_set1_ps(targetNorm), norms)));
+	_mm256_storeu_ps(scores, _mm256_max_ps(distance, _mm256_setzero_ps()));
+}
+
+TARGET_AVX2
+void ScoreAVX2(const float* const* targets, const float* targetNorms, const unsigned int& rows, const EuclideanPlanes& planes,
+	const unsigned int& begin, const unsigned int& count, float* scores, const size_t& stride)
+{
+	for (unsigned int i = 0; i < count; i += 16)
+	{
+		const __m256 norms0(_mm256_loadu_ps(planes.GetNorms() + begin + i));
+		const __m256 norms1(_mm256_loadu_ps(planes.GetNorms() + begin + i + 8));
+		for (unsigned int r = 0; r < rows; r += 4)
+		{
+			__m256 dot00(_mm256_setzero_ps()), dot01(_mm256_setzero_ps());
+			__m256 dot10(_mm256_setzero_ps()), dot11(_mm256_setzero_ps());
+			__m256 dot20(_mm256_setzero_ps()), dot21(_mm256_setzero_ps());
+			__m256 dot30(_mm256_setzero_ps()), dot31(_mm256_setzero_ps());
+			for (unsigned int d = 0; d < planes.GetDimension(); ++d)
+			{
+				const __m256 thumbnail0(_mm256_loadu_ps(planes.GetPlane(d) + begin + i));
+				const __m256 thumbnail1(_mm256_loadu_ps(planes.GetPlane(d) + begin + i + 8));
+				const __m256 target0(_mm256_set1_ps(targets[r][d]));
+				const __m256 target1(_mm256_set1_ps(targets[r + 1][d]));
+				const __m256 target2(_mm256_set1_ps(targets[r + 2][d]));
+				const __m256 target3(_mm256_set1_ps(targets[r + 3][d]));
+				dot00 = _mm256_fmadd_ps(target0, thumbnail0, dot00);
+				dot01 = _mm256_fmadd_ps(target0, thumbnail1, dot01);
+				dot10 = _mm256_fmadd_ps(target1, thumbnail0, dot10);
+				dot11 = _mm256_fmadd_ps(target1, thumbnail1, dot11);
+				dot20 = _mm256_fmadd_ps(target2, thumbnail0, dot20);
+				dot21 = _mm256_fmadd_ps(target2, thumbnail1, dot21);
+				dot30 = _mm256_fmadd_ps(target3, thumbnail0, dot30);
+				dot31 = _mm256_fmadd_ps(target3, thumbnail1, dot31);
+			}
+
+			const __m256 dots[4][2] = { { dot00, dot01 }, { dot10, dot11 }, { dot20, dot21 }, { dot30, dot31 } };
+			for (unsigned int t = 0; t < 4 && r + t < rows; ++t)
+			{
+				StoreAVX2(dots[t][0], targetNorms[r + t], norms0, scores + (r + t) * stride + i);
+				StoreAVX2(dots[t][1], targetNorms[r + t], norms1, scores + (r + t) * stride + i + 8);
+			}
+		}
+	}
+}
+
+TARGET_AVX512
+void ScoreAVX512(const float* const* targets, const float* targetNorms, const unsigned int& rows, const EuclideanPlanes& planes,
+	const unsigned int& begin, const unsigned int& count, float* scores, const size_t& stride)
+{
+	for (unsigned int i = 0; i < count; i += 16)
+	{
+		const __m512 norms(_mm512_loadu_ps(planes.GetNorms() + begin + i));
+		for (unsigned int r = 0; r < rows; r += 4)
+		{
+			__m512 dot0(_mm512_setzero_ps()), dot1(_mm512_setzero_ps()), dot2(_mm512_setzero_ps()), dot3(_mm512_setzero_ps());
+			for (unsigned int d = 0; d < planes.GetDimension(); ++d)
+			{
+				const __m512 thumbnail(_mm512_loadu_ps(planes.GetPlane(d) + begin + i));
+				dot0 = _mm512_fmadd_ps(_mm512_set1_ps(targets[r][d]), thumbnail, dot0);
+				dot1 = _mm512_fmadd_ps(_mm512_set1_ps(targets[r + 1][d]), thumbnail, dot1);
+				dot2 = _mm512_fmadd_ps(_mm512_set1_ps(targets[r + 2][d]), thumbnail, dot2);
+				dot3 = _mm512_fmadd_ps(_mm512_set1_ps(targets[r + 3][d]), thumbnail, dot3);
+			}
+
+			const __m512 dots[4] = { dot0, dot1, dot2, dot3 };
+			for (unsigned int t = 0; t < 4 && r + t < rows; ++t)
+			{
+				const __m512 distance(_mm512_fnmadd_ps(_mm512_set1_ps(2.0f), dots[t], _mm512_add_ps(_mm512_set1_ps(targetNorms[r + t]), norms)));
+				_mm512_storeu_ps(scores + (r + t) * stride + i, _mm512_max_ps(distance, _mm512_setzero_ps()));
+			}
+		}
+	}
+}
+
+#endif// PHOTOMOSAIC_X86
+
+}
+
+EuclideanKernel::EuclideanKernel(const ScoringKernel::InstructionSet& instructionSet)
+	: instructionSet(instructionSet == ScoringKernel::InstructionSet::SSE2 ? ScoringKernel::InstructionSet::Scalar : instructionSet)
+{
+}
+
+void EuclideanKernel::Score(const std::vector<std::vector<float>>& targets, const EuclideanPlanes& planes,
+	const unsigned int& begin, const unsigned int& count, float* scores, const size_t& stride) const
+{
+	assert(begin % EuclideanPlanes::padding == 0);
+	assert(stride >= (count + EuclideanPlanes::padding - 1) / EuclideanPlanes::padding * EuclideanPlanes::padding);
+	if (targets.empty())
+		return;
+
+	const unsigned int rows(static_cast<unsigned int>(targets.size()));
+	std::vector<const float*> targetRows((rows + targetBlockSize - 1) / targetBlockSize * targetBlockSize, targets.back().data());
+	std::vector<float> targetNorms(rows);
+	for (unsigned int r = 0; r < rows; ++r)
+	{
+		assert(targets[r].size() == planes.GetDimension());
+		targetRows[r] = targets[r].data();
+		for (const auto& component : targets[r])
+			targetNorms[r] += component * component;
+	}
+
+	switch (instructionSet)
+	{
+#ifdef PHOTOMOSAIC_X86
+	case ScoringKernel::InstructionSet::AVX512:
+		ScoreAVX512(targetRows.data(), targetNorms.data(), rows, planes, begin, count, scores, stride);
+		break;
+
+	case ScoringKernel::InstructionSet::AVX2:
+		ScoreAVX2(targetRows.data(), targetNorms.data(), rows, planes, begin, count, scores, stride);
+		break;
+#endif// PHOTOMOSAIC_X86
+
+	default:
+		ScoreScalar(targetRows.data(), targetNorms.data(), rows, planes, begin, count, scores, stride);
+	}
+}
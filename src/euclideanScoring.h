@@ -0,0 +1,104 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  euclideanScoring.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Scoring by squared Euclidean distance in CIELAB or YCbCr, as a blocked matrix product.
+
+#ifndef EUCLIDEAN_SCORING_H_
+#define EUCLIDEAN_SCORING_H_
+
+// Local headers
+#include "colorInfo.h"
+#include "scoringKernel.h"
+
+// Standard C++ headers
+#include <vector>
+#include <cstddef>
+
+// Converts subsample colors to a space in which squared Euclidean distance is a reasonable color
+// difference.  The hue, saturation and value of each subsample are converted back to RGB (they are
+// averages, so this is the RGB of the average color, not the average RGB), then to lightness and two
+// chroma components, each scaled by the square root of its weight.  Lab components are divided by
+// 100, so every component is roughly within [-1, 1], as for YCbCr.
+class EuclideanFeatures
+{
+public:
+	enum class Space
+	{
+		Lab,
+		YCbCr
+	};
+
+	EuclideanFeatures(const Space& space, const double& lightnessWeight, const double& chromaWeight);
+
+	// (lightness, chroma, chroma) for each subsample, in the same order as FeaturePlanes::Flatten()
+	std::vector<float> Convert(const InfoGrid& square) const;
+	static double GetDistance(const std::vector<float>& a, const std::vector<float>& b);
+
+	Space GetSpace() const { return space; }
+	static const char* GetName(const Space& space);
+
+private:
+	const Space space;
+	const double lightnessScale;
+	const double chromaScale;
+
+	void ConvertColor(const SquareInfo& color, float* components) const;
+};
+
+// One plane per feature component, with one float per thumbnail, plus the squared norm of each
+// thumbnail's features.  Padded as for FeaturePlanes.
+class EuclideanPlanes
+{
+public:
+	static const unsigned int padding = FeaturePlanes::padding;
+
+	void Build(const std::vector<const InfoGrid*>& thumbnails, const EuclideanFeatures& features);
+
+	unsigned int GetCount() const { return count; }
+	unsigned int GetPaddedCount() const { return paddedCount; }
+	unsigned int GetDimension() const { return dimension; }
+
+	const float* GetPlane(const unsigned int& component) const { return data.data() + component * paddedCount; }
+	const float* GetNorms() const { return data.data() + dimension * paddedCount; }
+
+private:
+	unsigned int count = 0;
+	unsigned int paddedCount = 0;
+	unsigned int dimension = 0;
+	std::vector<float> data;
+};
+
+// Scores many targets against many thumbnails at once as |a|^2 + |b|^2 - 2 a.b, so most of the work is
+// a matrix product.  Each step of the inner loop loads one vector of thumbnail components and uses it
+// for a block of targets held in registers, so every thumbnail is read from cache once per block of
+// targets instead of once per target.  Single precision, so results agree with
+// EuclideanFeatures::GetDistance() to within about 1e-6 of the squared norms.
+class EuclideanKernel
+{
+public:
+	explicit EuclideanKernel(const ScoringKernel::InstructionSet& instructionSet = ScoringKernel::GetBestSupportedInstructionSet());
+
+	// Scores every target against thumbnails [begin, begin + count), with the results for target t starting at
+	// scores + t * stride.  begin must be a multiple of EuclideanPlanes::padding, and stride at least count
+	// rounded up to a multiple of EuclideanPlanes::padding.
+	void Score(const std::vector<std::vector<float>>& targets, const EuclideanPlanes& planes,
+		const unsigned int& begin, const unsigned int& count, float* scores, const size_t& stride) const;
+
+	// There is no SSE2 version; those machines use the scalar kernel
+	ScoringKernel::InstructionSet GetInstructionSet() const { return instructionSet; }
+
+	static const unsigned int targetBlockSize = 4;
+
+private:
+	const ScoringKernel::InstructionSet instructionSet;
+};
+
+#endif// EUCLIDEAN_SCORING_H_
@@ -0,0 +1,210 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  executor.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Work-stealing executor for data-parallel loops.
+
+// Local headers
+#include "executor.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+
+// Index of the current thread's queue within the executor that owns it, if any
+thread_local const Executor* currentExecutor(nullptr);
+thread_local unsigned int currentQueueIndex(0);
+
+}
+
+Executor::Executor(const unsigned int& threadCount) : queuedTaskCount(0)
+{
+	const unsigned int workerCount(std::max(threadCount, 1U) - 1);// The calling thread makes up the difference
+	queues.resize(workerCount + 1);
+	for (auto& q : queues)
+		q = std::make_unique<WorkQueue>();
+
+	workers.resize(workerCount);
+	for (unsigned int i = 0; i < workerCount; ++i)
+		workers[i] = std::thread(&Executor::WorkerEntry, this, i + 1);
+}
+
+Executor::~Executor()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+
+	workAvailable.notify_all();
+	for (auto& t : workers)
+		t.join();
+}
+
+Executor& Executor::GetShared()
+{
+	static Executor executor(std::max(1U, std::thread::hardware_concurrency()));
+	return executor;
+}
+
+size_t Executor::GetChunkSize(const size_t& count, const size_t& grainSize) const
+{
+	if (grainSize > 0)
+		return grainSize;
+
+	// Enough chunks that threads which finish early can steal work from the others
+	const size_t chunksPerThread(8);
+	return std::max<size_t>(1, count / (GetThreadCount() * chunksPerThread));
+}
+
+void Executor::Run(const size_t& count, const size_t& chunkSize, std::function<void(const size_t&, const size_t&)> body)
+{
+	if (count == 0)
+		return;
+
+	const size_t chunkCount((count + chunkSize - 1) / chunkSize);
+	if (chunkCount == 1 || workers.empty())
+	{
+		body(0, count);
+		return;
+	}
+
+	Loop loop;
+	loop.body = std::move(body);
+	loop.count = count;
+	loop.chunkSize = chunkSize;
+	loop.remaining = chunkCount;
+
+	// Deal out contiguous runs of chunks, starting with this thread's own queue, so each thread
+	// mostly works on neighboring data
+	const unsigned int queueIndex(GetQueueIndex());
+	const size_t queueCount(queues.size());
+	for (size_t q = 0; q < queueCount; ++q)
+	{
+		const size_t first(chunkCount * q / queueCount);
+		const size_t last(chunkCount * (q + 1) / queueCount);
+		if (first == last)
+			continue;
+
+		WorkQueue& queue(*queues[(queueIndex + q) % queueCount]);
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		for (size_t c = last; c > first; --c)// Owners pop from the back, so push in reverse to process in order
+			queue.tasks.push_back(Task{ &loop, c - 1 });
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queuedTaskCount += chunkCount;
+	}
+	workAvailable.notify_all();
+
+	// Help out (with this loop or any other) until this loop is done
+	while (loop.remaining > 0)
+	{
+		if (TryRunTask(queueIndex))
+			continue;
+
+		// Nothing left to take, but other threads are still finishing chunks of this loop
+		std::unique_lock<std::mutex> lock(loop.mutex);
+		loop.complete.wait_for(lock, std::chrono::milliseconds(1), [&loop]()
+		{
+			return loop.remaining == 0;
+		});
+	}
+
+	// Make sure the last thread to finish a chunk is done with the loop before it goes out of scope
+	std::lock_guard<std::mutex> lock(loop.mutex);
+}
+
+void Executor::WorkerEntry(const unsigned int& queueIndex)
+{
+	currentExecutor = this;
+	currentQueueIndex = queueIndex;
+
+	while (true)
+	{
+		if (TryRunTask(queueIndex))
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		workAvailable.wait(lock, [this]()
+		{
+			return stopping || queuedTaskCount > 0;
+		});
+
+		if (stopping)
+			break;
+	}
+}
+
+bool Executor::TryRunTask(const unsigned int& queueIndex)
+{
+	Task task;
+	if (TryPop(queueIndex, false, task))
+	{
+		Execute(task);
+		return true;
+	}
+
+	for (unsigned int i = 1; i < queues.size(); ++i)
+	{
+		if (TryPop((queueIndex + i) % queues.size(), true, task))
+		{
+			Execute(task);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Executor::TryPop(const unsigned int& queueIndex, const bool& steal, Task& task)
+{
+	WorkQueue& queue(*queues[queueIndex]);
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty())
+		return false;
+
+	if (steal)
+	{
+		task = queue.tasks.front();
+		queue.tasks.pop_front();
+	}
+	else
+	{
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+	}
+
+	--queuedTaskCount;
+	return true;
+}
+
+void Executor::Execute(const Task& task)
+{
+	Loop& loop(*task.loop);
+	const size_t begin(task.chunk * loop.chunkSize);
+	loop.body(begin, std::min(begin + loop.chunkSize, loop.count));
+
+	// Hold the lock so the waiting thread can't return (destroying the loop) between the decrement and the notify
+	std::lock_guard<std::mutex> lock(loop.mutex);
+	if (--loop.remaining == 0)
+		loop.complete.notify_all();
+}
+
+unsigned int Executor::GetQueueIndex() const
+{
+	if (currentExecutor == this)
+		return currentQueueIndex;
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  executor.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Work-stealing executor for data-parallel loops.
+
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+// Standard C++ headers
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Runs loops in parallel by splitting them into chunks.  Each worker thread has its own deque of
+// chunks; a loop's chunks are dealt out across all of the deques up front, owners take from the back
+// of their own deque, and idle threads steal from the front of others'.  The thread calling
+// ParallelFor() works on the loop too, rather than blocking, so loops may be nested (for example,
+// from within another loop body) and may be started from several threads at once.
+class Executor
+{
+public:
+	explicit Executor(const unsigned int& threadCount);
+	~Executor();
+
+	// Shared by all stages; sized to the machine
+	static Executor& GetShared();
+
+	// Including the calling thread
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers.size() + 1); }
+
+	// Calls body(begin, end) for contiguous chunks covering [0, count), returning when all are complete.
+	// With grainSize == 0, a chunk size is chosen to give several chunks per thread.
+	template<typename Body>
+	void ParallelForChunks(const size_t& count, const Body& body, const size_t& grainSize = 0);
+
+	// Calls body(i) for each i in [0, count)
+	template<typename Body>
+	void ParallelFor(const size_t& count, const Body& body, const size_t& grainSize = 0);
+
+	// Combines chunkBody(begin, end) results for each chunk with combine(a, b), in order of increasing begin
+	template<typename T, typename ChunkBody, typename Combine>
+	T ParallelReduce(const size_t& count, const T& identity, const ChunkBody& chunkBody, const Combine& combine, const size_t& grainSize = 0);
+
+private:
+	struct Loop
+	{
+		std::function<void(const size_t&, const size_t&)> body;
+		size_t count;
+		size_t chunkSize;
+		std::atomic<size_t> remaining;
+
+		std::mutex mutex;
+		std::condition_variable complete;
+	};
+
+	struct Task
+	{
+		Loop* loop;
+		size_t chunk;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	// One queue per worker, plus one shared by threads outside of the executor
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleepMutex;
+	std::condition_variable workAvailable;
+	std::atomic<size_t> queuedTaskCount;
+	bool stopping = false;// Protected by sleepMutex
+
+	size_t GetChunkSize(const size_t& count, const size_t& grainSize) const;
+	void Run(const size_t& count, const size_t& chunkSize, std::function<void(const size_t&, const size_t&)> body);
+
+	void WorkerEntry(const unsigned int& queueIndex);
+	bool TryRunTask(const unsigned int& queueIndex);
+	bool TryPop(const unsigned int& queueIndex, const bool& steal, Task& task);
+	void Execute(const Task& task);
+	unsigned int GetQueueIndex() const;
+};
+
+template<typename Body>
+void Executor::ParallelForChunks(const size_t& count, const Body& body, const size_t& grainSize)
+{
+	Run(count, GetChunkSize(count, grainSize), [&body](const size_t& begin, const size_t& end)
+	{
+		body(begin, end);
+	});
+}
+
+template<typename Body>
+void Executor::ParallelFor(const size_t& count, const Body& body, const size_t& grainSize)
+{
+	Run(count, GetChunkSize(count, grainSize), [&body](const size_t& begin, const size_t& end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			body(i);
+	});
+}
+
+template<typename T, typename ChunkBody, typename Combine>
+T Executor::ParallelReduce(const size_t& count, const T& identity, const ChunkBody& chunkBody, const Combine& combine, const size_t& grainSize)
+{
+	const size_t chunkSize(GetChunkSize(count, grainSize));
+	std::vector<T> partials((count + chunkSize - 1) / chunkSize, identity);
+	Run(count, chunkSize, [&chunkBody, &partials, chunkSize](const size_t& begin, const size_t& end)
+	{
+		partials[begin / chunkSize] = chunkBody(begin, end);
+	});
+
+	T result(identity);
+	for (const auto& partial : partials)
+		result = combine(result, partial);
+	return result;
+}
+
+#endif// EXECUTOR_H_
@@ -0,0 +1,120 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  jpegDecoder.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Reduced-resolution JPEG decoding for thumbnail generation.
+
+// Local headers
+#include "jpegDecoder.h"
+
+// Standard C++ headers
+#include <cstdio>
+#include <csetjmp>
+#include <algorithm>
+
+#ifdef HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif// HAVE_LIBJPEG
+
+namespace
+{
+
+#ifdef HAVE_LIBJPEG
+struct ErrorManager
+{
+	jpeg_error_mgr base;
+	jmp_buf jumpBuffer;
+};
+
+void HandleError(j_common_ptr info)
+{
+	longjmp(reinterpret_cast<ErrorManager*>(info->err)->jumpBuffer, 1);
+}
+
+// Warnings (for example, about truncated files) are expected for some library images; as with
+// wxImage::LoadFile() under wxLogNull, they are not reported
+void IgnoreMessage(j_common_ptr)
+{
+}
+#endif// HAVE_LIBJPEG
+
+}
+
+bool JpegDecoder::IsJpeg(const std::vector<unsigned char>& data)
+{
+	return data.size() > 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+unsigned int JpegDecoder::GetScaleDenominator(const unsigned int& width, const unsigned int& height, const unsigned int& minimumSize)
+{
+	const unsigned int shorterSide(std::min(width, height));
+	unsigned int denominator(8);
+	while (denominator > 1 && (shorterSide + denominator - 1) / denominator < minimumSize)// Decoder rounds scaled dimensions up
+		denominator /= 2;
+	return denominator;
+}
+
+bool JpegDecoder::Decode(const std::vector<unsigned char>& data, const unsigned int& minimumSize, wxImage& image)
+{
+#ifdef HAVE_LIBJPEG
+	if (!IsJpeg(data))
+		return false;
+
+	jpeg_decompress_struct info;
+	ErrorManager error;
+	info.err = jpeg_std_error(&error.base);
+	error.base.error_exit = &HandleError;
+	error.base.output_message = &IgnoreMessage;
+	jpeg_create_decompress(&info);
+
+	if (setjmp(error.jumpBuffer))
+	{
+		jpeg_destroy_decompress(&info);
+		image.Destroy();
+		return false;
+	}
+
+	jpeg_mem_src(&info, const_cast<unsigned char*>(data.data()), static_cast<unsigned long>(data.size()));
+	jpeg_read_header(&info, TRUE);
+
+	// CMYK and YCCK can't be converted to RGB by the decoder
+	if (info.jpeg_color_space != JCS_GRAYSCALE && info.jpeg_color_space != JCS_YCbCr && info.jpeg_color_space != JCS_RGB)
+	{
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+
+	info.out_color_space = JCS_RGB;
+	info.scale_num = 1;
+	info.scale_denom = GetScaleDenominator(info.image_width, info.image_height, minimumSize);
+	info.do_fancy_upsampling = FALSE;// Chroma detail is lost in downscaling anyway
+	jpeg_start_decompress(&info);
+
+	if (!image.Create(info.output_width, info.output_height, false))
+	{
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+
+	unsigned char* pixels(image.GetData());
+	const size_t rowBytes(static_cast<size_t>(info.output_width) * 3);
+	while (info.output_scanline < info.output_height)
+	{
+		JSAMPROW row(pixels + info.output_scanline * rowBytes);
+		jpeg_read_scanlines(&info, &row, 1);
+	}
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+	return true;
+#else
+	return false;
+#endif// HAVE_LIBJPEG
+}
@@ -0,0 +1,41 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  jpegDecoder.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Reduced-resolution JPEG decoding for thumbnail generation.
+
+#ifndef JPEG_DECODER_H_
+#define JPEG_DECODER_H_
+
+// wxWidgets headers
+#include <wx/image.h>
+
+// Standard C++ headers
+#include <vector>
+
+// Decodes with libjpeg directly, rather than through wxImage, so the decoder's DCT-domain scaling can
+// be used.  Scaling by 1/2, 1/4 or 1/8 during the inverse DCT skips most of the work of decoding a
+// large photo which will only be used as a small thumbnail (and averages each block in the process).
+class JpegDecoder
+{
+public:
+	static bool IsJpeg(const std::vector<unsigned char>& data);
+
+	// Decodes data at the smallest supported scale for which the shorter side of the image is still at
+	// least minimumSize (or at full size, if it is already smaller than that).  Returns false if the
+	// data is not a JPEG that this decoder can handle (or if built without HAVE_LIBJPEG), in which case
+	// the caller should fall back to wxImage.
+	static bool Decode(const std::vector<unsigned char>& data, const unsigned int& minimumSize, wxImage& image);
+
+	// The largest denominator (1, 2, 4 or 8) for which the scaled shorter side is at least minimumSize
+	static unsigned int GetScaleDenominator(const unsigned int& width, const unsigned int& height, const unsigned int& minimumSize);
+};
+
+#endif// JPEG_DECODER_H_
@@ -0,0 +1,206 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  libraryIndex.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Persistent on-disk index of thumbnail color information, used to avoid
+//        decoding library images that have not changed since the previous run.
+
+// Local headers
+#include "libraryIndex.h"
+
+// Standard C++ headers
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+
+const char LibraryIndex::fileMagic[8] = { 'P', 'M', 'L', 'I', 'B', 'I', 'D', 'X' };
+const uint32_t LibraryIndex::fileVersion(4);
+
+size_t LibraryIndex::ComputeRecordStride(const unsigned int& subSamples)
+{
+	return sizeof(RecordHeader) + subSamples * subSamples * 3 * sizeof(double);
+}
+
+bool LibraryIndex::Load(const std::string& fileName, const unsigned int& thumbnailSize, const ThumbnailScaler::Filter& filter, const unsigned int& subSamples)
+{
+	Close();
+	if (!file.Open(fileName))
+		return false;
+
+	// Any inconsistency here means the index is unusable, but that's not an error - we just rebuild it
+	FileHeader header;
+	if (file.GetSize() < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != fileVersion ||
+		header.thumbnailSize != thumbnailSize || header.thumbnailFilter != static_cast<uint32_t>(filter) || header.subSamples != subSamples)
+	{
+		Close();
+		return false;
+	}
+
+	this->subSamples = subSamples;
+	atlasId = header.atlasId;
+	recordStride = ComputeRecordStride(subSamples);
+	if (header.pathTableOffset != sizeof(header) + recordStride * header.entryCount || header.pathTableOffset > file.GetSize())
+	{
+		std::cerr << "Library index '" << fileName << "' is corrupt; ignoring" << std::endl;
+		Close();
+		return false;
+	}
+
+	const size_t pathTableSize(file.GetSize() - header.pathTableOffset);
+	const char* pathTable(reinterpret_cast<const char*>(file.GetData() + header.pathTableOffset));
+	records.resize(header.entryCount);
+	pathMap.reserve(header.entryCount);
+	for (unsigned int i = 0; i < header.entryCount; ++i)
+	{
+		records[i] = reinterpret_cast<const RecordHeader*>(file.GetData() + sizeof(header) + recordStride * i);
+		if (records[i]->pathOffset + records[i]->pathLength > pathTableSize)
+		{
+			std::cerr << "Library index '" << fileName << "' is corrupt; ignoring" << std::endl;
+			Close();
+			return false;
+		}
+
+		pathMap[std::string(pathTable + records[i]->pathOffset, records[i]->pathLength)] = i;
+	}
+
+	return true;
+}
+
+void LibraryIndex::Close()
+{
+	records.clear();
+	pathMap.clear();
+	atlasId = 0;
+	file.Close();
+}
+
+LibraryIndex::LookupResult LibraryIndex::Lookup(const Key& key, InfoGrid& info, unsigned int& atlasSlot, uint64_t& perceptualHash) const
+{
+	const auto it(pathMap.find(key.path));
+	if (it == pathMap.end())
+		return LookupResult::Missing;
+
+	const RecordHeader& record(*records[it->second]);
+	if (record.modificationTime != key.modificationTime || record.fileSize != key.fileSize || record.cropHint != key.cropHint)
+		return LookupResult::Missing;
+
+	if (record.isImage == 0)
+		return LookupResult::NotAnImage;
+
+	atlasSlot = record.atlasSlot;
+	perceptualHash = record.perceptualHash;
+
+	const unsigned char* features(reinterpret_cast<const unsigned char*>(&record) + sizeof(RecordHeader));
+	info.resize(subSamples);
+	for (unsigned int x = 0; x < subSamples; ++x)
+	{
+		info[x].resize(subSamples);
+		for (unsigned int y = 0; y < subSamples; ++y)
+		{
+			double hsv[3];
+			memcpy(hsv, features + (x * subSamples + y) * sizeof(hsv), sizeof(hsv));
+			info[x][y].hue = hsv[0];
+			info[x][y].saturation = hsv[1];
+			info[x][y].value = hsv[2];
+		}
+	}
+
+	return LookupResult::Found;
+}
+
+bool LibraryIndex::Write(const std::string& fileName, const unsigned int& thumbnailSize, const ThumbnailScaler::Filter& filter,
+	const unsigned int& subSamples, const uint64_t& atlasId, const std::vector<Entry>& entries)
+{
+	// Write to a temporary file and rename so a crash never leaves a partial index behind
+	const std::string tempFileName(fileName + ".tmp");
+	{
+		std::ofstream outFile(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!outFile.is_open())
+		{
+			std::cerr << "Failed to open '" << tempFileName << "' for output" << std::endl;
+			return false;
+		}
+
+		FileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, fileMagic, sizeof(fileMagic));
+		header.version = fileVersion;
+		header.thumbnailSize = thumbnailSize;
+		header.thumbnailFilter = static_cast<uint32_t>(filter);
+		header.subSamples = subSamples;
+		header.entryCount = static_cast<uint32_t>(entries.size());
+		header.pathTableOffset = sizeof(header) + ComputeRecordStride(subSamples) * entries.size();
+		header.atlasId = atlasId;
+		outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		uint64_t pathOffset(0);
+		std::vector<double> features(subSamples * subSamples * 3);
+		for (const auto& entry : entries)
+		{
+			RecordHeader record;
+			memset(&record, 0, sizeof(record));
+			record.pathOffset = pathOffset;
+			record.pathLength = static_cast<uint32_t>(entry.key.path.size());
+			record.atlasSlot = entry.atlasSlot;
+			record.cropHint = entry.key.cropHint;
+			record.isImage = entry.isImage ? 1 : 0;
+			record.modificationTime = entry.key.modificationTime;
+			record.fileSize = entry.key.fileSize;
+			record.perceptualHash = entry.perceptualHash;
+			outFile.write(reinterpret_cast<const char*>(&record), sizeof(record));
+			pathOffset += record.pathLength;
+
+			std::fill(features.begin(), features.end(), 0.0);
+			if (entry.isImage)
+			{
+				for (unsigned int x = 0; x < subSamples; ++x)
+				{
+					for (unsigned int y = 0; y < subSamples; ++y)
+					{
+						features[(x * subSamples + y) * 3] = entry.info[x][y].hue;
+						features[(x * subSamples + y) * 3 + 1] = entry.info[x][y].saturation;
+						features[(x * subSamples + y) * 3 + 2] = entry.info[x][y].value;
+					}
+				}
+			}
+
+			outFile.write(reinterpret_cast<const char*>(features.data()), features.size() * sizeof(double));
+		}
+
+		for (const auto& entry : entries)
+			outFile.write(entry.key.path.data(), entry.key.path.size());
+
+		if (!outFile.good())
+		{
+			std::cerr << "Failed to write library index to '" << tempFileName << "'" << std::endl;
+			return false;
+		}
+	}
+
+#ifdef _WIN32
+	std::remove(fileName.c_str());// rename() does not replace existing files under MSW
+#endif// _WIN32
+	if (std::rename(tempFileName.c_str(), fileName.c_str()) != 0)
+	{
+		std::cerr << "Failed to rename '" << tempFileName << "' to '" << fileName << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,115 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  libraryIndex.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Persistent on-disk index of thumbnail color information, used to avoid
+//        decoding library images that have not changed since the previous run.
+
+#ifndef LIBRARY_INDEX_H_
+#define LIBRARY_INDEX_H_
+
+// Local headers
+#include "colorInfo.h"
+#include "memoryMappedFile.h"
+#include "thumbnailScaler.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <limits>
+
+class LibraryIndex
+{
+public:
+	struct Key
+	{
+		std::string path;
+		int64_t modificationTime = 0;
+		uint64_t fileSize = 0;
+		unsigned char cropHint = 0;
+	};
+
+	struct Entry
+	{
+		Key key;
+		bool isImage = true;// False for files which failed to load, so we don't try again until they change
+		InfoGrid info;
+		unsigned int atlasSlot = std::numeric_limits<unsigned int>::max();// Index into the thumbnail atlas identified by atlasId, or ThumbnailAtlas::noSlot
+		uint64_t perceptualHash = 0;
+	};
+
+	// Features and atlas pixels depend on how thumbnails were scaled, so an index built with a different size or filter is ignored
+	bool Load(const std::string& fileName, const unsigned int& thumbnailSize, const ThumbnailScaler::Filter& filter, const unsigned int& subSamples);
+	void Close();
+
+	unsigned int GetEntryCount() const { return static_cast<unsigned int>(records.size()); }
+	uint64_t GetAtlasId() const { return atlasId; }
+
+	enum class LookupResult
+	{
+		Missing,// Not in the index or stale
+		NotAnImage,
+		Found
+	};
+
+	// Safe to call concurrently from multiple threads
+	LookupResult Lookup(const Key& key, InfoGrid& info, unsigned int& atlasSlot, uint64_t& perceptualHash) const;
+
+	static bool Write(const std::string& fileName, const unsigned int& thumbnailSize, const ThumbnailScaler::Filter& filter,
+		const unsigned int& subSamples, const uint64_t& atlasId, const std::vector<Entry>& entries);
+
+private:
+	// File layout (native byte order):
+	//   FileHeader
+	//   entryCount x (RecordHeader followed by subSamples * subSamples * 3 doubles)
+	//   Path table (concatenated, not null-terminated)
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t thumbnailSize;
+		uint32_t thumbnailFilter;
+		uint32_t subSamples;
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t pathTableOffset;
+		uint64_t atlasId;
+	};
+
+	struct RecordHeader
+	{
+		uint64_t pathOffset;
+		uint32_t pathLength;
+		uint32_t atlasSlot;
+		uint8_t cropHint;
+		uint8_t isImage;
+		uint16_t reserved;
+		int64_t modificationTime;
+		uint64_t fileSize;
+		uint64_t perceptualHash;
+	};
+
+	static const char fileMagic[8];
+	static const uint32_t fileVersion;
+
+	MemoryMappedFile file;
+	unsigned int subSamples = 0;
+	size_t recordStride = 0;
+	uint64_t atlasId = 0;
+
+	std::vector<const RecordHeader*> records;
+	std::unordered_map<std::string, unsigned int> pathMap;
+
+	static size_t ComputeRecordStride(const unsigned int& subSamples);
+};
+
+#endif// LIBRARY_INDEX_H_
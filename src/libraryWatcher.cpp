@@ -0,0 +1,212 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  libraryWatcher.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Reports files added to, changed in or removed from the library directories.
+
+// Local headers
+#include "libraryWatcher.h"
+
+// Standard C++ headers
+#include <iostream>
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif// __linux__
+
+#ifdef __linux__
+namespace
+{
+
+const uint32_t eventMask(IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_ONLYDIR);
+
+}
+#endif// __linux__
+
+LibraryWatcher::~LibraryWatcher()
+{
+#ifdef __linux__
+	if (descriptor >= 0)
+		close(descriptor);
+#endif// __linux__
+}
+
+bool LibraryWatcher::Start(const std::vector<Root>& roots, const bool& recursive)
+{
+#ifdef __linux__
+	descriptor = inotify_init1(IN_CLOEXEC);
+	if (descriptor < 0)
+	{
+		std::cerr << "Failed to initialize inotify:  " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	this->recursive = recursive;
+	for (const auto& root : roots)
+	{
+		if (!AddDirectory(root.directory, root.tag, nullptr))
+			return false;
+	}
+
+	return true;
+#else
+	std::cerr << "Watching the library requires inotify, which is only available on Linux" << std::endl;
+	return false;
+#endif// __linux__
+}
+
+// When pending is provided, the directory is new, and files already in it (which may have been
+// written before the watch was added) are reported as added
+bool LibraryWatcher::AddDirectory(const std::string& path, const unsigned int& tag, std::map<std::string, Change>* pending)
+{
+#ifdef __linux__
+	const int watch(inotify_add_watch(descriptor, path.c_str(), eventMask));
+	if (watch < 0)
+	{
+		std::cerr << "Failed to watch '" << path << "':  " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	directories[watch] = WatchedDirectory{ path, tag };
+
+	std::error_code errorCode;
+	for (const auto& entry : std::filesystem::directory_iterator(path, errorCode))
+	{
+		if (recursive && entry.is_directory(errorCode))
+			AddDirectory(entry.path().generic_string(), tag, pending);
+		else if (pending && entry.is_regular_file(errorCode))
+			(*pending)[entry.path().generic_string()] = Change{ entry.path().generic_string(), tag, false, false };
+	}
+
+	return true;
+#else
+	return false;
+#endif// __linux__
+}
+
+// Deleted directories are removed automatically, but directories moved elsewhere must be removed explicitly
+void LibraryWatcher::RemoveDirectory(const std::string& path)
+{
+#ifdef __linux__
+	const std::string prefix(path + '/');
+	for (auto it = directories.begin(); it != directories.end();)
+	{
+		if (it->second.path == path || it->second.path.compare(0, prefix.size(), prefix) == 0)
+		{
+			inotify_rm_watch(descriptor, it->first);
+			it = directories.erase(it);
+		}
+		else
+			++it;
+	}
+#endif// __linux__
+}
+
+bool LibraryWatcher::WaitForChanges(const std::chrono::milliseconds& quietTime, std::vector<Change>& changes, bool& rescanRequired)
+{
+	changes.clear();
+	rescanRequired = false;
+
+#ifdef __linux__
+	std::map<std::string, Change> pending;
+	while (true)
+	{
+		pollfd request{ descriptor, POLLIN, 0 };
+		const int result(poll(&request, 1, pending.empty() && !rescanRequired ? -1 : static_cast<int>(quietTime.count())));
+		if (result < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			std::cerr << "Failed to wait for library changes:  " << strerror(errno) << std::endl;
+			return false;
+		}
+
+		if (result == 0)
+			break;// Quiet for long enough
+
+		if (!ReadEvents(pending, rescanRequired))
+			return false;
+	}
+
+	for (auto& change : pending)
+		changes.push_back(std::move(change.second));
+	return true;
+#else
+	return false;
+#endif// __linux__
+}
+
+bool LibraryWatcher::ReadEvents(std::map<std::string, Change>& pending, bool& rescanRequired)
+{
+#ifdef __linux__
+	alignas(inotify_event) char buffer[64 * 1024];
+	const ssize_t length(read(descriptor, buffer, sizeof(buffer)));
+	if (length < 0)
+	{
+		if (errno == EINTR || errno == EAGAIN)
+			return true;
+
+		std::cerr << "Failed to read library changes:  " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	for (ssize_t offset = 0; offset < length;)
+	{
+		const inotify_event& event(*reinterpret_cast<const inotify_event*>(buffer + offset));
+		offset += sizeof(inotify_event) + event.len;
+
+		if (event.mask & IN_Q_OVERFLOW)
+		{
+			rescanRequired = true;
+			continue;
+		}
+
+		const auto directory(directories.find(event.wd));
+		if (directory == directories.end())
+			continue;
+
+		if (event.mask & (IN_DELETE_SELF | IN_IGNORED))
+		{
+			directories.erase(directory);// Removal of its contents is reported by the parent (or, for a root, not at all)
+			continue;
+		}
+
+		if (event.len == 0)
+			continue;
+
+		const std::string path((std::filesystem::path(directory->second.path) / event.name).generic_string());
+		const unsigned int tag(directory->second.tag);
+		const bool isDirectory((event.mask & IN_ISDIR) != 0);
+		if (event.mask & (IN_DELETE | IN_MOVED_FROM))
+		{
+			pending[path] = Change{ path, tag, true, isDirectory };
+			if (isDirectory && (event.mask & IN_MOVED_FROM))
+				RemoveDirectory(path);// Otherwise its watches would keep reporting changes under the old path
+		}
+		else if (isDirectory)
+		{
+			if (recursive && (event.mask & (IN_CREATE | IN_MOVED_TO)))
+				AddDirectory(path, tag, &pending);
+		}
+		else if (event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+			pending[path] = Change{ path, tag, false, false };
+	}
+
+	return true;
+#else
+	return false;
+#endif// __linux__
+}
@@ -0,0 +1,73 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  libraryWatcher.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Reports files added to, changed in or removed from the library directories.
+
+#ifndef LIBRARY_WATCHER_H_
+#define LIBRARY_WATCHER_H_
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+
+// Uses inotify, so only supported on Linux.  Photos tend to arrive in bursts (a card import, a sync),
+// so changes are collected until the directories have been quiet for a while and then reported as a
+// single batch, with repeated events for the same file coalesced.
+class LibraryWatcher
+{
+public:
+	LibraryWatcher() = default;
+	LibraryWatcher(const LibraryWatcher&) = delete;
+	LibraryWatcher& operator=(const LibraryWatcher&) = delete;
+	~LibraryWatcher();
+
+	// The tag is reported with each change, to identify the root the file was found under
+	struct Root
+	{
+		std::string directory;
+		unsigned int tag;
+	};
+
+	bool Start(const std::vector<Root>& roots, const bool& recursive);
+
+	struct Change
+	{
+		std::string path;
+		unsigned int tag;
+		bool removed;// Otherwise added or modified
+		bool isDirectory;// Removed directories imply removal of everything beneath them
+	};
+
+	// Blocks until something changes and then nothing more changes for quietTime.  When events were
+	// lost (the kernel queue overflowed), rescanRequired is set and the caller should rescan everything.
+	bool WaitForChanges(const std::chrono::milliseconds& quietTime, std::vector<Change>& changes, bool& rescanRequired);
+
+private:
+	int descriptor = -1;
+	bool recursive = false;
+
+	struct WatchedDirectory
+	{
+		std::string path;
+		unsigned int tag;
+	};
+
+	std::unordered_map<int, WatchedDirectory> directories;// By watch descriptor
+
+	bool AddDirectory(const std::string& path, const unsigned int& tag, std::map<std::string, Change>* pending);
+	void RemoveDirectory(const std::string& path);
+	bool ReadEvents(std::map<std::string, Change>& pending, bool& rescanRequired);
+};
+
+#endif// LIBRARY_WATCHER_H_
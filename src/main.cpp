@@ -16,9 +16,12 @@
 // Local headers
 #include "photomosaicConfigFile.h"
 #include "photomosaic.h"
+#include "batchManifest.h"
 
 // Standard C++ headers
 #include <iostream>
+#include <string>
+#include <vector>
 
 // wxWidgets headers
 #include <wx/app.h>
@@ -41,6 +44,15 @@ void ReportConfiguration(const PhotomosaicConfig& config)
 
 	if (!config.thumbnailDirectory.empty())
 		std::cout << "Thumbnail directory is '" << config.thumbnailDirectory << "'\n";
+
+	if (!config.libraryIndexFileName.empty())
+		std::cout << "Library index is '" << config.libraryIndexFileName << "'\n";
+
+	if (!config.thumbnailAtlasFileName.empty())
+		std::cout << "Thumbnail atlas is '" << config.thumbnailAtlasFileName << "'\n";
+
+	if (!config.reportFileName.empty())
+		std::cout << "Performance report will be written to '" << config.reportFileName << "'\n";
 		
 	std::cout << std::endl;
 }
@@ -50,9 +62,15 @@ int main(int argc, char *argv[])
 	if (!wxInitialize())
 		return 1;
 
-	if (argc != 2)
+	const bool watch(argc == 3 && std::string(argv[2]) == "--watch");
+	const bool batch(argc == 4 && std::string(argv[2]) == "--batch");
+	const bool serve(argc == 4 && std::string(argv[2]) == "--serve");
+	if (argc != 2 && !watch && !batch && !serve)
 	{
-		std::cout << "Usage:  " << argv[0] << " <config file name>" << std::endl;
+		std::cout << "Usage:  " << argv[0] << " <config file name> [--watch | --batch <manifest file name> | --serve <socket path>]\n"
+			<< "  --watch  Keep running, and update the output whenever the library changes\n"
+			<< "  --batch  Build each mosaic listed in the manifest, ingesting the library only once\n"
+			<< "  --serve  Keep the library in memory, and build mosaics requested on a Unix domain socket" << std::endl;
 		return 1;
 	}
 	
@@ -67,14 +85,49 @@ int main(int argc, char *argv[])
 	wxInitAllImageHandlers();
 
 	Photomosaic photomosaic(configFile.config);
-	wxImage mosaic(photomosaic.Build());
-
-	if (!mosaic.SaveFile(configFile.config.outputFileName))
+	if (watch)
+	{
+		photomosaic.Watch(configFile.config.outputFileName);
+		wxUninitialize();
+		return 1;
+	}
+	else if (serve)
 	{
-		std::cerr << "Failed to write image to '" << configFile.config.outputFileName << "'\n";
+		photomosaic.Serve(argv[3]);
 		wxUninitialize();
 		return 1;
 	}
+	else if (batch)
+	{
+		std::vector<PhotomosaicConfig> targets;
+		if (!BatchManifest::Read(argv[3], configFile.config, targets) || !photomosaic.BuildBatch(targets))
+		{
+			wxUninitialize();
+			return 1;
+		}
+	}
+	else if (configFile.config.outputBandRows > 0)
+	{
+		if (!photomosaic.BuildToFile(configFile.config.outputFileName))
+		{
+			wxUninitialize();
+			return 1;
+		}
+	}
+	else
+	{
+		wxImage mosaic(photomosaic.Build());
+		PerformanceReport::StageTimer timer(photomosaic.GetReport(), PerformanceReport::Stage::Output);
+		if (!mosaic.SaveFile(configFile.config.outputFileName))
+		{
+			std::cerr << "Failed to write image to '" << configFile.config.outputFileName << "'\n";
+			wxUninitialize();
+			return 1;
+		}
+	}
+
+	if (!configFile.config.reportFileName.empty())
+		photomosaic.GetReport().Write(configFile.config.reportFileName);
 	
 	wxUninitialize();
 	return 0;
@@ -0,0 +1,46 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  memoryMappedFile.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Read-only memory mapped file.
+
+#ifndef MEMORY_MAPPED_FILE_H_
+#define MEMORY_MAPPED_FILE_H_
+
+// Standard C++ headers
+#include <string>
+#include <cstddef>
+
+class MemoryMappedFile
+{
+public:
+	MemoryMappedFile() = default;
+	MemoryMappedFile(const MemoryMappedFile&) = delete;
+	MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+	~MemoryMappedFile();
+
+	bool Open(const std::string& fileName);
+	void Close();
+
+	bool IsOpen() const { return data != nullptr; }
+	const unsigned char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif// _WIN32
+};
+
+#endif// MEMORY_MAPPED_FILE_H_
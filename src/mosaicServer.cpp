@@ -0,0 +1,255 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  mosaicServer.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Accepts mosaic requests on a Unix domain socket.
+
+// Local headers
+#include "mosaicServer.h"
+
+// Standard C++ headers
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif// _WIN32
+
+const size_t MosaicServer::maxHeaderSize(64 * 1024);
+const size_t MosaicServer::maxTargetSize(256 * 1024 * 1024);
+const unsigned int MosaicServer::maxTiles(256 * 1024);
+const unsigned long long MosaicServer::maxOutputPixels(128ULL * 1024 * 1024);// 384 MB as RGB
+
+MosaicServer::~MosaicServer()
+{
+#ifndef _WIN32
+	if (descriptor >= 0)
+	{
+		close(descriptor);
+		unlink(socketPath.c_str());
+	}
+#endif// _WIN32
+}
+
+bool MosaicServer::Start(const std::string& socketPath)
+{
+#ifndef _WIN32
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Socket path '" << socketPath << "' is too long" << std::endl;
+		return false;
+	}
+
+	memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+	descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (descriptor < 0)
+	{
+		std::cerr << "Failed to create socket:  " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	unlink(socketPath.c_str());// Left behind if a previous server didn't shut down cleanly
+	if (bind(descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(descriptor, SOMAXCONN) != 0)
+	{
+		std::cerr << "Failed to listen on '" << socketPath << "':  " << strerror(errno) << std::endl;
+		close(descriptor);
+		descriptor = -1;
+		return false;
+	}
+
+	this->socketPath = socketPath;
+	return true;
+#else
+	std::cerr << "Server mode requires Unix domain sockets, which are not supported on Windows" << std::endl;
+	return false;
+#endif// _WIN32
+}
+
+// Each thread takes the next connection as soon as it finishes with the last, so at most threadCount
+// mosaics are in progress at once; further clients wait in the listen queue
+bool MosaicServer::Run(const unsigned int& threadCount, const Handler& handler)
+{
+#ifndef _WIN32
+	std::vector<std::thread> threads(threadCount);
+	for (auto& t : threads)
+	{
+		t = std::thread([this, &handler]()
+		{
+			while (true)
+			{
+				const int connection(accept(descriptor, nullptr, nullptr));
+				if (connection < 0)
+				{
+					if (errno == EINTR || errno == ECONNABORTED)
+						continue;
+
+					std::cerr << "Failed to accept connection:  " << strerror(errno) << std::endl;
+					return;
+				}
+
+				Serve(connection, handler);
+				close(connection);
+			}
+		});
+	}
+
+	for (auto& t : threads)
+		t.join();
+#endif// _WIN32
+	return false;
+}
+
+void MosaicServer::Serve(const int& connection, const Handler& handler) const
+{
+#ifndef _WIN32
+	// Don't let a stalled client tie up a thread indefinitely
+	const timeval timeout{ 30, 0 };
+	setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	Request request;
+	Response response;
+	if (ReadRequest(connection, request, response.error))
+		handler(request, response);
+
+	std::ostringstream header;
+	if (response.error.empty())
+		header << "OK " << response.image.size() << ' ' << response.seconds << '\n';
+	else
+		header << "ERROR " << response.error << '\n';
+
+	const std::string headerString(header.str());
+	if (WriteAll(connection, headerString.data(), headerString.size()) && response.error.empty())
+		WriteAll(connection, response.image.data(), response.image.size());
+#endif// _WIN32
+}
+
+bool MosaicServer::ReadRequest(const int& connection, Request& request, std::string& error)
+{
+#ifndef _WIN32
+	// Read in blocks; whatever follows the blank line is the start of the target image
+	std::string received;
+	std::string::size_type headerEnd;
+	char buffer[4096];
+	while ((headerEnd = received.find("\n\n")) == std::string::npos)
+	{
+		if (received.size() > maxHeaderSize)
+		{
+			error = "Request header is too long";
+			return false;
+		}
+
+		const ssize_t count(recv(connection, buffer, sizeof(buffer), 0));
+		if (count <= 0)
+		{
+			if (count < 0 && errno == EINTR)
+				continue;
+
+			error = "Incomplete request header";
+			return false;
+		}
+
+		received.append(buffer, count);
+	}
+
+	std::istringstream header(received.substr(0, headerEnd));
+	std::string line;
+	size_t targetSize(0);
+	while (std::getline(header, line))
+	{
+		const std::string::size_type equals(line.find('='));
+		if (equals == std::string::npos)
+		{
+			error = "Invalid header line '" + line + "'";
+			return false;
+		}
+
+		const std::string key(line.substr(0, equals));
+		const std::string value(line.substr(equals + 1));
+		if (key == "TARGET_SIZE")
+		{
+			std::istringstream ss(value);
+			if (!(ss >> targetSize) || !ss.eof() || targetSize == 0 || targetSize > maxTargetSize)
+			{
+				error = "Invalid TARGET_SIZE";
+				return false;
+			}
+		}
+		else
+			request.settings[key] = value;
+	}
+
+	if (targetSize == 0)
+	{
+		error = "Missing TARGET_SIZE";
+		return false;
+	}
+
+	request.target.assign(received.begin() + headerEnd + 2, received.end());
+	if (request.target.size() > targetSize)
+	{
+		error = "Target image is larger than TARGET_SIZE";
+		return false;
+	}
+
+	const size_t alreadyRead(request.target.size());
+	request.target.resize(targetSize);
+	for (size_t position = alreadyRead; position < targetSize;)
+	{
+		const ssize_t count(recv(connection, request.target.data() + position, targetSize - position, 0));
+		if (count <= 0)
+		{
+			if (count < 0 && errno == EINTR)
+				continue;
+
+			error = "Incomplete target image";
+			return false;
+		}
+
+		position += count;
+	}
+
+	return true;
+#else
+	return false;
+#endif// _WIN32
+}
+
+bool MosaicServer::WriteAll(const int& connection, const void* data, const size_t& size)
+{
+#ifndef _WIN32
+	const char* bytes(static_cast<const char*>(data));
+	for (size_t position = 0; position < size;)
+	{
+		const ssize_t count(send(connection, bytes + position, size - position, MSG_NOSIGNAL));
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;// Client went away; nothing more to do
+		}
+
+		position += count;
+	}
+
+	return true;
+#else
+	return false;
+#endif// _WIN32
+}
@@ -0,0 +1,78 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  mosaicServer.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Accepts mosaic requests on a Unix domain socket.
+
+#ifndef MOSAIC_SERVER_H_
+#define MOSAIC_SERVER_H_
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+
+// One request per connection.  The client sends header lines of the form KEY=value, terminated by an
+// empty line, followed by the encoded target image:
+//   TARGET_SIZE=<bytes in the target image>   (required)
+//   FORMAT=jpg|png|bmp                        (output format; default jpg)
+//   SUBDIVISION_SIZE=..., HUE_WEIGHT=..., SAT_WEIGHT=..., VAL_WEIGHT=...   (optional overrides)
+// and receives either
+//   OK <bytes in the mosaic> <seconds spent building it>\n<encoded mosaic>
+// or
+//   ERROR <message>\n
+// after which the server closes the connection.  Requests for more than maxTiles tiles or a mosaic larger
+// than maxOutputPixels are refused with an ERROR.  Not available on Windows.
+class MosaicServer
+{
+public:
+	MosaicServer() = default;
+	MosaicServer(const MosaicServer&) = delete;
+	MosaicServer& operator=(const MosaicServer&) = delete;
+	~MosaicServer();
+
+	struct Request
+	{
+		std::map<std::string, std::string> settings;// Excluding TARGET_SIZE
+		std::vector<unsigned char> target;
+	};
+
+	struct Response
+	{
+		std::string error;// Empty on success
+		std::vector<unsigned char> image;
+		double seconds = 0.0;
+	};
+
+	typedef std::function<void(const Request&, Response&)> Handler;
+
+	// Per-request limits, enforced by the handler
+	static const unsigned int maxTiles;
+	static const unsigned long long maxOutputPixels;
+
+	bool Start(const std::string& socketPath);
+
+	// Serves requests on threadCount threads, calling handler concurrently from each; returns only on error
+	bool Run(const unsigned int& threadCount, const Handler& handler);
+
+private:
+	int descriptor = -1;
+	std::string socketPath;
+
+	static const size_t maxHeaderSize;
+	static const size_t maxTargetSize;
+
+	void Serve(const int& connection, const Handler& handler) const;
+	static bool ReadRequest(const int& connection, Request& request, std::string& error);
+	static bool WriteAll(const int& connection, const void* data, const size_t& size);
+};
+
+#endif// MOSAIC_SERVER_H_
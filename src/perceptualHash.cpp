@@ -0,0 +1,97 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  perceptualHash.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Perceptual image hashes and an index for finding hashes within a Hamming distance.
+
+// Local headers
+#include "perceptualHash.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+
+uint64_t PerceptualHash::Compute(const unsigned char* data, const unsigned int& width, const unsigned int& height)
+{
+	const unsigned int columns(9), rows(8);
+	double luma[rows][columns];
+	for (unsigned int r = 0; r < rows; ++r)
+	{
+		const unsigned int y0(r * height / rows), y1(std::max((r + 1) * height / rows, y0 + 1));
+		for (unsigned int c = 0; c < columns; ++c)
+		{
+			const unsigned int x0(c * width / columns), x1(std::max((c + 1) * width / columns, x0 + 1));
+			uint64_t sum(0);
+			for (unsigned int y = y0; y < y1; ++y)
+			{
+				const unsigned char* pixel(data + (static_cast<size_t>(y) * width + x0) * 3);
+				for (unsigned int x = x0; x < x1; ++x, pixel += 3)
+					sum += 299 * pixel[0] + 587 * pixel[1] + 114 * pixel[2];
+			}
+
+			luma[r][c] = static_cast<double>(sum) / ((y1 - y0) * (x1 - x0));
+		}
+	}
+
+	uint64_t hash(0);
+	for (unsigned int r = 0; r < rows; ++r)
+	{
+		for (unsigned int c = 0; c + 1 < columns; ++c)
+			hash = (hash << 1) | (luma[r][c] > luma[r][c + 1] ? 1 : 0);
+	}
+
+	return hash;
+}
+
+unsigned int PerceptualHash::GetDistance(const uint64_t& a, const uint64_t& b)
+{
+	return static_cast<unsigned int>(std::bitset<64>(a ^ b).count());
+}
+
+HammingIndex::HammingIndex(const std::vector<uint64_t>& hashes, const unsigned int& maxDistance) : hashes(hashes), maxDistance(maxDistance)
+{
+	assert(maxDistance <= maxSupportedDistance);
+
+	const unsigned int chunkCount(maxDistance + 1);
+	chunks.resize(chunkCount);
+	unsigned int shift(0);
+	for (unsigned int c = 0; c < chunkCount; ++c)
+	{
+		const unsigned int bits(64 / chunkCount + (c < 64 % chunkCount ? 1 : 0));
+		chunks[c].shift = shift;
+		chunks[c].mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+		shift += bits;
+
+		chunks[c].entries.resize(hashes.size());
+		for (unsigned int i = 0; i < hashes.size(); ++i)
+			chunks[c].entries[i] = std::make_pair((hashes[i] >> chunks[c].shift) & chunks[c].mask, i);
+		std::sort(chunks[c].entries.begin(), chunks[c].entries.end());
+	}
+}
+
+void HammingIndex::FindNeighbors(const unsigned int& i, std::vector<unsigned int>& neighbors) const
+{
+	neighbors.clear();
+	for (const auto& chunk : chunks)
+	{
+		const uint64_t value((hashes[i] >> chunk.shift) & chunk.mask);
+		auto it(std::lower_bound(chunk.entries.begin(), chunk.entries.end(), std::make_pair(value, 0U)));
+		for (; it != chunk.entries.end() && it->first == value; ++it)
+		{
+			if (it->second != i && PerceptualHash::GetDistance(hashes[i], hashes[it->second]) <= maxDistance)
+				neighbors.push_back(it->second);
+		}
+	}
+
+	// Hashes which agree on more than one chunk are found more than once
+	std::sort(neighbors.begin(), neighbors.end());
+	neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+}
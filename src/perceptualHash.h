@@ -0,0 +1,60 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  perceptualHash.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Perceptual image hashes and an index for finding hashes within a Hamming distance.
+
+#ifndef PERCEPTUAL_HASH_H_
+#define PERCEPTUAL_HASH_H_
+
+// Standard C++ headers
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+// 64-bit difference hash:  the image's luma is averaged over a grid of 9 columns by 8 rows, and each bit
+// says whether a cell is brighter than its right-hand neighbor.  Recompression, resizing and small
+// changes in exposure leave most bits unchanged.
+class PerceptualHash
+{
+public:
+	// data is packed RGB
+	static uint64_t Compute(const unsigned char* data, const unsigned int& width, const unsigned int& height);
+	static unsigned int GetDistance(const uint64_t& a, const uint64_t& b);
+};
+
+// Finds every hash within maxDistance bits of a given one.  Hashes are split into maxDistance + 1 chunks;
+// two hashes within maxDistance of each other must agree on at least one whole chunk, so only hashes
+// which share a chunk with the query need to be compared.
+class HammingIndex
+{
+public:
+	HammingIndex(const std::vector<uint64_t>& hashes, const unsigned int& maxDistance);
+
+	// Safe to call concurrently from multiple threads
+	void FindNeighbors(const unsigned int& i, std::vector<unsigned int>& neighbors) const;
+
+	static const unsigned int maxSupportedDistance = 15;
+
+private:
+	const std::vector<uint64_t>& hashes;
+	const unsigned int maxDistance;
+
+	struct Chunk
+	{
+		unsigned int shift;
+		uint64_t mask;
+		std::vector<std::pair<uint64_t, unsigned int>> entries;// (chunk value, hash index), sorted
+	};
+
+	std::vector<Chunk> chunks;
+};
+
+#endif// PERCEPTUAL_HASH_H_
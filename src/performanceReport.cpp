@@ -0,0 +1,183 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  performanceReport.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Per-stage timing and counters, written as a JSON report.
+
+// Local headers
+#include "performanceReport.h"
+#include "executor.h"
+
+// Standard C++ headers
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif// _WIN32
+
+PerformanceReport::PerformanceReport(const unsigned int& slowDecodeCount)
+	: creationTime(std::chrono::steady_clock::now()), slowestDecodes(slowDecodeCount)
+{
+}
+
+PerformanceReport::StageTimer::StageTimer(PerformanceReport& report, const Stage& stage)
+	: report(report), stage(stage), wallStart(std::chrono::steady_clock::now()), cpuStart(GetProcessCPUSeconds())
+{
+}
+
+PerformanceReport::StageTimer::~StageTimer()
+{
+	StageRecord& record(report.stages[static_cast<int>(stage)]);
+	AddTo(record.wallSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count());
+	AddTo(record.cpuSeconds, GetProcessCPUSeconds() - cpuStart);
+	record.peakResidentBytes = GetPeakResidentBytes();// Peak for the process so far, so it never decreases from one stage to the next
+}
+
+void PerformanceReport::RecordDecode(const std::string& path, const double& seconds, const uint64_t& bytes)
+{
+	std::lock_guard<std::mutex> lock(decodeMutex);
+	slowestDecodes.Push(Decode{ path, seconds, bytes });
+}
+
+bool PerformanceReport::Write(const std::string& fileName) const
+{
+	std::ofstream file(fileName);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open '" << fileName << "' for output" << std::endl;
+		return false;
+	}
+
+	file << std::setprecision(6);
+	file << "{\n  \"version\": 1,\n  \"threads\": " << Executor::GetShared().GetThreadCount()
+		<< ",\n  \"wallSeconds\": " << std::chrono::duration<double>(std::chrono::steady_clock::now() - creationTime).count()
+		<< ",\n  \"cpuSeconds\": " << GetProcessCPUSeconds()
+		<< ",\n  \"peakResidentBytes\": " << GetPeakResidentBytes()
+		<< ",\n  \"stages\": [";
+
+	for (int i = 0; i < static_cast<int>(Stage::Count); ++i)
+	{
+		const StageRecord& record(stages[i]);
+		file << (i == 0 ? "\n" : ",\n") << "    { \"name\": \"" << GetName(static_cast<Stage>(i))
+			<< "\", \"wallSeconds\": " << record.wallSeconds
+			<< ", \"cpuSeconds\": " << record.cpuSeconds
+			<< ", \"items\": " << record.items
+			<< ", \"bytes\": " << record.bytes
+			<< ", \"peakResidentBytes\": " << record.peakResidentBytes << " }";
+	}
+
+	file << "\n  ],\n  \"slowestDecodes\": [";
+	std::vector<Decode> decodes;
+	{
+		std::lock_guard<std::mutex> lock(decodeMutex);
+		decodes = TopKSelector<Decode>(slowestDecodes).TakeSorted();
+	}
+
+	for (unsigned int i = 0; i < decodes.size(); ++i)
+	{
+		file << (i == 0 ? "\n" : ",\n") << "    { \"path\": \"" << Escape(decodes[i].path)
+			<< "\", \"seconds\": " << decodes[i].seconds << ", \"bytes\": " << decodes[i].bytes << " }";
+	}
+
+	file << (decodes.empty() ? "]\n}\n" : "\n  ]\n}\n");
+	if (!file.good())
+	{
+		std::cerr << "Failed to write performance report to '" << fileName << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+const char* PerformanceReport::GetName(const Stage& stage)
+{
+	switch (stage)
+	{
+	case Stage::TargetAnalysis: return "targetAnalysis";
+	case Stage::ThumbnailIngest: return "thumbnailIngest";
+	case Stage::Scoring: return "scoring";
+	case Stage::Selection: return "selection";
+	case Stage::DistancePenalty: return "distancePenalty";
+	case Stage::Composition: return "composition";
+	case Stage::Output: return "output";
+	default: return "unknown";
+	}
+}
+
+void PerformanceReport::AddTo(std::atomic<double>& total, const double& value)
+{
+	double expected(total.load());
+	while (!total.compare_exchange_weak(expected, expected + value))
+	{
+	}
+}
+
+std::string PerformanceReport::Escape(const std::string& s)
+{
+	std::ostringstream escaped;
+	for (const char& c : s)
+	{
+		if (c == '"' || c == '\\')
+			escaped << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20)
+			escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+		else
+			escaped << c;
+	}
+
+	return escaped.str();
+}
+
+// For all threads in the process
+double PerformanceReport::GetProcessCPUSeconds()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0.0;
+
+	const auto toSeconds([](const FILETIME& t)
+	{
+		return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) * 1.0e-7;
+	});
+	return toSeconds(kernel) + toSeconds(user);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0.0;
+
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1.0e-6;
+#endif// _WIN32
+}
+
+uint64_t PerformanceReport::GetPeakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return usage.ru_maxrss;// Already in bytes
+#else
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif// __APPLE__
+#endif// _WIN32
+}
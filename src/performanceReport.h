@@ -0,0 +1,101 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  performanceReport.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Per-stage timing and counters, written as a JSON report.
+
+#ifndef PERFORMANCE_REPORT_H_
+#define PERFORMANCE_REPORT_H_
+
+// Local headers
+#include "topKSelector.h"
+
+// Standard C++ headers
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+// Counters may be updated from any thread.  Stages may be entered more than once; their times and
+// counters accumulate.
+class PerformanceReport
+{
+public:
+	explicit PerformanceReport(const unsigned int& slowDecodeCount = 10);
+
+	enum class Stage
+	{
+		TargetAnalysis,
+		ThumbnailIngest,
+		Scoring,
+		Selection,
+		DistancePenalty,
+		Composition,
+		Output,
+		Count
+	};
+
+	// Times a stage for as long as it is in scope
+	class StageTimer
+	{
+	public:
+		StageTimer(PerformanceReport& report, const Stage& stage);
+		~StageTimer();
+
+	private:
+		PerformanceReport& report;
+		const Stage stage;
+		const std::chrono::steady_clock::time_point wallStart;
+		const double cpuStart;
+	};
+
+	void AddItems(const Stage& stage, const uint64_t& count) { stages[static_cast<int>(stage)].items += count; }
+	void AddBytes(const Stage& stage, const uint64_t& count) { stages[static_cast<int>(stage)].bytes += count; }
+	void RecordDecode(const std::string& path, const double& seconds, const uint64_t& bytes);
+
+	bool Write(const std::string& fileName) const;
+
+private:
+	const std::chrono::steady_clock::time_point creationTime;
+
+	struct StageRecord
+	{
+		std::atomic<double> wallSeconds{ 0.0 };
+		std::atomic<double> cpuSeconds{ 0.0 };
+		std::atomic<uint64_t> items{ 0 };
+		std::atomic<uint64_t> bytes{ 0 };
+		std::atomic<uint64_t> peakResidentBytes{ 0 };
+	};
+
+	StageRecord stages[static_cast<int>(Stage::Count)];
+
+	struct Decode
+	{
+		std::string path;
+		double seconds;
+		uint64_t bytes;
+
+		// "Less than" means slower, so the selector keeps the slowest decodes
+		bool operator<(const Decode& d) const { return seconds > d.seconds; }
+	};
+
+	mutable std::mutex decodeMutex;
+	TopKSelector<Decode> slowestDecodes;
+
+	static const char* GetName(const Stage& stage);
+	static void AddTo(std::atomic<double>& total, const double& value);
+	static std::string Escape(const std::string& s);
+
+	static double GetProcessCPUSeconds();
+	static uint64_t GetPeakResidentBytes();
+};
+
+#endif// PERFORMANCE_REPORT_H_
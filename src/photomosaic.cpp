@@ -13,61 +13,862 @@
 
 // Local headers
 #include "photomosaic.h"
+#include "batchManifest.h"
 
 // Standard C++ headers
 #include <cassert>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
+#include <future>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <unordered_set>
+#include <map>
+#include <limits>
+#include <atomic>
 
 // wxWidgets headers
 #include <wx/log.h>
+#include <wx/mstream.h>
 
 wxImage Photomosaic::Build()
+{
+	std::vector<std::vector<unsigned int>> chosenTileIndices;
+	std::vector<ImageInfo> thumbnailInfo;
+	if (!SelectTiles(chosenTileIndices, thumbnailInfo))
+		return wxImage();
+
+	std::cout << "Building output image..." << std::endl;
+	PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Composition);
+	return std::move(BuildOutputImage(chosenTileIndices, thumbnailInfo));
+}
+
+bool Photomosaic::BuildToFile(const std::string& fileName)
+{
+	std::vector<std::vector<unsigned int>> chosenTileIndices;
+	std::vector<ImageInfo> thumbnailInfo;
+	if (!SelectTiles(chosenTileIndices, thumbnailInfo))
+		return false;
+
+	std::cout << "Writing output image..." << std::endl;
+	PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Composition);
+	return WriteBandedOutputImage(chosenTileIndices, thumbnailInfo, fileName);
+}
+
+// Keeps the output up to date as files are added to or removed from the library.  The candidate lists
+// for each tile are kept from one update to the next, so a change costs ingesting and scoring only the
+// files which changed, plus selection and composition (which depend on the number of tiles and
+// candidates, but not on the size of the library).
+bool Photomosaic::Watch(const std::string& outputFileName)
+{
+	if (config.candidateCount == 0)
+	{
+		std::cerr << "Watching the library requires CANDIDATE_COUNT > 0" << std::endl;
+		return false;
+	}
+
+	if (config.colorSpace != PhotomosaicConfig::ColorSpace::HSV)
+	{
+		std::cerr << "Watching the library requires COLOR_SPACE = HSV" << std::endl;
+		return false;
+	}
+
+	// Start watching before the initial scan, so files added during the scan aren't missed
+	std::vector<LibraryWatcher::Root> roots;
+	if (!config.centerFocusSourceDirectory.empty())
+		roots.push_back(LibraryWatcher::Root{ config.centerFocusSourceDirectory, static_cast<unsigned int>(CropHint::Center) });
+	if (!config.leftFocusSourceDirectory.empty())
+		roots.push_back(LibraryWatcher::Root{ config.leftFocusSourceDirectory, static_cast<unsigned int>(CropHint::Left) });
+	if (!config.rightFocusSourceDirectory.empty())
+		roots.push_back(LibraryWatcher::Root{ config.rightFocusSourceDirectory, static_cast<unsigned int>(CropHint::Right) });
+
+	LibraryWatcher watcher;
+	if (!watcher.Start(roots, config.recursiveSourceDirectories))
+		return false;
+
+	LibraryState library;
+	if (!LoadTargetInfo(library.targetInfo))
+		return false;
+	ScanLibrary(library);
+
+	while (true)
+	{
+		if (UpdateOutput(library, outputFileName) && !config.reportFileName.empty())
+			report->Write(config.reportFileName);
+
+		std::cout << "Watching library for changes..." << std::endl;
+		std::vector<LibraryWatcher::Change> changes;
+		bool rescanRequired;
+		if (!watcher.WaitForChanges(std::chrono::milliseconds(config.watchQuietTime), changes, rescanRequired))
+			return false;
+
+		if (rescanRequired)
+		{
+			std::cout << "Some library changes were missed; rescanning..." << std::endl;
+			ScanLibrary(library);
+		}
+		else
+			ApplyLibraryChanges(changes, library);
+	}
+}
+
+void Photomosaic::ScanLibrary(LibraryState& library)
+{
+	std::cout << "Preparing thumbnails..." << std::endl;
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::ThumbnailIngest);
+		library.thumbnailInfo = GetThumbnailInfo();
+	}
+
+	PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Scoring);
+	report->AddItems(PerformanceReport::Stage::Scoring, static_cast<uint64_t>(library.targetInfo.size()) * library.targetInfo.front().size() * library.thumbnailInfo.size());
+	library.candidates = SelectBestScores(library.targetInfo, library.thumbnailInfo);
+	library.bounds.resize(library.candidates.size());
+	for (unsigned int x = 0; x < library.candidates.size(); ++x)
+	{
+		library.bounds[x].resize(library.candidates[x].size());
+		for (unsigned int y = 0; y < library.candidates[x].size(); ++y)
+			library.bounds[x][y] = GetCandidateBound(library.candidates[x][y]);
+	}
+}
+
+// Any thumbnail which could belong in a full candidate list scores better than the worst candidate
+double Photomosaic::GetCandidateBound(const std::vector<TileScore>& candidates) const
+{
+	if (candidates.size() < config.candidateCount)
+		return std::numeric_limits<double>::max();// The list holds the entire library
+	return candidates.back().score;
+}
+
+bool Photomosaic::UpdateOutput(LibraryState& library, const std::string& outputFileName)
+{
+	if (!LibraryIsLargeEnough(library.targetInfo, library.thumbnailInfo))
+		return false;
+
+	std::vector<std::vector<unsigned int>> chosenTileIndices;
+	const bool applyPenalty(config.allowMultipleOccurrences && config.distancePenaltyScale > 0.0);
+	{
+		PerformanceReport::StageTimer timer(*report, applyPenalty ? PerformanceReport::Stage::DistancePenalty : PerformanceReport::Stage::Selection);
+		report->AddItems(applyPenalty ? PerformanceReport::Stage::DistancePenalty : PerformanceReport::Stage::Selection,
+			library.targetInfo.size() * library.targetInfo.front().size());
+		chosenTileIndices = SelectFromCandidates(library.candidates, library.targetInfo, library.thumbnailInfo);
+		if (chosenTileIndices.empty())
+			return false;
+	}
+
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Composition);
+		if (!LoadChosenThumbnails(chosenTileIndices, library.thumbnailInfo))
+			return false;
+	}
+
+	// Write to a temporary file and rename, so anything watching the output never sees a partial image
+	// (the temporary name keeps the extension, which determines the image format)
+	const stdfs::path outputPath(outputFileName);
+	const stdfs::path tempPath(stdfs::path(outputPath).replace_filename(outputPath.stem().generic_string() + ".partial" + outputPath.extension().generic_string()));
+	std::cout << "Writing output image..." << std::endl;
+	if (!WriteOutputImage(chosenTileIndices, library.thumbnailInfo, tempPath.generic_string()))
+		return false;
+
+	std::error_code errorCode;
+	stdfs::rename(tempPath, outputPath, errorCode);
+	if (errorCode)
+	{
+		std::cerr << "Failed to write image to '" << outputFileName << "':  " << errorCode.message() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// A modified file is treated as removed and then added again
+void Photomosaic::ApplyLibraryChanges(const std::vector<LibraryWatcher::Change>& changes, LibraryState& library)
+{
+	std::unordered_set<std::string> removedFiles;
+	std::vector<std::string> removedDirectories;
+	std::vector<std::pair<std::string, CropHint>> addedFiles;
+	for (const auto& change : changes)
+	{
+		const std::string path(stdfs::absolute(change.path).generic_string());
+		if (change.isDirectory)
+			removedDirectories.push_back(path + '/');
+		else
+		{
+			removedFiles.insert(path);
+			if (!change.removed)
+				addedFiles.push_back(std::make_pair(path, static_cast<CropHint>(change.tag)));
+		}
+	}
+
+	const auto isRemoved([&removedFiles, &removedDirectories](const std::string& path)
+	{
+		if (removedFiles.find(path) != removedFiles.end())
+			return true;
+
+		for (const auto& directory : removedDirectories)
+		{
+			if (path.compare(0, directory.size(), directory) == 0)
+				return true;
+		}
+
+		return false;
+	});
+
+	std::vector<bool> removed(library.thumbnailInfo.size());
+	unsigned int removedCount(0);
+	for (unsigned int i = 0; i < library.thumbnailInfo.size(); ++i)
+	{
+		removed[i] = isRemoved(library.thumbnailInfo[i].source.path);
+		if (!removed[i])
+			continue;
+
+		++removedCount;
+
+		// Cached thumbnails are named after the source file only, so they'd otherwise be mistaken for the new version of the file
+		if (!config.thumbnailDirectory.empty())
+		{
+			std::error_code errorCode;
+			stdfs::remove(GetThumbnailPath(library.thumbnailInfo[i].source, config.thumbnailDirectory), errorCode);
+		}
+	}
+
+	rejectedEntries.erase(std::remove_if(rejectedEntries.begin(), rejectedEntries.end(), [&isRemoved](const LibraryIndex::Entry& entry)
+	{
+		return isRemoved(entry.key.path);
+	}), rejectedEntries.end());
+	duplicateEntries.erase(std::remove_if(duplicateEntries.begin(), duplicateEntries.end(), [&isRemoved](const LibraryIndex::Entry& entry)
+	{
+		return isRemoved(entry.key.path);
+	}), duplicateEntries.end());
+
+	std::vector<ImageInfo> addedThumbnails;
+	if (!addedFiles.empty())
+	{
+		std::cout << "Preparing " << addedFiles.size() << " new or changed thumbnails..." << std::endl;
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::ThumbnailIngest);
+		LibraryIndex emptyIndex;// Everything passed in has changed, so there's nothing to look up
+		IngestResults results;
+		RunIngestPipeline([this, &addedFiles, &emptyIndex](BoundedQueue<IngestItem>& output, IngestResults& results)
+		{
+			for (const auto& file : addedFiles)
+			{
+				std::error_code errorCode;
+				const stdfs::directory_entry entry(file.first, errorCode);
+				if (!errorCode)
+					AddLibraryEntry(entry, file.second, emptyIndex, output, results);
+			}
+		}, results);
+
+		addedThumbnails = std::move(results.info);
+		rejectedEntries.insert(rejectedEntries.end(), results.rejected.begin(), results.rejected.end());
+	}
+
+	std::cout << "Library changes:  " << removedCount << " thumbnails removed, " << addedThumbnails.size() << " added" << std::endl;
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Scoring);
+		if (removedCount > 0)
+			RemoveThumbnails(removed, library);
+		AddThumbnails(std::move(addedThumbnails), library);
+		RefillCandidates(library);
+	}
+
+	if (atlas->IsOpen())
+		UpdateAtlas(library.thumbnailInfo);
+
+	if (!config.libraryIndexFileName.empty())
+		WriteLibraryIndex(library.thumbnailInfo);
+}
+
+// Removing a thumbnail leaves the rest of each candidate list as the best of what remains, so the lists
+// only need to be compacted and renumbered
+void Photomosaic::RemoveThumbnails(const std::vector<bool>& removed, LibraryState& library) const
+{
+	const unsigned int noIndex(std::numeric_limits<unsigned int>::max());
+	std::vector<unsigned int> newIndices(library.thumbnailInfo.size(), noIndex);
+	unsigned int count(0);
+	for (unsigned int i = 0; i < library.thumbnailInfo.size(); ++i)
+	{
+		if (removed[i])
+			continue;
+
+		newIndices[i] = count;
+		if (i != count)
+			library.thumbnailInfo[count] = std::move(library.thumbnailInfo[i]);
+		++count;
+	}
+
+	library.thumbnailInfo.resize(count);
+
+	Executor::GetShared().ParallelFor(library.candidates.size(), [&library, &newIndices, noIndex](const size_t& x)
+	{
+		for (auto& candidates : library.candidates[x])
+		{
+			unsigned int kept(0);
+			for (const auto& candidate : candidates)
+			{
+				if (newIndices[candidate.thumbnailIndex] != noIndex)
+					candidates[kept++] = TileScore{ newIndices[candidate.thumbnailIndex], candidate.score };
+			}
+
+			candidates.resize(kept);
+		}
+	});
+}
+
+// New thumbnails only need to be compared with each location's bound to know whether they belong in its list
+void Photomosaic::AddThumbnails(std::vector<ImageInfo>&& addedThumbnails, LibraryState& library) const
+{
+	if (addedThumbnails.empty())
+		return;
+
+	const unsigned int firstIndex(library.thumbnailInfo.size());
+	std::vector<const InfoGrid*> thumbnailGrids(addedThumbnails.size());
+	for (unsigned int i = 0; i < addedThumbnails.size(); ++i)
+		thumbnailGrids[i] = &addedThumbnails[i].info;
+
+	FeaturePlanes planes;
+	planes.Build(thumbnailGrids, config.subSamples);
+	const ScoringKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+
+	report->AddItems(PerformanceReport::Stage::Scoring, static_cast<uint64_t>(library.targetInfo.size()) * library.targetInfo.front().size() * addedThumbnails.size());
+	Executor::GetShared().ParallelFor(library.targetInfo.size(), [this, &library, &kernel, &planes, firstIndex](const size_t& x)
+	{
+		std::vector<float> scores(planes.GetPaddedCount());
+		for (unsigned int y = 0; y < library.targetInfo[x].size(); ++y)
+		{
+			kernel.Score(FeaturePlanes::Flatten(library.targetInfo[x][y]), planes, 0, planes.GetCount(), scores.data());
+
+			auto& candidates(library.candidates[x][y]);
+			double& bound(library.bounds[x][y]);
+			for (unsigned int i = 0; i < planes.GetCount(); ++i)
+			{
+				if (scores[i] >= bound)
+					continue;
+
+				const TileScore candidate{ firstIndex + i, scores[i] };
+				candidates.insert(std::upper_bound(candidates.begin(), candidates.end(), candidate), candidate);
+				if (candidates.size() > config.candidateCount)
+				{
+					bound = candidates.back().score;
+					candidates.pop_back();
+				}
+			}
+		}
+	});
+
+	library.thumbnailInfo.insert(library.thumbnailInfo.end(), std::make_move_iterator(addedThumbnails.begin()),
+		std::make_move_iterator(addedThumbnails.end()));
+}
+
+// After enough removals, a location may be left with too few candidates for selection to work with, and
+// only a full rescore can find the thumbnails which should replace them
+void Photomosaic::RefillCandidates(LibraryState& library) const
+{
+	const unsigned int minimumCount(std::min((config.candidateCount + 1) / 2, static_cast<unsigned int>(library.thumbnailInfo.size())));
+	std::vector<std::vector<unsigned int>> refillRows(library.candidates.size());
+	unsigned int refillCount(0);
+	for (unsigned int x = 0; x < library.candidates.size(); ++x)
+	{
+		for (unsigned int y = 0; y < library.candidates[x].size(); ++y)
+		{
+			if (library.candidates[x][y].size() < minimumCount)
+				refillRows[x].push_back(y);
+		}
+
+		refillCount += refillRows[x].size();
+	}
+
+	if (refillCount == 0)
+		return;
+
+	std::cout << "Rescoring " << refillCount << " tiles..." << std::endl;
+	std::vector<const InfoGrid*> thumbnailGrids(library.thumbnailInfo.size());
+	for (unsigned int i = 0; i < library.thumbnailInfo.size(); ++i)
+		thumbnailGrids[i] = &library.thumbnailInfo[i].info;
+
+	FeaturePlanes planes;
+	planes.Build(thumbnailGrids, config.subSamples);
+	const ScoringKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+
+	report->AddItems(PerformanceReport::Stage::Scoring, static_cast<uint64_t>(refillCount) * library.thumbnailInfo.size());
+	Executor::GetShared().ParallelFor(library.candidates.size(), [this, &library, &refillRows, &kernel, &planes](const size_t& x)
+	{
+		if (refillRows[x].empty())
+			return;
+
+		std::vector<InfoGrid> targets(refillRows[x].size());
+		for (unsigned int i = 0; i < refillRows[x].size(); ++i)
+			targets[i] = library.targetInfo[x][refillRows[x][i]];
+
+		std::vector<std::vector<TileScore>> candidates;
+		ScoreColumnTopK(kernel, planes, targets, config.candidateCount, candidates);
+		for (unsigned int i = 0; i < refillRows[x].size(); ++i)
+		{
+			library.bounds[x][refillRows[x][i]] = GetCandidateBound(candidates[i]);
+			library.candidates[x][refillRows[x][i]] = std::move(candidates[i]);
+		}
+	});
+}
+
+// Builds one mosaic for each target configuration from a single ingest of the library.  Every thumbnail
+// is made resident before any target starts, so the targets only read the shared library and can be built
+// concurrently (each using the executor for its own scoring and composition, too).
+bool Photomosaic::BuildBatch(const std::vector<PhotomosaicConfig>& targets)
+{
+	std::vector<ImageInfo> thumbnailInfo;
+	if (!PrepareResidentLibrary(thumbnailInfo))
+		return false;
+
+	const unsigned int jobCount(std::min(config.batchJobs, static_cast<unsigned int>(targets.size())));
+	std::cout << "Building " << targets.size() << " mosaics, " << jobCount << " at a time..." << std::endl;
+
+	std::atomic<unsigned int> nextTarget(0);
+	std::atomic<unsigned int> failureCount(0);
+	std::mutex outputMutex;
+	Executor::GetShared().ParallelFor(jobCount, [this, &targets, &thumbnailInfo, &nextTarget, &failureCount, &outputMutex](const size_t&)
+	{
+		for (unsigned int i = nextTarget++; i < targets.size(); i = nextTarget++)
+		{
+			const auto start(std::chrono::steady_clock::now());
+			Photomosaic mosaic(targets[i], *this);
+			const bool ok(mosaic.BuildFromLibrary(thumbnailInfo));
+			const double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+			std::lock_guard<std::mutex> lock(outputMutex);
+			if (ok)
+				std::cout << "Wrote '" << targets[i].outputFileName << "' in " << seconds << " sec" << std::endl;
+			else
+			{
+				std::cerr << "Failed to build mosaic for '" << targets[i].targetImageFileName << '\'' << std::endl;
+				++failureCount;
+			}
+		}
+	}, 1);
+
+	if (failureCount > 0)
+	{
+		std::cerr << failureCount << " of " << targets.size() << " mosaics failed" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Keeps the library in memory and builds mosaics on request, so each request only pays for analyzing its
+// target, scoring, selection and composition
+bool Photomosaic::Serve(const std::string& socketPath)
+{
+	std::vector<ImageInfo> thumbnailInfo;
+	if (!PrepareResidentLibrary(thumbnailInfo))
+		return false;
+
+	MosaicServer server;
+	if (!server.Start(socketPath))
+		return false;
+
+	std::cout << "Listening for requests on '" << socketPath << "' (" << config.batchJobs << " at a time)..." << std::endl;
+	std::atomic<unsigned int> requestCount(0);
+	std::mutex reportMutex;
+	return server.Run(config.batchJobs, [this, &thumbnailInfo, &requestCount, &reportMutex](const MosaicServer::Request& request, MosaicServer::Response& response)
+	{
+		const auto start(std::chrono::steady_clock::now());
+		const unsigned int requestNumber(++requestCount);
+		HandleRequest(request, thumbnailInfo, response);
+		response.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (response.error.empty())
+			std::cout << "Request " << requestNumber << ":  " << response.image.size() << " bytes in " << response.seconds << " sec" << std::endl;
+		else
+			std::cerr << "Request " << requestNumber << " failed after " << response.seconds << " sec:  " << response.error << std::endl;
+
+		if (!config.reportFileName.empty())
+		{
+			std::lock_guard<std::mutex> lock(reportMutex);
+			report->Write(config.reportFileName);
+		}
+	});
+}
+
+void Photomosaic::HandleRequest(const MosaicServer::Request& request, const std::vector<ImageInfo>& thumbnailInfo,
+	MosaicServer::Response& response) const
+{
+	PhotomosaicConfig requestConfig(config);
+	wxBitmapType imageType(wxBITMAP_TYPE_JPEG);
+	for (const auto& setting : request.settings)
+	{
+		if (setting.first == "FORMAT")
+		{
+			if (setting.second == "jpg")
+				imageType = wxBITMAP_TYPE_JPEG;
+			else if (setting.second == "png")
+				imageType = wxBITMAP_TYPE_PNG;
+			else if (setting.second == "bmp")
+				imageType = wxBITMAP_TYPE_BMP;
+			else
+			{
+				response.error = "Unsupported FORMAT '" + setting.second + "'";
+				return;
+			}
+		}
+		else if (!BatchManifest::ApplyOverride(setting.first, setting.second, requestConfig))
+		{
+			response.error = "Invalid setting '" + setting.first + "=" + setting.second + "'";
+			return;
+		}
+	}
+
+	wxImage target;
+	{
+		wxLogNull noLog;
+		wxMemoryInputStream stream(request.target.data(), request.target.size());
+		if (!target.LoadFile(stream))
+		{
+			response.error = "Failed to decode target image";
+			return;
+		}
+	}
+
+	// Checked before analyzing the target, since a small SUBDIVISION_SIZE can otherwise request an
+	// output image too large to allocate
+	const unsigned long long xTiles(target.GetWidth() / requestConfig.subDivisionSize);
+	const unsigned long long yTiles(target.GetHeight() / requestConfig.subDivisionSize);
+	const unsigned long long thumbnailPixels(static_cast<unsigned long long>(requestConfig.thumbnailSize) * requestConfig.thumbnailSize);
+	if (xTiles * yTiles > MosaicServer::maxTiles)
+	{
+		response.error = "Mosaic would require " + std::to_string(xTiles * yTiles) + " tiles; the limit is "
+			+ std::to_string(MosaicServer::maxTiles) + ", so increase SUBDIVISION_SIZE";
+		return;
+	}
+	else if (xTiles * yTiles * thumbnailPixels > MosaicServer::maxOutputPixels)
+	{
+		response.error = "Mosaic would have " + std::to_string(xTiles * yTiles * thumbnailPixels) + " pixels; the limit is "
+			+ std::to_string(MosaicServer::maxOutputPixels) + ", so increase SUBDIVISION_SIZE";
+		return;
+	}
+
+	Photomosaic mosaic(requestConfig, *this);
+	TargetInfo targetInfo;
+	if (!mosaic.AnalyzeTarget(target, targetInfo) || !mosaic.LibraryIsLargeEnough(targetInfo, thumbnailInfo))
+	{
+		response.error = "Target is too small for SUBDIVISION_SIZE, or the library is too small";
+		return;
+	}
+
+	target.Destroy();
+	wxImage image;
+	{
+		const std::vector<std::vector<unsigned int>> chosenTileIndices(mosaic.ScoreAndSelect(targetInfo, thumbnailInfo));
+		if (chosenTileIndices.empty())
+		{
+			response.error = "Failed to assign unique thumbnails";
+			return;
+		}
+
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Composition);
+		image = mosaic.BuildOutputImage(chosenTileIndices, thumbnailInfo);
+	}
+
+	PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Output);
+	wxMemoryOutputStream stream;
+	if (!image.SaveFile(stream, imageType))
+	{
+		response.error = "Failed to encode mosaic";
+		return;
+	}
+
+	response.image.resize(stream.GetSize());
+	stream.CopyTo(response.image.data(), response.image.size());
+}
+
+// Ingests the library and makes every thumbnail's pixels resident, so mosaics can then be built
+// concurrently without modifying the library
+bool Photomosaic::PrepareResidentLibrary(std::vector<ImageInfo>& thumbnailInfo)
+{
+	std::cout << "Preparing thumbnails..." << std::endl;
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::ThumbnailIngest);
+		thumbnailInfo = GetThumbnailInfo();
+	}
+
+	PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Composition);
+	std::vector<bool> required(thumbnailInfo.size());
+	for (unsigned int i = 0; i < thumbnailInfo.size(); ++i)
+		required[i] = thumbnailInfo[i].atlasSlot == ThumbnailAtlas::noSlot && !thumbnailInfo[i].image.IsOk();
+	return LoadThumbnails(required, thumbnailInfo);
+}
+
+bool Photomosaic::BuildFromLibrary(const std::vector<ImageInfo>& thumbnailInfo)
+{
+	TargetInfo targetInfo;
+	if (!LoadTargetInfo(targetInfo) || !LibraryIsLargeEnough(targetInfo, thumbnailInfo))
+		return false;
+
+	const std::vector<std::vector<unsigned int>> chosenTileIndices(ScoreAndSelect(targetInfo, thumbnailInfo));
+	if (chosenTileIndices.empty())
+		return false;
+
+	return WriteOutputImage(chosenTileIndices, thumbnailInfo, config.outputFileName);
+}
+
+bool Photomosaic::SelectTiles(std::vector<std::vector<unsigned int>>& chosenTileIndices, std::vector<ImageInfo>& thumbnailInfo)
+{
+	TargetInfo targetInfo;
+	if (!LoadTargetInfo(targetInfo))
+		return false;
+	
+	std::cout << "Preparing thumbnails..." << std::endl;
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::ThumbnailIngest);
+		thumbnailInfo = GetThumbnailInfo();
+	}
+
+	if (!LibraryIsLargeEnough(targetInfo, thumbnailInfo))
+		return false;
+
+	chosenTileIndices = ScoreAndSelect(targetInfo, thumbnailInfo);
+	if (chosenTileIndices.empty())
+		return false;
+
+	PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Composition);
+	return LoadChosenThumbnails(chosenTileIndices, thumbnailInfo);
+}
+
+std::vector<std::vector<unsigned int>> Photomosaic::ScoreAndSelect(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo) const
+{
+	const unsigned int tileCount(targetInfo.size() * targetInfo.front().size());
+	ScoreGrid sortedScores;
+	std::vector<std::vector<std::vector<double>>> scores;// Lower scores represent better fit
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Scoring);
+		report->AddItems(PerformanceReport::Stage::Scoring, static_cast<uint64_t>(tileCount) * thumbnailInfo.size());
+		if (config.useSearchIndex)
+			sortedScores = FindCandidates(targetInfo, thumbnailInfo);
+		else if (config.candidateCount > 0)
+			sortedScores = SelectBestScores(targetInfo, thumbnailInfo);
+		else
+		{
+			// Find the score for every thumbnail at every grid location
+			std::cout << "Scoring tiles..." << std::endl;
+			scores.resize(thumbnailInfo.size());
+			if (config.colorSpace != PhotomosaicConfig::ColorSpace::HSV)
+			{
+				const ConvertedTargetInfo convertedTargets(ConvertTargetInfo(targetInfo));
+				Executor::GetShared().ParallelFor(thumbnailInfo.size(), [this, &convertedTargets, &thumbnailInfo, &scores](const size_t& i)
+				{
+					scores[i] = ScoreAllThumbnailsOnGrid(convertedTargets, euclideanFeatures.Convert(thumbnailInfo[i].info));
+				});
+			}
+			else
+			{
+				Executor::GetShared().ParallelFor(thumbnailInfo.size(), [this, &targetInfo, &thumbnailInfo, &scores](const size_t& i)
+				{
+					scores[i] = ScoreAllThumbnailsOnGrid(targetInfo, thumbnailInfo[i].info);
+				});
+			}
+		}
+	}
+
+	const bool applyPenalty(config.allowMultipleOccurrences && config.distancePenaltyScale > 0.0);
+	{
+		PerformanceReport::StageTimer timer(*report, applyPenalty ? PerformanceReport::Stage::DistancePenalty : PerformanceReport::Stage::Selection);
+		report->AddItems(applyPenalty ? PerformanceReport::Stage::DistancePenalty : PerformanceReport::Stage::Selection, tileCount);
+		if (!scores.empty())
+		{
+			sortedScores = CreateSortedScoreGrid(scores);
+			scores.clear();
+		}
+
+		return SelectFromCandidates(sortedScores, targetInfo, thumbnailInfo);
+	}
+}
+
+bool Photomosaic::LoadTargetInfo(TargetInfo& targetInfo)
 {
 	wxImage targetImage;
-	if (!targetImage.LoadFile(config.targetImageFileName))
 	{
-		std::cerr << "Failed to load target image from '" << config.targetImageFileName << '\'' << std::endl;
-		return targetImage;
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::TargetAnalysis);
+		if (!targetImage.LoadFile(config.targetImageFileName))
+		{
+			std::cerr << "Failed to load target image from '" << config.targetImageFileName << '\'' << std::endl;
+			return false;
+		}
+	}
+
+	return AnalyzeTarget(targetImage, targetInfo);
+}
+
+bool Photomosaic::AnalyzeTarget(const wxImage& targetImage, TargetInfo& targetInfo)
+{
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::TargetAnalysis);
+		std::cout << "Extracting information from target image..." << std::endl;
+		report->AddBytes(PerformanceReport::Stage::TargetAnalysis, static_cast<uint64_t>(targetImage.GetWidth()) * targetImage.GetHeight() * 3);
+		if (config.adaptiveLevels > 0)
+			targetInfo = GetAdaptiveTargetInfo(targetImage);
+		else
+			targetInfo = GetTargetInfo(targetImage, config.subDivisionSize, config.subSamples);
 	}
-	
+
+	if (targetInfo.empty() || targetInfo.front().empty())
+	{
+		std::cerr << "Target image is smaller than one tile; decrease SUBDIVISION_SIZE" << std::endl;
+		return false;
+	}
+
+	report->AddItems(PerformanceReport::Stage::TargetAnalysis, targetInfo.size() * targetInfo.front().size());
+	return true;
+}
+
+bool Photomosaic::LibraryIsLargeEnough(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo) const
+{
+	const unsigned int tileCount(targetInfo.size() * targetInfo.front().size());
+	if (thumbnailInfo.empty())
+	{
+		std::cerr << "Library contains no usable images" << std::endl;
+		return false;
+	}
+	else if (!config.allowMultipleOccurrences && thumbnailInfo.size() < tileCount)
+	{
+		std::cerr << "Library contains " << thumbnailInfo.size() << " usable images, but the mosaic requires " << tileCount
+			<< " tiles; enable MULTIPLE_USE, increase SUBDIVISION_SIZE or add images to the library" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<std::vector<unsigned int>> Photomosaic::SelectFromCandidates(const ScoreGrid& scores, const TargetInfo& targetInfo,
+	const std::vector<ImageInfo>& thumbnailInfo) const
+{
+	if (config.allowMultipleOccurrences)
+		return ChooseTiles(scores, config);
+	return ChooseUniqueTiles(scores, targetInfo, thumbnailInfo);
+}
+
+bool Photomosaic::WriteOutputImage(const std::vector<std::vector<unsigned int>>& chosenTileIndices,
+	const std::vector<ImageInfo>& thumbnailInfo, const std::string& fileName) const
+{
+	if (config.outputBandRows > 0)
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Composition);
+		return WriteBandedOutputImage(chosenTileIndices, thumbnailInfo, fileName);
+	}
+
+	wxImage mosaic;
+	{
+		PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Composition);
+		mosaic = BuildOutputImage(chosenTileIndices, thumbnailInfo);
+	}
+
+	PerformanceReport::StageTimer timer(*report, PerformanceReport::Stage::Output);
+	if (!mosaic.SaveFile(fileName))
+	{
+		std::cerr << "Failed to write image to '" << fileName << "'\n";
+		return false;
+	}
+
+	return true;
+}
+
+// The summed-area table costs 32 bytes per pixel (much more than the image itself), so the target is analyzed
+// one band of tile rows at a time; once a band has been analyzed, the information for its tiles is cheap to compute
+Photomosaic::TargetInfo Photomosaic::GetTargetInfo(const wxImage& targetImage, const unsigned int& subDivisionSize, const unsigned int& subSamples)
+{
 	const unsigned int width(targetImage.GetWidth());
 	const unsigned int height(targetImage.GetHeight());
-	const unsigned int xTiles(width / config.subDivisionSize);
-	const unsigned int yTiles(height / config.subDivisionSize);
+	const unsigned int xTiles(width / subDivisionSize);
+	const unsigned int yTiles(height / subDivisionSize);
 	
 	// If the image size isn't evenly divisible by the tile size, center the tiles on the target image
-	const unsigned int xOffset(width - xTiles * config.subDivisionSize);
-	const unsigned int yOffset(height - yTiles * config.subDivisionSize);
+	const unsigned int xOffset(width - xTiles * subDivisionSize);
+	const unsigned int yOffset(height - yTiles * subDivisionSize);
 	
-	std::cout << "Image will require " << xTiles * yTiles << " tiles\nExtracting information from source image..." << std::endl;
+	std::cout << "Image will require " << xTiles * yTiles << " tiles" << std::endl;
 	
-	ThreadPool pool(std::thread::hardware_concurrency() * 2);
-	TargetInfo targetInfo(xTiles);
-	for (unsigned int x = 0; x < xTiles; ++x)
+	TargetInfo targetInfo(xTiles, std::vector<InfoGrid>(yTiles));
+	const unsigned int minBandRows(256);// Enough rows to keep the analysis threads busy
+	const unsigned int bandTiles(std::max(minBandRows / subDivisionSize, 1U));
+	TargetAnalysis targetAnalysis;
+	for (unsigned int firstY = 0; firstY < yTiles; firstY += bandTiles)
 	{
-		targetInfo[x].resize(yTiles);
-		for (unsigned int y = 0; y < yTiles; ++y)
-			pool.AddJob(std::make_unique<TileProcessJob>(targetImage.GetSubImage(wxRect(xOffset + x * config.subDivisionSize, yOffset + y * config.subDivisionSize,
-				config.subDivisionSize, config.subDivisionSize)), config.subSamples, targetInfo[x][y]));
+		const unsigned int lastY(std::min(firstY + bandTiles, yTiles));
+		targetAnalysis.Analyze(targetImage.GetData(), width, yOffset + firstY * subDivisionSize, (lastY - firstY) * subDivisionSize);
+		for (unsigned int x = 0; x < xTiles; ++x)
+		{
+			for (unsigned int y = firstY; y < lastY; ++y)
+				targetAnalysis.GetInfoGrid(xOffset + x * subDivisionSize, yOffset + y * subDivisionSize, subDivisionSize, subSamples, targetInfo[x][y]);
+		}
 	}
-	
-	pool.WaitForAllJobsComplete();
-	
-	std::cout << "Preparing thumbnails..." << std::endl;
-	const auto thumbnailInfo(GetThumbnailInfo());
-	
-	// Find the score for every thumbnail at every grid location
-	std::cout << "Scoring tiles..." << std::endl;
-	std::vector<std::vector<std::vector<double>>> scores(thumbnailInfo.size());// Lower scores represent better fit
-	for (unsigned int i = 0; i < thumbnailInfo.size(); ++i)
-		pool.AddJob(std::make_unique<ScoringJob>(*this, targetInfo, thumbnailInfo[i].info, scores[i]));
-	pool.WaitForAllJobsComplete();
-	auto sortedScores(CreateSortedScoreGrid(scores));
-	const auto chosenTileIndices(ChooseTiles(sortedScores, config));
-	
-	std::cout << "Building output image..." << std::endl;
-	return std::move(BuildOutputImage(chosenTileIndices, thumbnailInfo));
+
+	return targetInfo;
+}
+
+// Flat regions of the target are covered with larger tiles, each of which is scored as a single location
+// (with the same number of subsamples spread over the whole tile), so scoring and selection only see the
+// tiles.  A tile is flat enough if none of its cells differs from the tile's average color by more than
+// the threshold, averaged over the cell's subsamples.  As in GetTargetInfo(), the target is analyzed one
+// band at a time; here each band is a row of the largest tiles.
+Photomosaic::TargetInfo Photomosaic::GetAdaptiveTargetInfo(const wxImage& targetImage)
+{
+	const unsigned int width(targetImage.GetWidth());
+	const unsigned int cellSize(config.subDivisionSize);
+	const unsigned int xCells(width / cellSize);
+	const unsigned int yCells(targetImage.GetHeight() / cellSize);
+	const unsigned int xOffset(width - xCells * cellSize);// Same placement as GetTargetInfo()
+	const unsigned int yOffset(targetImage.GetHeight() - yCells * cellSize);
+
+	const unsigned int samples(std::max(config.subSamples, 1));
+	const double maxCellScore(config.adaptiveThreshold * samples * samples);
+	const bool isEuclidean(config.colorSpace != PhotomosaicConfig::ColorSpace::HSV);
+	TargetAnalysis targetAnalysis;
+	InfoGrid cell;
+	const auto isUniform([&](const QuadtreeLayout::Tile& tile)
+	{
+		const unsigned int tileSize(tile.size * cellSize);
+		const InfoGrid average(samples, std::vector<SquareInfo>(samples,
+			targetAnalysis.GetAverage(xOffset + tile.x * cellSize, yOffset + tile.y * cellSize, tileSize, tileSize)));
+		const std::vector<float> convertedAverage(isEuclidean ? euclideanFeatures.Convert(average) : std::vector<float>());
+		for (unsigned int x = tile.x; x < tile.x + tile.size; ++x)
+		{
+			for (unsigned int y = tile.y; y < tile.y + tile.size; ++y)
+			{
+				targetAnalysis.GetInfoGrid(xOffset + x * cellSize, yOffset + y * cellSize, cellSize, samples, cell);
+				const double score(isEuclidean ? EuclideanFeatures::GetDistance(euclideanFeatures.Convert(cell), convertedAverage)
+					: ComputeScore(cell, average));
+				if (score > maxCellScore)
+					return false;
+			}
+		}
+
+		return true;
+	});
+
+	adaptiveLayout.xCells = xCells;
+	adaptiveLayout.yCells = yCells;
+	adaptiveLayout.tiles.clear();
+	auto& tiles(adaptiveLayout.tiles);
+	TargetInfo targetInfo(1);
+	const unsigned int rootSize(1U << config.adaptiveLevels);
+	for (unsigned int firstY = 0; firstY < yCells; firstY += rootSize)
+	{
+		const unsigned int bandCells(std::min(rootSize, yCells - firstY));
+		targetAnalysis.Analyze(targetImage.GetData(), width, yOffset + firstY * cellSize, bandCells * cellSize);
+
+		const size_t firstTile(tiles.size());
+		QuadtreeLayout::BuildRow(xCells, yCells, config.adaptiveLevels, firstY, isUniform, tiles);
+		targetInfo[0].resize(tiles.size());
+		Executor::GetShared().ParallelFor(tiles.size() - firstTile, [&](const size_t& i)
+		{
+			const QuadtreeLayout::Tile& tile(tiles[firstTile + i]);
+			targetAnalysis.GetInfoGrid(xOffset + tile.x * cellSize, yOffset + tile.y * cellSize,
+				tile.size * cellSize, config.subSamples, targetInfo[0][firstTile + i]);
+		});
+	}
+
+	std::cout << "Image will require " << tiles.size() << " tiles (instead of " << xCells * yCells << ")" << std::endl;
+	return targetInfo;
 }
 
 Photomosaic::ScoreGrid Photomosaic::CreateSortedScoreGrid(const std::vector<std::vector<std::vector<double>>>& scores)
@@ -95,10 +896,249 @@ Photomosaic::ScoreGrid Photomosaic::CreateSortedScoreGrid(const std::vector<std:
 	return sortedScores;
 }
 
-std::vector<std::vector<unsigned int>> Photomosaic::ChooseTiles(ScoreGrid& scores, const PhotomosaicConfig& config)
+// Rather than scoring every thumbnail at every grid location, find only the best few for each location.
+// ComputeScore() is a metric (each term is a distance, and the sum of metrics is a metric), so we can
+// use a metric tree built over the thumbnails directly, without needing to map hue onto a linear axis.
+Photomosaic::ScoreGrid Photomosaic::FindCandidates(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo) const
+{
+	std::cout << "Building search index..." << std::endl;
+	const VPTree tree(thumbnailInfo.size(), [this, &thumbnailInfo](const unsigned int& a, const unsigned int& b)
+	{
+		return ComputeScore(thumbnailInfo[a].info, thumbnailInfo[b].info);
+	});
+
+	std::cout << "Searching for best " << config.candidateCount << " thumbnails for each tile..." << std::endl;
+	// Parallel over every location rather than over columns, since an adaptive layout has only one column
+	const unsigned int yCount(targetInfo.front().size());
+	ScoreGrid candidates(targetInfo.size(), std::vector<std::vector<TileScore>>(yCount));
+	Executor::GetShared().ParallelFor(targetInfo.size() * yCount, [this, &tree, &targetInfo, &thumbnailInfo, &candidates, yCount](const size_t& i)
+	{
+		thread_local std::vector<VPTree::Neighbor> neighbors;
+		const InfoGrid& target(targetInfo[i / yCount][i % yCount]);
+		tree.FindNearest(config.candidateCount, [this, &target, &thumbnailInfo](const unsigned int& j)
+		{
+			return ComputeScore(target, thumbnailInfo[j].info);
+		}, neighbors);
+
+		auto& locationCandidates(candidates[i / yCount][i % yCount]);
+		locationCandidates.resize(neighbors.size());
+		for (unsigned int j = 0; j < neighbors.size(); ++j)
+		{
+			locationCandidates[j].thumbnailIndex = neighbors[j].index;
+			locationCandidates[j].score = neighbors[j].distance;
+		}
+	});
+
+	return candidates;
+}
+
+Photomosaic::ScoreGrid Photomosaic::SelectBestScores(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo) const
+{
+	std::vector<const InfoGrid*> thumbnailGrids(thumbnailInfo.size());
+	for (unsigned int i = 0; i < thumbnailInfo.size(); ++i)
+		thumbnailGrids[i] = &thumbnailInfo[i].info;
+
+	if (config.useCascade)
+	{
+		ScoreCascade cascade(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight, config.cascadeSlack);
+		cascade.Build(thumbnailGrids, config.subSamples);
+
+		std::cout << "Scoring tiles using coarse-to-fine cascade (keeping best " << config.candidateCount << " thumbnails for each tile)..." << std::endl;
+		std::atomic<uint64_t> boundedCount(0), scoredCount(0), completedCount(0);
+		ScoreGrid candidates(ScoreInRuns(targetInfo, [&](const std::vector<InfoGrid>& targets, std::vector<std::vector<TileScore>>& runCandidates)
+		{
+			ScoreCascade::Statistics statistics;
+			ScoreColumnCascade(cascade, targets, config.candidateCount, runCandidates, statistics);
+			boundedCount += statistics.bounded;
+			scoredCount += statistics.scored;
+			completedCount += statistics.completed;
+		}));
+
+		std::cout << "Scored " << 100.0 * scoredCount / std::max<uint64_t>(boundedCount, 1) << "% of tile/thumbnail pairs; "
+			<< 100.0 * (scoredCount - completedCount) / std::max<uint64_t>(scoredCount, 1) << "% of those stopped early" << std::endl;
+		if (config.cascadeSlack > 0.0)
+			std::cout << "Candidate scores are within a factor of " << 1.0 + config.cascadeSlack << " of exact" << std::endl;
+		return candidates;
+	}
+
+	if (config.colorSpace != PhotomosaicConfig::ColorSpace::HSV)
+	{
+		const EuclideanFeatures& features(GetEuclideanFeatures());
+		EuclideanPlanes planes;
+		planes.Build(thumbnailGrids, features);
+		const EuclideanKernel kernel;
+
+		std::cout << "Scoring tiles in " << EuclideanFeatures::GetName(features.GetSpace()) << " using " << ScoringKernel::GetName(kernel.GetInstructionSet())
+			<< " matrix kernel (keeping best " << config.candidateCount << " thumbnails for each tile)..." << std::endl;
+		return ScoreInRuns(targetInfo, [this, &kernel, &features, &planes](const std::vector<InfoGrid>& targets, std::vector<std::vector<TileScore>>& runCandidates)
+		{
+			ScoreColumnTopK(kernel, features, planes, targets, config.candidateCount, runCandidates);
+		});
+	}
+
+	if (config.quantizedBits > 0)
+	{
+		QuantizedPlanes planes(config.quantizedBits);
+		planes.Build(thumbnailGrids, config.subSamples);
+		const QuantizedKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+
+		std::cout << "Scoring tiles using " << config.quantizedBits << "-bit " << ScoringKernel::GetName(kernel.GetInstructionSet())
+			<< " kernel (keeping best " << config.candidateCount << " thumbnails for each tile)..." << std::endl;
+		std::cout << "Library features use " << planes.GetSizeInBytes() << " bytes; scores are within "
+			<< kernel.GetTolerance(planes) << " of exact" << std::endl;
+		return ScoreInRuns(targetInfo, [this, &kernel, &planes](const std::vector<InfoGrid>& targets, std::vector<std::vector<TileScore>>& runCandidates)
+		{
+			ScoreColumnTopK(kernel, planes, targets, config.candidateCount, runCandidates);
+		});
+	}
+
+	FeaturePlanes planes;
+	planes.Build(thumbnailGrids, config.subSamples);
+	const ScoringKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+
+	std::cout << "Scoring tiles using " << ScoringKernel::GetName(kernel.GetInstructionSet()) << " kernel (keeping best "
+		<< config.candidateCount << " thumbnails for each tile)..." << std::endl;
+	return ScoreInRuns(targetInfo, [this, &kernel, &planes](const std::vector<InfoGrid>& targets, std::vector<std::vector<TileScore>>& runCandidates)
+	{
+		ScoreColumnTopK(kernel, planes, targets, config.candidateCount, runCandidates);
+	});
+}
+
+// Columns are split into runs of rows, so there is enough parallel work when there are few columns (an
+// adaptive layout has only one)
+Photomosaic::ScoreGrid Photomosaic::ScoreInRuns(const TargetInfo& targetInfo, const RunScorer& scoreRun)
+{
+	const unsigned int yCount(targetInfo.front().size());
+	const unsigned int rowsPerTask(64);
+	const unsigned int tasksPerColumn((yCount + rowsPerTask - 1) / rowsPerTask);
+	ScoreGrid candidates(targetInfo.size(), std::vector<std::vector<TileScore>>(yCount));
+	Executor::GetShared().ParallelFor(targetInfo.size() * tasksPerColumn, [&](const size_t& task)
+	{
+		const unsigned int x(task / tasksPerColumn);
+		const unsigned int first((task % tasksPerColumn) * rowsPerTask);
+		const unsigned int last(std::min(first + rowsPerTask, yCount));
+		const std::vector<InfoGrid> targets(targetInfo[x].begin() + first, targetInfo[x].begin() + last);
+
+		std::vector<std::vector<TileScore>> taskCandidates;
+		scoreRun(targets, taskCandidates);
+		std::move(taskCandidates.begin(), taskCandidates.end(), candidates[x].begin() + first);
+	}, 1);
+
+	return candidates;
+}
+
+void Photomosaic::ScoreColumnTopK(const ScoringKernel& kernel, const FeaturePlanes& planes, const std::vector<InfoGrid>& targetColumn,
+	const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates)
+{
+	ScoreColumnTopK([&kernel, &planes](const std::vector<float>& target, const unsigned int& begin, const unsigned int& count, float* scores)
+	{
+		kernel.Score(target, planes, begin, count, scores);
+	}, planes.GetCount(), targetColumn, candidateCount, candidates);
+}
+
+void Photomosaic::ScoreColumnTopK(const QuantizedKernel& kernel, const QuantizedPlanes& planes, const std::vector<InfoGrid>& targetColumn,
+	const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates)
+{
+	ScoreColumnTopK([&kernel, &planes](const std::vector<float>& target, const unsigned int& begin, const unsigned int& count, float* scores)
+	{
+		kernel.Score(target, planes, begin, count, scores);
+	}, planes.GetCount(), targetColumn, candidateCount, candidates);
+}
+
+// Keeps only the best few scores for each location in a column, so the full set of scores is never stored
+void Photomosaic::ScoreColumnTopK(const BlockScorer& scoreBlock, const unsigned int& thumbnailCount, const std::vector<InfoGrid>& targetColumn,
+	const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates)
+{
+	std::vector<std::vector<float>> targets(targetColumn.size());
+	for (unsigned int y = 0; y < targetColumn.size(); ++y)
+		targets[y] = FeaturePlanes::Flatten(targetColumn[y]);
+
+	// Score the whole column against one block of thumbnails at a time so the block stays in cache
+	const unsigned int blockSize(4096);
+	std::vector<float> scores(blockSize);
+	std::vector<TopKSelector<TileScore>> selectors(targetColumn.size(), TopKSelector<TileScore>(candidateCount));
+	for (unsigned int begin = 0; begin < thumbnailCount; begin += blockSize)
+	{
+		const unsigned int count(std::min(blockSize, thumbnailCount - begin));
+		for (unsigned int y = 0; y < targetColumn.size(); ++y)
+		{
+			scoreBlock(targets[y], begin, count, scores.data());
+			for (unsigned int i = 0; i < count; ++i)
+				selectors[y].Push(TileScore{ begin + i, scores[i] });
+		}
+	}
+
+	candidates.resize(targetColumn.size());
+	for (unsigned int y = 0; y < targetColumn.size(); ++y)
+		candidates[y] = selectors[y].TakeSorted();
+}
+
+// The whole column is scored against each block of thumbnails in one call, so the kernel can use each
+// thumbnail for several targets while it is in registers
+void Photomosaic::ScoreColumnTopK(const EuclideanKernel& kernel, const EuclideanFeatures& features, const EuclideanPlanes& planes,
+	const std::vector<InfoGrid>& targetColumn, const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates)
+{
+	std::vector<std::vector<float>> targets(targetColumn.size());
+	for (unsigned int y = 0; y < targetColumn.size(); ++y)
+		targets[y] = features.Convert(targetColumn[y]);
+
+	const unsigned int blockSize(1024);
+	std::vector<float> scores(targets.size() * blockSize);
+	std::vector<TopKSelector<TileScore>> selectors(targetColumn.size(), TopKSelector<TileScore>(candidateCount));
+	for (unsigned int begin = 0; begin < planes.GetCount(); begin += blockSize)
+	{
+		const unsigned int count(std::min(blockSize, planes.GetCount() - begin));
+		kernel.Score(targets, planes, begin, count, scores.data(), blockSize);
+		for (unsigned int y = 0; y < targetColumn.size(); ++y)
+		{
+			const float* targetScores(scores.data() + y * blockSize);
+			for (unsigned int i = 0; i < count; ++i)
+				selectors[y].Push(TileScore{ begin + i, targetScores[i] });
+		}
+	}
+
+	candidates.resize(targetColumn.size());
+	for (unsigned int y = 0; y < targetColumn.size(); ++y)
+		candidates[y] = selectors[y].TakeSorted();
+}
+
+void Photomosaic::ScoreColumnCascade(const ScoreCascade& cascade, const std::vector<InfoGrid>& targetColumn,
+	const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates, ScoreCascade::Statistics& statistics)
+{
+	std::vector<std::vector<float>> targets(targetColumn.size());
+	for (unsigned int y = 0; y < targetColumn.size(); ++y)
+		targets[y] = FeaturePlanes::Flatten(targetColumn[y]);
+
+	std::vector<std::vector<ScoreCascade::Candidate>> best;
+	cascade.FindBest(targets, candidateCount, best, statistics);
+
+	candidates.resize(targetColumn.size());
+	for (unsigned int y = 0; y < targetColumn.size(); ++y)
+	{
+		candidates[y].resize(best[y].size());
+		for (unsigned int i = 0; i < best[y].size(); ++i)
+			candidates[y][i] = TileScore{ best[y][i].index, best[y][i].score };
+	}
+}
+
+// Without the distance penalty, every location simply gets its best-scoring thumbnail.  With it,
+// a local search trades some color accuracy for fewer nearby repeats (see RepeatOptimizer).
+std::vector<std::vector<unsigned int>> Photomosaic::ChooseTiles(const ScoreGrid& scores, const PhotomosaicConfig& config)
 {
 	if (config.distancePenaltyScale > 0)
-		ApplyDistancePenalty(scores, config);
+	{
+		RepeatOptimizer<ScoreGrid>::Parameters parameters;
+		parameters.penaltyScale = config.distancePenaltyScale;
+		parameters.countThreshold = config.distancePenaltyCountThreshold;
+		parameters.radius = config.distancePenaltyRadius;
+		parameters.maxIterations = config.distancePenaltyIterations;
+
+		std::cout << "Reducing nearby repeats..." << std::endl;
+		RepeatOptimizer<ScoreGrid> optimizer(scores, parameters);
+		std::vector<std::vector<unsigned int>> chosenIndices(optimizer.Optimize());
+		std::cout << "Converged after " << optimizer.GetIterationCount() << " iterations" << std::endl;
+		return chosenIndices;
+	}
 
 	std::vector<std::vector<unsigned int>> chosenIndices(scores.size());
 	for (unsigned int x = 0; x < scores.size(); ++x)
@@ -111,92 +1151,338 @@ std::vector<std::vector<unsigned int>> Photomosaic::ChooseTiles(ScoreGrid& score
 	return chosenIndices;
 }
 
-// The distance penalty is generated using a "repulsive force" type model.  So the closer two tiles
-// are, the stronger they repel each other and the higher the penalty added to both tiles.
-void Photomosaic::ApplyDistancePenalty(ScoreGrid& scores, const PhotomosaicConfig& config)
-{
-	struct Coordinate
+// Each thumbnail may be used at most once, so choosing the best fit becomes an assignment problem.  The
+// auction only considers the candidates already found for each location; locations which lose out on
+// all of their candidates are retried against every unused thumbnail.  The distance penalty is not
+// needed here since there are no repeats.
+std::vector<std::vector<unsigned int>> Photomosaic::ChooseUniqueTiles(const ScoreGrid& scores, const TargetInfo& targetInfo,
+	const std::vector<ImageInfo>& thumbnailInfo) const
+{
+	const unsigned int yTiles(scores.front().size());
+	std::vector<std::vector<AuctionAssignment::Candidate>> candidates(scores.size() * yTiles);
+	double maxScore(Executor::GetShared().ParallelReduce(scores.size(), 0.0, [&scores, &candidates, yTiles](const size_t& begin, const size_t& end)
+	{
+		double chunkMaxScore(0.0);
+		for (size_t x = begin; x < end; ++x)
+		{
+			for (unsigned int y = 0; y < yTiles; ++y)
+			{
+				auto& cellCandidates(candidates[x * yTiles + y]);
+				cellCandidates.resize(scores[x][y].size());
+				for (unsigned int i = 0; i < scores[x][y].size(); ++i)
+				{
+					cellCandidates[i] = AuctionAssignment::Candidate{ scores[x][y][i].thumbnailIndex, scores[x][y][i].score };
+					chunkMaxScore = std::max(chunkMaxScore, scores[x][y][i].score);
+				}
+			}
+		}
+
+		return chunkMaxScore;
+	}, [](const double& a, const double& b) { return std::max(a, b); }));
+
+	// Leaving a location empty must cost strictly more than any candidate; otherwise, when every cost is zero,
+	// remaining unassigned is as good as any thumbnail and the auction assigns nothing
+	const auto getUnassignedCost([](const double& maxScore)
+	{
+		return maxScore + std::max(maxScore, 1.0);
+	});
+
+	std::cout << "Assigning unique thumbnails to " << candidates.size() << " tiles..." << std::endl;
+	std::vector<unsigned int> assignment(AuctionAssignment::Solve(candidates, thumbnailInfo.size(), getUnassignedCost(maxScore)));
+
+	std::vector<bool> used(thumbnailInfo.size(), false);
+	std::vector<unsigned int> unassignedCells;
+	for (unsigned int i = 0; i < assignment.size(); ++i)
+	{
+		if (assignment[i] == AuctionAssignment::unassigned)
+			unassignedCells.push_back(i);
+		else
+			used[assignment[i]] = true;
+	}
+
+	// Every retry should assign at least one location, and once there are at least as many candidates per
+	// location as there are locations left to fill, every location can be satisfied
+	unsigned int candidateCount(std::max(config.candidateCount, 16U));
+	while (!unassignedCells.empty())
+	{
+		std::cout << "Searching unused thumbnails for " << unassignedCells.size() << " tiles..." << std::endl;
+		const unsigned int unusedCount(thumbnailInfo.size() - (assignment.size() - unassignedCells.size()));
+		candidateCount = std::min(unusedCount, 2 * candidateCount);
+		TargetInfo unassignedTargets(1, std::vector<InfoGrid>(unassignedCells.size()));
+		for (unsigned int i = 0; i < unassignedCells.size(); ++i)
+			unassignedTargets.front()[i] = targetInfo[unassignedCells[i] / yTiles][unassignedCells[i] % yTiles];
+
+		const ScoreGrid unusedCandidates(FindUnusedCandidates(unassignedTargets, thumbnailInfo, used, candidateCount));
+		std::vector<std::vector<AuctionAssignment::Candidate>> retryCandidates(unassignedCells.size());
+		maxScore = 0.0;
+		for (unsigned int i = 0; i < unassignedCells.size(); ++i)
+		{
+			const auto& cellCandidates(unusedCandidates.front()[i]);
+			retryCandidates[i].resize(cellCandidates.size());
+			for (unsigned int j = 0; j < cellCandidates.size(); ++j)
+			{
+				retryCandidates[i][j] = AuctionAssignment::Candidate{ cellCandidates[j].thumbnailIndex, cellCandidates[j].score };
+				maxScore = std::max(maxScore, cellCandidates[j].score);
+			}
+		}
+
+		const std::vector<unsigned int> retryAssignment(AuctionAssignment::Solve(retryCandidates, thumbnailInfo.size(), getUnassignedCost(maxScore)));
+		std::vector<unsigned int> stillUnassigned;
+		for (unsigned int i = 0; i < unassignedCells.size(); ++i)
+		{
+			if (retryAssignment[i] == AuctionAssignment::unassigned)
+				stillUnassigned.push_back(unassignedCells[i]);
+			else
+			{
+				assignment[unassignedCells[i]] = retryAssignment[i];
+				used[retryAssignment[i]] = true;
+			}
+		}
+
+		if (stillUnassigned.size() == unassignedCells.size())
+		{
+			std::cerr << "Failed to assign unique thumbnails to " << unassignedCells.size() << " tiles" << std::endl;
+			return std::vector<std::vector<unsigned int>>();
+		}
+
+		unassignedCells.swap(stillUnassigned);
+	}
+
+	std::vector<std::vector<unsigned int>> chosenIndices(scores.size());
+	for (unsigned int x = 0; x < scores.size(); ++x)
+	{
+		chosenIndices[x].resize(yTiles);
+		for (unsigned int y = 0; y < yTiles; ++y)
+			chosenIndices[x][y] = assignment[x * yTiles + y];
+	}
+
+	return chosenIndices;
+}
+
+// Scores each target against only the thumbnails which haven't been used yet, with the same vectorized kernel
+// as SelectBestScores().  The unused thumbnails are packed into their own feature planes, so used thumbnails
+// cost nothing to skip.
+Photomosaic::ScoreGrid Photomosaic::FindUnusedCandidates(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo,
+	const std::vector<bool>& used, const unsigned int& candidateCount) const
+{
+	std::vector<unsigned int> unusedIndices;
+	std::vector<const InfoGrid*> unusedGrids;
+	for (unsigned int i = 0; i < thumbnailInfo.size(); ++i)
+	{
+		if (used[i])
+			continue;
+		unusedIndices.push_back(i);
+		unusedGrids.push_back(&thumbnailInfo[i].info);
+	}
+
+	ScoreGrid candidates;
+	if (config.colorSpace != PhotomosaicConfig::ColorSpace::HSV)
+	{
+		const EuclideanFeatures& features(GetEuclideanFeatures());
+		EuclideanPlanes planes;
+		planes.Build(unusedGrids, features);
+		const EuclideanKernel kernel;
+		candidates = ScoreInRuns(targetInfo, [&kernel, &features, &planes, &candidateCount](const std::vector<InfoGrid>& targets,
+			std::vector<std::vector<TileScore>>& runCandidates)
+		{
+			ScoreColumnTopK(kernel, features, planes, targets, candidateCount, runCandidates);
+		});
+	}
+	else
+	{
+		FeaturePlanes planes;
+		planes.Build(unusedGrids, config.subSamples);
+		const ScoringKernel kernel(config.hueErrorWeight, config.saturationErrorWeight, config.valueErrorWeight);
+		candidates = ScoreInRuns(targetInfo, [&kernel, &planes, &candidateCount](const std::vector<InfoGrid>& targets,
+			std::vector<std::vector<TileScore>>& runCandidates)
+		{
+			ScoreColumnTopK(kernel, planes, targets, candidateCount, runCandidates);
+		});
+	}
+
+	for (auto& column : candidates)
+	{
+		for (auto& cellCandidates : column)
+		{
+			for (auto& c : cellCandidates)
+				c.thumbnailIndex = unusedIndices[c.thumbnailIndex];
+		}
+	}
+
+	return candidates;
+}
+
+wxImage Photomosaic::BuildOutputImage(const std::vector<std::vector<unsigned int>>& chosenTileIndices, const std::vector<ImageInfo>& thumbnailInfo) const
+{
+	std::vector<wxImage> largeTiles;
+	const CellGrid cells(GetCellSources(chosenTileIndices, thumbnailInfo, largeTiles));
+
+	const unsigned int thumbnailSize(config.thumbnailSize);
+	wxImage image(cells.size() * thumbnailSize, cells.front().size() * thumbnailSize, false);// Every pixel is overwritten, so no need to clear
+
+	const size_t tileRowBytes(static_cast<size_t>(cells.size()) * thumbnailSize * thumbnailSize * 3);
+	unsigned char* imageData(image.GetData());
+	report->AddItems(PerformanceReport::Stage::Composition, static_cast<uint64_t>(chosenTileIndices.size()) * chosenTileIndices.front().size());
+	report->AddBytes(PerformanceReport::Stage::Composition, tileRowBytes * cells.front().size());
+	Executor::GetShared().ParallelFor(cells.front().size(), [&](const size_t& y)
+	{
+		CompositeTileRow(cells, y, thumbnailSize, imageData + y * tileRowBytes);
+	}, 1);
+
+	return std::move(image);
+}
+
+// Only a band of tile rows is held in memory at a time.  The next band is composited while the current
+// band is being encoded, so peak memory is two bands regardless of the size of the output image.
+bool Photomosaic::WriteBandedOutputImage(const std::vector<std::vector<unsigned int>>& chosenTileIndices,
+	const std::vector<ImageInfo>& thumbnailInfo, const std::string& fileName) const
+{
+	auto writer(BandedImageWriter::Create(fileName));
+	if (!writer)
+		return false;
+
+	std::vector<wxImage> largeTiles;
+	const CellGrid cells(GetCellSources(chosenTileIndices, thumbnailInfo, largeTiles));
+
+	const unsigned int thumbnailSize(config.thumbnailSize);
+	const unsigned int xTiles(cells.size());
+	const unsigned int yTiles(cells.front().size());
+	if (!writer->Open(fileName, xTiles * thumbnailSize, yTiles * thumbnailSize))
+		return false;
+
+	const unsigned int bandRows(std::min(config.outputBandRows, yTiles));
+	const size_t tileRowBytes(static_cast<size_t>(xTiles) * thumbnailSize * thumbnailSize * 3);
+	report->AddItems(PerformanceReport::Stage::Composition, static_cast<uint64_t>(chosenTileIndices.size()) * chosenTileIndices.front().size());
+	report->AddBytes(PerformanceReport::Stage::Composition, tileRowBytes * yTiles);
+	std::vector<unsigned char> bands[2];
+	bands[0].resize(tileRowBytes * bandRows);
+	bands[1].resize(tileRowBytes * bandRows);
+
+	auto compositeBand([&](const unsigned int& firstRow, unsigned char* bandData)
+	{
+		Executor::GetShared().ParallelFor(std::min(bandRows, yTiles - firstRow), [&](const size_t& i)
+		{
+			CompositeTileRow(cells, firstRow + i, thumbnailSize, bandData + i * tileRowBytes);
+		}, 1);
+	});
+
+	compositeBand(0, bands[0].data());
+	for (unsigned int firstRow = 0, band = 0; firstRow < yTiles; firstRow += bandRows, band = 1 - band)
+	{
+		std::future<void> nextBand;
+		if (firstRow + bandRows < yTiles)
+			nextBand = std::async(std::launch::async, compositeBand, firstRow + bandRows, bands[1 - band].data());
+
+		const unsigned int rowsInBand(std::min(bandRows, yTiles - firstRow));
+		const bool ok(writer->WriteRows(bands[band].data(), rowsInBand * thumbnailSize));
+		if (nextBand.valid())
+			nextBand.wait();
+
+		if (!ok)
+		{
+			std::cerr << "Failed to write image to '" << fileName << "'" << std::endl;
+			return false;
+		}
+	}
+
+	if (!writer->Close())
+	{
+		std::cerr << "Failed to write image to '" << fileName << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Each cell of the output is one thumbnail, or one part of a larger tile (rendered at the tile's size, so
+// it isn't simply an enlarged thumbnail).  largeTiles holds the rendered tiles for as long as the cells are needed.
+Photomosaic::CellGrid Photomosaic::GetCellSources(const std::vector<std::vector<unsigned int>>& chosenTileIndices,
+	const std::vector<ImageInfo>& thumbnailInfo, std::vector<wxImage>& largeTiles) const
+{
+	const unsigned int thumbnailSize(config.thumbnailSize);
+	const size_t thumbnailRowBytes(thumbnailSize * 3);
+	if (adaptiveLayout.tiles.empty())
+	{
+		CellGrid cells(chosenTileIndices.size(), std::vector<CellSource>(chosenTileIndices.front().size()));
+		for (unsigned int x = 0; x < cells.size(); ++x)
+		{
+			for (unsigned int y = 0; y < cells[x].size(); ++y)
+				cells[x][y] = CellSource{ GetThumbnailData(thumbnailInfo[chosenTileIndices[x][y]]), thumbnailRowBytes };
+		}
+
+		return cells;
+	}
+
+	// The same thumbnail may be chosen for several tiles of the same size, but only needs to be rendered once
+	const auto& tiles(adaptiveLayout.tiles);
+	std::map<std::pair<unsigned int, unsigned int>, unsigned int> largeTileIndices;
+	std::vector<std::pair<unsigned int, unsigned int>> largeTileKeys;
+	for (unsigned int i = 0; i < tiles.size(); ++i)
+	{
+		const auto key(std::make_pair(chosenTileIndices.front()[i], tiles[i].size));
+		if (tiles[i].size > 1 && largeTileIndices.insert(std::make_pair(key, static_cast<unsigned int>(largeTileKeys.size()))).second)
+			largeTileKeys.push_back(key);
+	}
+
+	largeTiles.resize(largeTileKeys.size());
+	Executor::GetShared().ParallelFor(largeTileKeys.size(), [&](const size_t& i)
 	{
-		Coordinate() = default;
-		Coordinate(const unsigned int& x, const unsigned int& y) : x(x), y(y) {}
+		const ImageInfo& thumbnail(thumbnailInfo[largeTileKeys[i].first]);
+		const unsigned int size(thumbnailSize * largeTileKeys[i].second);
+		bool isImage;
+		if (LoadThumbnailImage(thumbnail.source, std::string(), size, GetThumbnailFilter(), largeTiles[i], isImage))
+			return;
 
-		unsigned int x;
-		unsigned int y;
-	};
+		// The file may have changed since it was ingested; enlarge the thumbnail instead
+		largeTiles[i] = wxImage(size, size, false);
+		ThumbnailScaler::CropAndScale(GetThumbnailData(thumbnail), thumbnailRowBytes, 0, 0, thumbnailSize, size,
+			GetThumbnailFilter(), largeTiles[i].GetData());
+	}, 1);
 
-	for (unsigned int thumb = 0; thumb < scores.front().front().size(); ++thumb)
+	CellGrid cells(adaptiveLayout.xCells, std::vector<CellSource>(adaptiveLayout.yCells));
+	for (unsigned int i = 0; i < tiles.size(); ++i)
 	{
-		std::vector<std::vector<double>> penalty(scores.size());
-		std::vector<Coordinate> coords;
-		for (unsigned int x = 0; x < penalty.size(); ++x)
+		const ImageInfo& thumbnail(thumbnailInfo[chosenTileIndices.front()[i]]);
+		if (tiles[i].size == 1)
 		{
-			penalty[x].resize(scores.front().size());
-			for (unsigned int y = 0; y < penalty.front().size(); ++y)
-			{
-				if (scores[x][y].front().thumbnailIndex == thumb)
-				{
-					penalty[x][y] = 1.0;
-					coords.push_back(Coordinate(x, y));
-				}
-				else
-					penalty[x][y] = 0.0;
-			}
-		}
-
-		if (config.distancePenaltyCountThreshold > 0 && coords.size() < config.distancePenaltyCountThreshold)
+			cells[tiles[i].x][tiles[i].y] = CellSource{ GetThumbnailData(thumbnail), thumbnailRowBytes };
 			continue;
-
-		std::vector<std::vector<double>> distances(coords.size());
-		const unsigned int refDistance(scores.size() * scores.size() + scores.front().size() * scores.front().size());
-		for (unsigned int i = 0; i < distances.size(); ++i)
-		{
-			distances[i].resize(distances.size());
-			for (unsigned int j = 0; j < distances.front().size(); ++j)
-				distances[i][j] = static_cast<double>((coords[i].x - coords[j].x) * (coords[i].x - coords[j].x) + (coords[i].y - coords[j].y) * (coords[i].y - coords[j].y)) / refDistance;
-		}
-
-		for (unsigned int i = 0; i < coords.size(); ++i)
-		{
-			double sumRecipDistance(0.0);
-			for (unsigned int j = 0; j < distances.size(); ++j)
-			{
-				if (distances[i][j] > 0.0)
-					sumRecipDistance += 1.0 / distances[i][j];
-			}
-
-			assert(penalty[coords[i].x][coords[i].y] == 1.0);
-			penalty[coords[i].x][coords[i].y] = sumRecipDistance * config.distancePenaltyScale;
 		}
 
-		for (unsigned int x = 0; x < penalty.size(); ++x)
+		const wxImage& image(largeTiles[largeTileIndices[std::make_pair(chosenTileIndices.front()[i], tiles[i].size)]]);
+		const size_t rowBytes(thumbnailRowBytes * tiles[i].size);
+		for (unsigned int x = 0; x < tiles[i].size; ++x)
 		{
-			for (unsigned int y = 0; y < penalty.front().size(); ++y)
-				scores[x][y].front().score += penalty[x][y];
+			for (unsigned int y = 0; y < tiles[i].size; ++y)
+				cells[tiles[i].x + x][tiles[i].y + y] = CellSource{ image.GetData() + y * thumbnailSize * rowBytes + x * thumbnailRowBytes, rowBytes };
 		}
 	}
+
+	return cells;
 }
 
-wxImage Photomosaic::BuildOutputImage(const std::vector<std::vector<unsigned int>>& chosenTileIndices, const std::vector<ImageInfo>& thumbnailInfo)
+void Photomosaic::CompositeTileRow(const CellGrid& cells, const unsigned int& tileRow, const unsigned int& thumbnailSize, unsigned char* rowData)
 {
-	wxImage image(chosenTileIndices.size() * thumbnailInfo.front().image.GetWidth(), chosenTileIndices.front().size() * thumbnailInfo.front().image.GetHeight());
-	for (unsigned int i = 0; i < static_cast<unsigned int>(image.GetWidth()); ++i)
+	const size_t thumbnailRowBytes(thumbnailSize * 3);
+	const size_t outputRowBytes(cells.size() * thumbnailRowBytes);
+	for (unsigned int x = 0; x < cells.size(); ++x)
 	{
-		for (unsigned int j = 0; j < static_cast<unsigned int>(image.GetHeight()); ++j)
-		{
-			const auto thumbnailSize(thumbnailInfo.front().image.GetWidth());
-			const auto xChoice(i / thumbnailSize);
-			const auto yChoice(j / thumbnailSize);
-			const auto& thumb(thumbnailInfo[chosenTileIndices[xChoice][yChoice]].image);
-			const auto xOffset(i - xChoice * thumbnailSize);
-			const auto yOffset(j - yChoice * thumbnailSize);
-			image.SetRGB(i, j, thumb.GetRed(xOffset, yOffset), thumb.GetGreen(xOffset, yOffset), thumb.GetBlue(xOffset, yOffset));
-		}
+		const CellSource& source(cells[x][tileRow]);
+		unsigned char* destination(rowData + x * thumbnailRowBytes);
+		for (unsigned int row = 0; row < thumbnailSize; ++row)
+			memcpy(destination + row * outputRowBytes, source.data + row * source.rowBytes, thumbnailRowBytes);
 	}
+}
 
-	return std::move(image);
+InfoGrid Photomosaic::GetColorInformation(const wxImage& image, const unsigned int& subSamples)
+{
+	InfoGrid info;
+	ColorStatistics::ComputeInfoGrid(image.GetData(), image.GetWidth() * 3, 0, 0, image.GetWidth(), subSamples, info);
+	return info;
 }
 
-Photomosaic::InfoGrid Photomosaic::GetColorInformation(const wxImage& image, const unsigned int& subSamples)
+// Original per-pixel implementation, retained as the reference for ColorStatistics
+InfoGrid Photomosaic::GetColorInformationReference(const wxImage& image, const unsigned int& subSamples)
 {
 	InfoGrid info(subSamples);
 	const unsigned int sampleDimension(image.GetWidth() / subSamples);
@@ -239,12 +1525,15 @@ std::vector<std::vector<double>> Photomosaic::ScoreAllThumbnailsOnGrid(const Tar
 // Implemented as a cost function, so lower values represent better fits
 double Photomosaic::ComputeScore(const InfoGrid& targetSquare, const InfoGrid& thumbnail) const
 {
+	if (config.colorSpace != PhotomosaicConfig::ColorSpace::HSV)
+		return EuclideanFeatures::GetDistance(euclideanFeatures.Convert(targetSquare), euclideanFeatures.Convert(thumbnail));
+
 	double score(0.0);
 	for (unsigned int i = 0; i < targetSquare.size(); ++i)
 	{
 		for (unsigned int j = 0; j < targetSquare.front().size(); ++j)
 		{
-			const double hueError(fmod(targetSquare[i][j].hue - thumbnail[i][j].hue, 1.0));
+			const double hueError(fabs(fmod(targetSquare[i][j].hue - thumbnail[i][j].hue, 1.0)));
 			if (hueError > 0.5)
 				score += (1.0 - hueError) * config.hueErrorWeight;
 			else
@@ -257,136 +1546,668 @@ double Photomosaic::ComputeScore(const InfoGrid& targetSquare, const InfoGrid& t
 	return score;
 }
 
-std::vector<Photomosaic::ImageInfo> Photomosaic::GetThumbnailInfo() const
+EuclideanFeatures Photomosaic::MakeEuclideanFeatures(const PhotomosaicConfig& config)
 {
-	std::vector<Photomosaic::ImageInfo> info;
-	ThreadPool pool(std::thread::hardware_concurrency() * 2);
-	std::mutex infoAccessMutex;
-	
-	if (config.recursiveSourceDirectories)
+	return EuclideanFeatures(config.colorSpace == PhotomosaicConfig::ColorSpace::Lab ? EuclideanFeatures::Space::Lab
+		: EuclideanFeatures::Space::YCbCr, config.lightnessWeight, config.chromaWeight);
+}
+
+Photomosaic::ConvertedTargetInfo Photomosaic::ConvertTargetInfo(const TargetInfo& targetGrid) const
+{
+	ConvertedTargetInfo converted(targetGrid.size());
+	Executor::GetShared().ParallelFor(targetGrid.size(), [this, &targetGrid, &converted](const size_t& i)
+	{
+		converted[i].resize(targetGrid[i].size());
+		for (unsigned int j = 0; j < targetGrid[i].size(); ++j)
+			converted[i][j] = euclideanFeatures.Convert(targetGrid[i][j]);
+	});
+
+	return converted;
+}
+
+std::vector<std::vector<double>> Photomosaic::ScoreAllThumbnailsOnGrid(const ConvertedTargetInfo& targetGrid, const std::vector<float>& thumbnail)
+{
+	std::vector<std::vector<double>> scores(targetGrid.size());
+	for (unsigned int i = 0; i < targetGrid.size(); ++i)
+	{
+		scores[i].resize(targetGrid[i].size());
+		for (unsigned int j = 0; j < targetGrid[i].size(); ++j)
+			scores[i][j] = EuclideanFeatures::GetDistance(targetGrid[i][j], thumbnail);
+	}
+
+	return scores;
+}
+
+const unsigned char* Photomosaic::GetThumbnailData(const ImageInfo& thumbnail) const
+{
+	if (thumbnail.atlasSlot != ThumbnailAtlas::noSlot)
+		return atlas->GetThumbnail(thumbnail.atlasSlot);
+	return thumbnail.image.GetData();
+}
+
+std::vector<Photomosaic::ImageInfo> Photomosaic::GetThumbnailInfo()
+{
+	LibraryIndex index;
+	if (!config.libraryIndexFileName.empty() && index.Load(config.libraryIndexFileName, config.thumbnailSize, GetThumbnailFilter(), config.subSamples))
+		std::cout << "Loaded library index with " << index.GetEntryCount() << " entries" << std::endl;
+
+	if (!config.thumbnailAtlasFileName.empty() && !atlas->Open(config.thumbnailAtlasFileName, config.thumbnailSize))
+		atlas->Create(config.thumbnailAtlasFileName, config.thumbnailSize);
+
+	IngestResults results;
+	RunIngestPipeline([this, &index](BoundedQueue<IngestItem>& output, IngestResults& results)
+	{
+		EnumerateLibrary(index, output, results);
+	}, results);
+
+	const uint64_t originalAtlasId(atlas->GetId());
+	duplicateEntries.clear();
+	if (atlas->IsOpen())
+		UpdateAtlas(results.info);
+
+	rejectedEntries = std::move(results.rejected);
+	if (config.removeDuplicates)
+		RemoveDuplicates(results.info);
+
+	if (!config.libraryIndexFileName.empty())
 	{
-		if (!config.centerFocusSourceDirectory.empty())
+		const unsigned int entryCount(static_cast<unsigned int>(results.info.size() + rejectedEntries.size() + duplicateEntries.size()));
+		std::cout << results.indexHits << " of " << entryCount << " library entries were found in the index" << std::endl;
+
+		// Rewrite the index if anything was added, changed or removed
+		if (results.indexHits != entryCount || results.indexHits != index.GetEntryCount() || atlas->GetId() != originalAtlasId)
 		{
-			for (auto& entry : stdfs::recursive_directory_iterator(config.centerFocusSourceDirectory))
-				pool.AddJob(std::make_unique<ThumbnailProcessJob>(entry, config, CropHint::Center, info, infoAccessMutex));
+			index.Close();
+			WriteLibraryIndex(results.info);
 		}
+	}
+
+	return std::move(results.info);
+}
+
+// Ingest is a pipeline of stages, each with its own threads, connected by bounded queues:  enumerate
+// (this thread) -> read -> decode -> crop and scale -> extract features -> write caches.  Reading and
+// writing are limited by the disk rather than the CPU, so they get their own thread counts, and the
+// queues keep the number of files in flight (and so memory use) constant regardless of library size.
+void Photomosaic::RunIngestPipeline(const std::function<void(BoundedQueue<IngestItem>&, IngestResults&)>& enumerate, IngestResults& results)
+{
+	const unsigned int cpuThreadCount(Executor::GetShared().GetThreadCount());
+	const unsigned int decodeThreadCount(cpuThreadCount);
+	const unsigned int scaleThreadCount(std::max(cpuThreadCount / 2, 1U));
+	const unsigned int featureThreadCount(std::max(cpuThreadCount / 4, 1U));
+
+	BoundedQueue<IngestItem> readQueue(2 * config.ingestReadThreads);
+	BoundedQueue<IngestItem> decodeQueue(2 * decodeThreadCount);
+	BoundedQueue<IngestItem> scaleQueue(2 * scaleThreadCount);
+	BoundedQueue<IngestItem> featureQueue(2 * featureThreadCount);
+	BoundedQueue<IngestItem> cacheQueue(2 * config.ingestReadThreads);
 
-		if (!config.leftFocusSourceDirectory.empty())
+	// Times each step, and sends items which can go no further straight to the results
+	const auto makeStep([this, &results](const std::function<bool(IngestItem&)>& step)
+	{
+		return [this, &results, step](IngestItem& item)
 		{
-			for (auto& entry : stdfs::recursive_directory_iterator(config.leftFocusSourceDirectory))
-				pool.AddJob(std::make_unique<ThumbnailProcessJob>(entry, config, CropHint::Left, info, infoAccessMutex));
-		}
-			
-		if (!config.rightFocusSourceDirectory.empty())
+			const auto start(std::chrono::steady_clock::now());
+			const bool passOn(step(item));
+			item.processingSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (!passOn)
+				FinishLibraryEntry(item, results);
+			return passOn;
+		};
+	});
+
+	// On return, each stage waits for its input queue to be drained and closed, so stages finish in order
+	PipelineStage readers(config.ingestReadThreads, readQueue, decodeQueue, makeStep([this](IngestItem& item) { return ReadLibraryFile(item); }));
+	PipelineStage decoders(decodeThreadCount, decodeQueue, scaleQueue, makeStep([this](IngestItem& item) { return DecodeLibraryImage(item); }));
+	PipelineStage scalers(scaleThreadCount, scaleQueue, featureQueue, makeStep([this](IngestItem& item) { return ScaleLibraryImage(item); }));
+	PipelineStage extractors(featureThreadCount, featureQueue, cacheQueue, makeStep([this](IngestItem& item) { return ExtractLibraryFeatures(item); }));
+	PipelineStage writers(config.ingestReadThreads, cacheQueue, [this, &results](IngestItem& item)
+	{
+		CacheLibraryThumbnail(item);
+		FinishLibraryEntry(item, results);
+	});
+
+	const ProducerGuard<IngestItem> producer(readQueue);
+	enumerate(readQueue, results);
+}
+
+void Photomosaic::WriteLibraryIndex(const std::vector<ImageInfo>& thumbnailInfo) const
+{
+	std::vector<LibraryIndex::Entry> entries(rejectedEntries);
+	entries.insert(entries.end(), duplicateEntries.begin(), duplicateEntries.end());
+	entries.reserve(entries.size() + thumbnailInfo.size());
+	for (const auto& thumbnail : thumbnailInfo)
+	{
+		LibraryIndex::Entry entry;
+		entry.key = thumbnail.source;
+		entry.info = thumbnail.info;
+		entry.atlasSlot = thumbnail.atlasSlot;
+		entry.perceptualHash = thumbnail.perceptualHash;
+		entries.push_back(std::move(entry));
+	}
+
+	LibraryIndex::Write(config.libraryIndexFileName, config.thumbnailSize, GetThumbnailFilter(), config.subSamples, atlas->GetId(), entries);
+}
+
+// Near-duplicates (burst shots, re-exports) have perceptual hashes within DUPLICATE_HASH_DISTANCE bits and
+// color features which score within DUPLICATE_COLOR_THRESHOLD per subsample.  Thumbnails are visited
+// largest file first, and each is kept unless it is a near-duplicate of one which was already kept, so each
+// cluster is represented by its (probably) highest-quality copy.
+void Photomosaic::RemoveDuplicates(std::vector<ImageInfo>& thumbnailInfo)
+{
+	std::vector<unsigned int> order(thumbnailInfo.size());
+	for (unsigned int i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&thumbnailInfo](const unsigned int& a, const unsigned int& b)
+	{
+		const LibraryIndex::Key& keyA(thumbnailInfo[a].source);
+		const LibraryIndex::Key& keyB(thumbnailInfo[b].source);
+		if (keyA.fileSize != keyB.fileSize)
+			return keyA.fileSize > keyB.fileSize;
+		return keyA.path < keyB.path;
+	});
+
+	std::vector<uint64_t> hashes(order.size());
+	for (unsigned int i = 0; i < order.size(); ++i)
+		hashes[i] = thumbnailInfo[order[i]].perceptualHash;
+
+	// Near-duplicates of each thumbnail which come before it in the visiting order
+	std::vector<std::vector<float>> converted;
+	if (config.colorSpace != PhotomosaicConfig::ColorSpace::HSV)
+	{
+		converted.resize(order.size());
+		Executor::GetShared().ParallelFor(order.size(), [this, &thumbnailInfo, &order, &converted](const size_t& i)
 		{
-			for (auto& entry : stdfs::recursive_directory_iterator(config.rightFocusSourceDirectory))
-				pool.AddJob(std::make_unique<ThumbnailProcessJob>(entry, config, CropHint::Right, info, infoAccessMutex));
-		}
+			converted[i] = euclideanFeatures.Convert(thumbnailInfo[order[i]].info);
+		});
 	}
-	else
+
+	const HammingIndex index(hashes, config.duplicateHashDistance);
+	const double maxScore(config.duplicateColorThreshold * config.subSamples * config.subSamples);
+	std::vector<std::vector<unsigned int>> earlierDuplicates(order.size());
+	Executor::GetShared().ParallelFor(order.size(), [this, &thumbnailInfo, &order, &converted, &index, maxScore, &earlierDuplicates](const size_t& i)
 	{
-		if (!config.centerFocusSourceDirectory.empty())
+		thread_local std::vector<unsigned int> neighbors;
+		index.FindNeighbors(i, neighbors);
+		for (const auto& j : neighbors)
 		{
-			for (auto& entry : stdfs::directory_iterator(config.centerFocusSourceDirectory))
-				pool.AddJob(std::make_unique<ThumbnailProcessJob>(entry, config, CropHint::Center, info, infoAccessMutex));
+			if (j >= i)
+				continue;
+
+			const double score(converted.empty() ? ComputeScore(thumbnailInfo[order[i]].info, thumbnailInfo[order[j]].info)
+				: EuclideanFeatures::GetDistance(converted[i], converted[j]));
+			if (score <= maxScore)
+				earlierDuplicates[i].push_back(j);
 		}
+	});
 
-		if (!config.leftFocusSourceDirectory.empty())
+	const unsigned int noIndex(std::numeric_limits<unsigned int>::max());
+	std::vector<unsigned int> representatives(thumbnailInfo.size(), noIndex);
+	std::vector<bool> isRepresentative(thumbnailInfo.size(), false);
+	unsigned int droppedCount(0);
+	for (unsigned int i = 0; i < order.size(); ++i)
+	{
+		for (const auto& j : earlierDuplicates[i])
 		{
-			for (auto& entry : stdfs::directory_iterator(config.leftFocusSourceDirectory))
-				pool.AddJob(std::make_unique<ThumbnailProcessJob>(entry, config, CropHint::Left, info, infoAccessMutex));
+			if (representatives[order[j]] == noIndex)
+			{
+				representatives[order[i]] = order[j];
+				isRepresentative[order[j]] = true;
+				++droppedCount;
+				break;
+			}
 		}
-			
-		if (!config.rightFocusSourceDirectory.empty())
+	}
+
+	if (droppedCount == 0)
+	{
+		std::cout << "Found no near-duplicate thumbnails" << std::endl;
+		return;
+	}
+
+	std::cout << "Dropping " << droppedCount << " near-duplicate thumbnails from "
+		<< std::count(isRepresentative.begin(), isRepresentative.end(), true) << " clusters" << std::endl;
+	if (!config.duplicateReportFileName.empty())
+		WriteDuplicateReport(thumbnailInfo, representatives);
+
+	unsigned int count(0);
+	for (unsigned int i = 0; i < thumbnailInfo.size(); ++i)
+	{
+		if (representatives[i] != noIndex)
 		{
-			for (auto& entry : stdfs::directory_iterator(config.rightFocusSourceDirectory))
-				pool.AddJob(std::make_unique<ThumbnailProcessJob>(entry, config, CropHint::Right, info, infoAccessMutex));
+			LibraryIndex::Entry entry;
+			entry.key = std::move(thumbnailInfo[i].source);
+			entry.info = std::move(thumbnailInfo[i].info);
+			entry.atlasSlot = thumbnailInfo[i].atlasSlot;
+			entry.perceptualHash = thumbnailInfo[i].perceptualHash;
+			duplicateEntries.push_back(std::move(entry));
+			continue;
 		}
+
+		if (i != count)
+			thumbnailInfo[count] = std::move(thumbnailInfo[i]);
+		++count;
 	}
-	
-	pool.WaitForAllJobsComplete();
-	return std::move(info);
+
+	thumbnailInfo.resize(count);
+}
+
+// One line per dropped thumbnail:  its path, the path of the thumbnail kept in its place, and how far apart they are
+bool Photomosaic::WriteDuplicateReport(const std::vector<ImageInfo>& thumbnailInfo, const std::vector<unsigned int>& representatives) const
+{
+	std::ofstream file(config.duplicateReportFileName);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open '" << config.duplicateReportFileName << "' for output" << std::endl;
+		return false;
+	}
+
+	file << "# dropped\tkept\thash distance\tcolor score\n";
+	for (unsigned int i = 0; i < thumbnailInfo.size(); ++i)
+	{
+		if (representatives[i] >= thumbnailInfo.size())
+			continue;
+
+		const ImageInfo& kept(thumbnailInfo[representatives[i]]);
+		file << thumbnailInfo[i].source.path << '\t' << kept.source.path << '\t'
+			<< PerceptualHash::GetDistance(thumbnailInfo[i].perceptualHash, kept.perceptualHash) << '\t'
+			<< ComputeScore(thumbnailInfo[i].info, kept.info) << '\n';
+	}
+
+	if (!file.good())
+	{
+		std::cerr << "Failed to write duplicate report to '" << config.duplicateReportFileName << "'" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void Photomosaic::EnumerateLibrary(const LibraryIndex& index, BoundedQueue<IngestItem>& output, IngestResults& results)
+{
+	const auto addDirectory([this, &index, &output, &results](const std::string& directory, const CropHint& cropHint)
+	{
+		if (!directory.empty())
+			EnumerateDirectory(directory, cropHint, index, output, results);
+	});
+
+	addDirectory(config.centerFocusSourceDirectory, CropHint::Center);
+	addDirectory(config.leftFocusSourceDirectory, CropHint::Left);
+	addDirectory(config.rightFocusSourceDirectory, CropHint::Right);
+}
+
+// Directories which can't be read are reported and skipped, rather than abandoning the rest of the library.
+// Symbolic links to directories are not followed, as for std::filesystem::recursive_directory_iterator.
+void Photomosaic::EnumerateDirectory(const std::string& directory, const CropHint& cropHint, const LibraryIndex& index,
+	BoundedQueue<IngestItem>& output, IngestResults& results)
+{
+	std::error_code errorCode;
+	stdfs::directory_iterator it(directory, errorCode);
+	for (; !errorCode && it != stdfs::directory_iterator(); it.increment(errorCode))
+	{
+		std::error_code statusError;
+		if (config.recursiveSourceDirectories && it->is_directory(statusError) && !it->is_symlink(statusError))
+			EnumerateDirectory(it->path().generic_string(), cropHint, index, output, results);
+		else
+			AddLibraryEntry(*it, cropHint, index, output, results);
+	}
+
+	if (errorCode)
+		std::cerr << "Failed to read directory '" << directory << "':  " << errorCode.message() << std::endl;
+}
+
+void Photomosaic::AddLibraryEntry(const stdfs::directory_entry& entry, const CropHint& cropHint, const LibraryIndex& index,
+	BoundedQueue<IngestItem>& output, IngestResults& results)
+{
+	IngestItem item;
+	if (!GetIndexKey(entry, cropHint, item.thumbnail.source))
+		return;
+
+	item.lookup = index.Lookup(item.thumbnail.source, item.thumbnail.info, item.thumbnail.atlasSlot, item.thumbnail.perceptualHash);
+
+	// When using an atlas, index entries are only useful if their pixels are in this atlas, too
+	if (item.lookup == LibraryIndex::LookupResult::Found && atlas->IsOpen() &&
+		(index.GetAtlasId() != atlas->GetId() || !atlas->GetThumbnail(item.thumbnail.atlasSlot)))
+		item.lookup = LibraryIndex::LookupResult::Missing;
+
+	if (item.lookup == LibraryIndex::LookupResult::Missing)
+		output.Push(std::move(item));
+	else
+	{
+		item.isImage = item.lookup != LibraryIndex::LookupResult::NotAnImage;
+		FinishLibraryEntry(item, results);
+	}
+}
+
+// Existing thumbnails are much smaller than the originals, so use them when available
+bool Photomosaic::ReadLibraryFile(IngestItem& item) const
+{
+	if (!config.thumbnailDirectory.empty() && ReadFile(GetThumbnailPath(item.thumbnail.source, config.thumbnailDirectory), item.fileData))
+	{
+		item.fromThumbnailDirectory = true;
+		return true;
+	}
+
+	if (ReadFile(item.thumbnail.source.path, item.fileData))
+		return true;
+
+	// Not remembered as a non-image, so it will be tried again next time
+	std::cerr << "Failed to read '" << item.thumbnail.source.path << "'\n";
+	item.ok = false;
+	return false;
+}
+
+bool Photomosaic::DecodeLibraryImage(IngestItem& item) const
+{
+	wxLogNull noLog;// Disable logging when loading image files since we expect that some or all may fail
+
+	const bool decoded(DecodeImage(item.fileData, config.thumbnailSize, item.thumbnail.image));
+	item.fileData = std::vector<unsigned char>();
+	if (decoded)
+		return true;
+
+	if (item.fromThumbnailDirectory)
+	{
+		item.fromThumbnailDirectory = false;
+		std::vector<unsigned char> data;
+		if (ReadFile(item.thumbnail.source.path, data) && DecodeImage(data, config.thumbnailSize, item.thumbnail.image))
+			return true;
+	}
+
+	std::cerr << "Failed to load image from '" << item.thumbnail.source.path << "'\n";
+	item.isImage = false;
+	return false;
+}
+
+bool Photomosaic::ScaleLibraryImage(IngestItem& item) const
+{
+	wxImage& image(item.thumbnail.image);
+	if (!item.fromThumbnailDirectory)
+	{
+		CropAndScale(static_cast<CropHint>(item.thumbnail.source.cropHint), config.thumbnailSize, GetThumbnailFilter(), image);
+		return true;
+	}
+
+	if (image.GetWidth() == config.thumbnailSize && image.GetHeight() == config.thumbnailSize)
+		return true;
+
+	std::cerr << "Loaded existing thumbnail; expected dimension = " << config.thumbnailSize << "x" << config.thumbnailSize
+		<< " but found dimension = " << image.GetWidth() << "x" << image.GetHeight() << '\n';
+	item.ok = false;
+	return false;
+}
+
+bool Photomosaic::ExtractLibraryFeatures(IngestItem& item) const
+{
+	item.thumbnail.info = GetColorInformation(item.thumbnail.image, config.subSamples);
+	item.thumbnail.perceptualHash = PerceptualHash::Compute(item.thumbnail.image.GetData(), item.thumbnail.image.GetWidth(), item.thumbnail.image.GetHeight());
+	return true;
+}
+
+void Photomosaic::CacheLibraryThumbnail(IngestItem& item)
+{
+	if (!config.thumbnailDirectory.empty() && !item.fromThumbnailDirectory)
+	{
+		const std::string thumbnailPath(GetThumbnailPath(item.thumbnail.source, config.thumbnailDirectory));
+		if (!item.thumbnail.image.SaveFile(thumbnailPath))
+			std::cerr << "Failed to write thumbnail to '" << thumbnailPath << '\'' << std::endl;
+	}
+
+	if (atlas->IsOpen())
+	{
+		item.thumbnail.atlasSlot = atlas->Append(item.thumbnail.image.GetData());
+		if (item.thumbnail.atlasSlot != ThumbnailAtlas::noSlot)
+			item.thumbnail.image.Destroy();
+	}
+}
+
+void Photomosaic::FinishLibraryEntry(IngestItem& item, IngestResults& results) const
+{
+	if (item.lookup == LibraryIndex::LookupResult::Missing && item.isImage)
+	{
+		report->RecordDecode(item.thumbnail.source.path, item.processingSeconds, item.thumbnail.source.fileSize);
+		report->AddBytes(PerformanceReport::Stage::ThumbnailIngest, item.thumbnail.source.fileSize);
+	}
+
+	if (!item.ok)
+		return;
+
+	if (!atlas->IsOpen())
+		item.thumbnail.atlasSlot = ThumbnailAtlas::noSlot;
+
+	report->AddItems(PerformanceReport::Stage::ThumbnailIngest, 1);
+	std::lock_guard<std::mutex> lock(results.mutex);
+	if (item.lookup != LibraryIndex::LookupResult::Missing)
+		++results.indexHits;
+
+	if (item.isImage)
+		results.info.push_back(std::move(item.thumbnail));
+	else
+	{
+		LibraryIndex::Entry rejectedEntry;
+		rejectedEntry.key = std::move(item.thumbnail.source);
+		rejectedEntry.isImage = false;
+		results.rejected.push_back(std::move(rejectedEntry));
+	}
+}
+
+void Photomosaic::UpdateAtlas(std::vector<ImageInfo>& thumbnailInfo)
+{
+	const auto clearSlots([this, &thumbnailInfo]()
+	{
+		for (auto& thumbnail : thumbnailInfo)
+			thumbnail.atlasSlot = ThumbnailAtlas::noSlot;
+		for (auto& entry : duplicateEntries)
+			entry.atlasSlot = ThumbnailAtlas::noSlot;
+	});
+
+	if (!atlas->Commit())
+	{
+		// Fall back to decoding chosen thumbnails on demand
+		clearSlots();
+		atlas->Close();
+		return;
+	}
+
+	// Slots for deleted or modified library files are never reused, so rewrite the atlas once they make up most of it
+	if (atlas->GetCount() <= 2 * (thumbnailInfo.size() + duplicateEntries.size()))
+		return;
+
+	std::cout << "Compacting thumbnail atlas..." << std::endl;
+	std::vector<unsigned int> liveSlots;
+	liveSlots.reserve(thumbnailInfo.size() + duplicateEntries.size());
+	const auto keepSlot([&liveSlots](unsigned int& slot)
+	{
+		if (slot == ThumbnailAtlas::noSlot)
+			return;
+		liveSlots.push_back(slot);
+		slot = static_cast<unsigned int>(liveSlots.size() - 1);
+	});
+
+	for (auto& thumbnail : thumbnailInfo)
+		keepSlot(thumbnail.atlasSlot);
+
+	// Dropped duplicates stay in the index, and are used again if their representative is removed
+	for (auto& entry : duplicateEntries)
+		keepSlot(entry.atlasSlot);
+
+	if (!atlas->Compact(liveSlots))
+	{
+		clearSlots();
+		atlas->Close();
+	}
+}
+
+bool Photomosaic::LoadChosenThumbnails(const std::vector<std::vector<unsigned int>>& chosenTiles, std::vector<ImageInfo>& thumbnailInfo) const
+{
+	std::vector<bool> required(thumbnailInfo.size(), false);
+	for (const auto& column : chosenTiles)
+	{
+		for (const auto& index : column)
+			required[index] = thumbnailInfo[index].atlasSlot == ThumbnailAtlas::noSlot && !thumbnailInfo[index].image.IsOk();
+	}
+
+	return LoadThumbnails(required, thumbnailInfo);
+}
+
+bool Photomosaic::LoadThumbnails(const std::vector<bool>& required, std::vector<ImageInfo>& thumbnailInfo) const
+{
+	const unsigned int loadCount(static_cast<unsigned int>(std::count(required.begin(), required.end(), true)));
+	if (loadCount == 0)
+		return true;
+
+	std::cout << "Loading " << loadCount << " thumbnails..." << std::endl;
+	std::unique_ptr<bool[]> loaded(new bool[thumbnailInfo.size()]);
+	Executor::GetShared().ParallelFor(thumbnailInfo.size(), [this, &required, &thumbnailInfo, &loaded](const size_t& i)
+	{
+		bool isImage;
+		if (required[i])
+			loaded[i] = LoadThumbnailImage(thumbnailInfo[i].source, config.thumbnailDirectory, config.thumbnailSize,
+				GetThumbnailFilter(), thumbnailInfo[i].image, isImage);
+	});
+
+	bool ok(true);
+	for (unsigned int i = 0; i < thumbnailInfo.size(); ++i)
+	{
+		if (required[i] && !loaded[i])
+		{
+			std::cerr << "Failed to load thumbnail for '" << thumbnailInfo[i].source.path << "'; try deleting the library index" << std::endl;
+			ok = false;
+		}
+	}
+
+	return ok;
 }
 
-bool Photomosaic::ProcessThumbnailDirectoryEntry(const stdfs::directory_entry& entry, const std::string& thumbnailDirectory, const CropHint& cropHint,
-	ImageInfo& info, const unsigned int& thumbnailSize, const unsigned int& subSamples)
+bool Photomosaic::GetIndexKey(const stdfs::directory_entry& entry, const CropHint& cropHint, LibraryIndex::Key& key)
 {
+	std::error_code errorCode;
 #ifdef _WIN32
-	if (entry.status().type() != stdfs::file_type::regular)
+	if (entry.status(errorCode).type() != stdfs::file_type::regular)
 #else
-	if (!entry.is_regular_file())
+	if (!entry.is_regular_file(errorCode))
 #endif// _WIN32
 		return false;
 
+	key.path = stdfs::absolute(entry.path(), errorCode).generic_string();
+	if (errorCode)
+		return false;
+	key.modificationTime = static_cast<int64_t>(stdfs::last_write_time(entry.path(), errorCode).time_since_epoch().count());
+	if (errorCode)
+		return false;
+	key.fileSize = static_cast<uint64_t>(stdfs::file_size(entry.path(), errorCode));
+	if (errorCode)
+		return false;
+	key.cropHint = static_cast<unsigned char>(cropHint);
+	return true;
+}
+
+bool Photomosaic::LoadThumbnailImage(const LibraryIndex::Key& source, const std::string& thumbnailDirectory,
+	const unsigned int& thumbnailSize, const ThumbnailScaler::Filter& filter, wxImage& image, bool& isImage)
+{
 	wxLogNull noLog;// Disable logging when loading image files since we expect that some or all may fail
 
+	isImage = true;
 	bool foundExistingThumbnail(false);
 	if (!thumbnailDirectory.empty())
 	{
-		const std::string sep([&thumbnailDirectory]()
-		{
-#ifdef _WIN32
-			if (thumbnailDirectory.back() != '\\')
-				return std::string("\\");
-#else
-			if (thumbnailDirectory.back() != '/')
-				return std::string("/");
-#endif
-			return std::string();
-		}());
-
-		foundExistingThumbnail = info.image.LoadFile(thumbnailDirectory + sep + entry.path().filename().generic_string());
+		foundExistingThumbnail = image.LoadFile(GetThumbnailPath(source, thumbnailDirectory));
 		if (foundExistingThumbnail &&
-			(static_cast<unsigned int>(info.image.GetWidth()) != thumbnailSize || static_cast<unsigned int>(info.image.GetHeight()) != thumbnailSize))
+			(static_cast<unsigned int>(image.GetWidth()) != thumbnailSize || static_cast<unsigned int>(image.GetHeight()) != thumbnailSize))
 		{
 			std::cerr << "Loaded existing thumbnail; expected dimension = " << thumbnailSize << "x" << thumbnailSize
-				<< " but found dimension = " << info.image.GetWidth() << "x" << info.image.GetHeight() << '\n';
+				<< " but found dimension = " << image.GetWidth() << "x" << image.GetHeight() << '\n';
 			return false;
 		}
 	}
 
 	if (!foundExistingThumbnail)
 	{
-		if (!info.image.LoadFile(entry.path().generic_string()))
+		std::vector<unsigned char> data;
+		if (!ReadFile(source.path, data) || !DecodeImage(data, thumbnailSize, image))
 		{
-			std::cerr << "Failed to load image from '" << entry.path().generic_string() << "'\n";
+			std::cerr << "Failed to load image from '" << source.path << "'\n";
+			isImage = false;
 			return false;
 		}
 
-		const int minDim(std::min(info.image.GetHeight(), info.image.GetWidth()));
-		const wxSize squareSize(minDim, minDim);
-		wxPoint offset;
-		if (minDim == info.image.GetWidth())// No implementation for crop top/bottom, so force these to center vertically for now
-			offset = wxPoint(0, (info.image.GetWidth() - info.image.GetHeight()) / 2);
-		else if (cropHint == CropHint::Center)
-			offset = wxPoint((minDim - info.image.GetWidth()) / 2, 0);
-		else if (cropHint == CropHint::Left)
-			offset = wxPoint(0, 0);
-		else if (cropHint == CropHint::Right)
-			offset = wxPoint(minDim - info.image.GetWidth(), 0);
-		else
-		{
-			assert(false && "unexpected crop hint");
-		}
-
-		info.image.Resize(squareSize, offset);
-		info.image.Rescale(thumbnailSize, thumbnailSize);
+		CropAndScale(static_cast<CropHint>(source.cropHint), thumbnailSize, filter, image);
 		
 		if (!thumbnailDirectory.empty())
 		{
-			stdfs::path thumbnailPath(thumbnailDirectory);
-			thumbnailPath.append(entry.path().filename().generic_string());
-			if (!info.image.SaveFile(thumbnailPath.generic_string()))
-				std::cerr << "Failed to write thumbnail to '" << thumbnailPath.generic_string() << '\'' << std::endl;
+			const std::string thumbnailPath(GetThumbnailPath(source, thumbnailDirectory));
+			if (!image.SaveFile(thumbnailPath))
+				std::cerr << "Failed to write thumbnail to '" << thumbnailPath << '\'' << std::endl;
 		}
 	}
 
-	info.info = GetColorInformation(info.image, subSamples);
-		
 	return true;
 }
 
-Photomosaic::SquareInfo Photomosaic::RGBToHSV(const double& red, const double& blue, const double& green)
+std::string Photomosaic::GetThumbnailPath(const LibraryIndex::Key& source, const std::string& thumbnailDirectory)
+{
+	stdfs::path thumbnailPath(thumbnailDirectory);
+	thumbnailPath.append(stdfs::path(source.path).filename().generic_string());
+	return thumbnailPath.generic_string();
+}
+
+bool Photomosaic::ReadFile(const std::string& fileName, std::vector<unsigned char>& data)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	const std::streamoff size(file.tellg());
+	if (size <= 0)
+		return false;
+
+	data.resize(static_cast<size_t>(size));
+	file.seekg(0);
+	return file.read(reinterpret_cast<char*>(data.data()), size).good();
+}
+
+// Images only need to be decoded at a size large enough to make the thumbnail
+bool Photomosaic::DecodeImage(const std::vector<unsigned char>& data, const unsigned int& minimumSize, wxImage& image)
+{
+	if (JpegDecoder::Decode(data, minimumSize, image))
+		return true;
+
+	wxMemoryInputStream stream(data.data(), data.size());
+	return image.LoadFile(stream);
+}
+
+void Photomosaic::CropAndScale(const CropHint& cropHint, const unsigned int& thumbnailSize, const ThumbnailScaler::Filter& filter, wxImage& image)
+{
+	const unsigned int width(image.GetWidth());
+	const unsigned int height(image.GetHeight());
+	const unsigned int minDim(std::min(width, height));
+	unsigned int left(0), top(0);
+	if (minDim == width)// No implementation for crop top/bottom, so force these to center vertically for now
+		top = (height - width) / 2;
+	else if (cropHint == CropHint::Center)
+		left = (width - minDim) / 2;
+	else if (cropHint == CropHint::Left)
+		left = 0;
+	else if (cropHint == CropHint::Right)
+		left = width - minDim;
+	else
+	{
+		assert(false && "unexpected crop hint");
+	}
+
+	wxImage thumbnail(thumbnailSize, thumbnailSize, false);
+	ThumbnailScaler::CropAndScale(image.GetData(), static_cast<size_t>(width) * 3, left, top, minDim, thumbnailSize, filter, thumbnail.GetData());
+	image = thumbnail;
+}
+
+ThumbnailScaler::Filter Photomosaic::GetThumbnailFilter() const
+{
+	if (config.fastThumbnails)
+		return ThumbnailScaler::Filter::Box;
+	return ThumbnailScaler::Filter::Area;
+}
+
+SquareInfo Photomosaic::RGBToHSV(const double& red, const double& blue, const double& green)
 {
 	assert(red >= 0.0 && red <= 1.0);
 	assert(blue >= 0.0 && blue <= 1.0);
@@ -419,7 +2240,7 @@ Photomosaic::SquareInfo Photomosaic::RGBToHSV(const double& red, const double& b
 	return si;
 }
 
-Photomosaic::SquareInfo Photomosaic::ComputeAverageColor(const std::vector<SquareInfo>& colors)
+SquareInfo Photomosaic::ComputeAverageColor(const std::vector<SquareInfo>& colors)
 {
 	double hueX(0.0);
 	double hueY(0.0);
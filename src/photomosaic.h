@@ -16,7 +16,29 @@
 
 // Local headers
 #include "photomosaicConfig.h"
-#include "threadPool.h"
+#include "executor.h"
+#include "colorInfo.h"
+#include "libraryIndex.h"
+#include "thumbnailAtlas.h"
+#include "vpTree.h"
+#include "topKSelector.h"
+#include "scoringKernel.h"
+#include "scoreCascade.h"
+#include "quantizedFeatures.h"
+#include "euclideanScoring.h"
+#include "colorStatistics.h"
+#include "targetAnalysis.h"
+#include "bandedImageWriter.h"
+#include "auctionAssignment.h"
+#include "repeatOptimizer.h"
+#include "performanceReport.h"
+#include "pipeline.h"
+#include "jpegDecoder.h"
+#include "thumbnailScaler.h"
+#include "libraryWatcher.h"
+#include "mosaicServer.h"
+#include "quadtreeLayout.h"
+#include "perceptualHash.h"
 
 // wxWidgets headers
 #include <wx/image.h>
@@ -24,6 +46,9 @@
 // Standard C++ headers
 #include <vector>
 #include <filesystem>
+#include <mutex>
+#include <functional>
+#include <memory>
 
 #ifdef _WIN32
 namespace stdfs = std::experimental::filesystem;
@@ -34,47 +59,142 @@ namespace stdfs = std::filesystem;
 class Photomosaic
 {
 public:
-	Photomosaic(const PhotomosaicConfig& config) : config(config) {}
+	Photomosaic(const PhotomosaicConfig& config) : config(config), euclideanFeatures(MakeEuclideanFeatures(config)),
+		atlas(std::make_shared<ThumbnailAtlas>()), report(std::make_shared<PerformanceReport>(config.reportSlowDecodeCount)) {}
 	wxImage Build();
+	bool BuildToFile(const std::string& fileName);// Bounded-memory alternative to Build() followed by wxImage::SaveFile()
+	bool Watch(const std::string& outputFileName);// Rewrites the output whenever the library changes; returns only on error
+
+	// Library settings come from this object's configuration; targets, outputs, tile sizes and weights from each target
+	bool BuildBatch(const std::vector<PhotomosaicConfig>& targets);
+	bool Serve(const std::string& socketPath);// See MosaicServer for the protocol; returns only on error
+
+	PerformanceReport& GetReport() { return *report; }
 
 private:
+	friend class PhotomosaicBenchmark;
+
+	// Shares the atlas and report of the instance which ingested the library (see BuildBatch())
+	Photomosaic(const PhotomosaicConfig& config, const Photomosaic& library) : config(config), euclideanFeatures(MakeEuclideanFeatures(config)),
+		atlas(library.atlas), report(library.report) {}
+
 	const PhotomosaicConfig config;
-	
-	struct SquareInfo
+	const EuclideanFeatures euclideanFeatures;// Unused when scoring in HSV
+	std::shared_ptr<ThumbnailAtlas> atlas;
+	std::vector<LibraryIndex::Entry> rejectedEntries;// Files that aren't images, remembered so the index can skip them next time
+	std::vector<LibraryIndex::Entry> duplicateEntries;// Near-duplicates dropped from the library, remembered for the same reason
+	std::shared_ptr<PerformanceReport> report;// Instrumentation only, so const methods may update it
+
+	// Set by AnalyzeTarget() when ADAPTIVE_LEVELS > 0.  Target information, scores and choices then have a
+	// single column with one entry per tile, and only composition needs to know where each tile is.
+	struct AdaptiveLayout
 	{
-		double hue;
-		double saturation;
-		double value;
-	};
+		unsigned int xCells = 0;
+		unsigned int yCells = 0;
+		std::vector<QuadtreeLayout::Tile> tiles;
+	} adaptiveLayout;
 	
-	typedef std::vector<std::vector<SquareInfo>> InfoGrid;
 	typedef std::vector<std::vector<InfoGrid>> TargetInfo;
 	
+	static TargetInfo GetTargetInfo(const wxImage& targetImage, const unsigned int& subDivisionSize, const unsigned int& subSamples);
+	TargetInfo GetAdaptiveTargetInfo(const wxImage& targetImage);
 	static InfoGrid GetColorInformation(const wxImage& image, const unsigned int& subSamples);
+	static InfoGrid GetColorInformationReference(const wxImage& image, const unsigned int& subSamples);
 	
 	struct ImageInfo
 	{
-		wxImage image;
+		wxImage image;// Empty when pixels are in the atlas, or when info came from the library index (see LoadChosenThumbnails())
 		InfoGrid info;
+		LibraryIndex::Key source;
+		unsigned int atlasSlot = ThumbnailAtlas::noSlot;
+		uint64_t perceptualHash = 0;
 	};
 
-	std::vector<ImageInfo> GetThumbnailInfo() const;
+	bool SelectTiles(std::vector<std::vector<unsigned int>>& chosenTiles, std::vector<ImageInfo>& thumbnailInfo);
+	bool PrepareResidentLibrary(std::vector<ImageInfo>& thumbnailInfo);
+	bool BuildFromLibrary(const std::vector<ImageInfo>& thumbnailInfo);
+	void HandleRequest(const MosaicServer::Request& request, const std::vector<ImageInfo>& thumbnailInfo, MosaicServer::Response& response) const;
+	bool LoadTargetInfo(TargetInfo& targetInfo);
+	bool AnalyzeTarget(const wxImage& targetImage, TargetInfo& targetInfo);
+	bool LibraryIsLargeEnough(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo) const;
+	bool WriteOutputImage(const std::vector<std::vector<unsigned int>>& chosenTiles,
+		const std::vector<ImageInfo>& thumbnailInfo, const std::string& fileName) const;
+
+	std::vector<ImageInfo> GetThumbnailInfo();
+	void WriteLibraryIndex(const std::vector<ImageInfo>& thumbnailInfo) const;
+	void RemoveDuplicates(std::vector<ImageInfo>& thumbnailInfo);
+	bool WriteDuplicateReport(const std::vector<ImageInfo>& thumbnailInfo, const std::vector<unsigned int>& representatives) const;
+	void UpdateAtlas(std::vector<ImageInfo>& thumbnailInfo);
+	const unsigned char* GetThumbnailData(const ImageInfo& thumbnail) const;
+	bool LoadChosenThumbnails(const std::vector<std::vector<unsigned int>>& chosenTiles, std::vector<ImageInfo>& thumbnailInfo) const;
+	bool LoadThumbnails(const std::vector<bool>& required, std::vector<ImageInfo>& thumbnailInfo) const;
 
 	struct TileScore
 	{
 		unsigned int thumbnailIndex;
 		double score;
+
+		bool operator<(const TileScore& t) const { return score < t.score; }
 	};
 
 	typedef std::vector<std::vector<std::vector<TileScore>>> ScoreGrid;
 	
 	static ScoreGrid CreateSortedScoreGrid(const std::vector<std::vector<std::vector<double>>>& scores);
-	static std::vector<std::vector<unsigned int>> ChooseTiles(ScoreGrid& scores, const PhotomosaicConfig& config);
-	static void ApplyDistancePenalty(ScoreGrid& scores, const PhotomosaicConfig& config);
-	static wxImage BuildOutputImage(const std::vector<std::vector<unsigned int>>& chosenTiles, const std::vector<ImageInfo>& thumbnailInfo);
+	ScoreGrid FindCandidates(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo) const;
+	ScoreGrid SelectBestScores(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo) const;
+	static void ScoreColumnTopK(const ScoringKernel& kernel, const FeaturePlanes& planes, const std::vector<InfoGrid>& targetColumn,
+		const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates);
+	static void ScoreColumnTopK(const QuantizedKernel& kernel, const QuantizedPlanes& planes, const std::vector<InfoGrid>& targetColumn,
+		const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates);
+	static void ScoreColumnTopK(const EuclideanKernel& kernel, const EuclideanFeatures& features, const EuclideanPlanes& planes,
+		const std::vector<InfoGrid>& targetColumn, const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates);
+
+	// Scores one flattened target against thumbnails [begin, begin + count)
+	typedef std::function<void(const std::vector<float>&, const unsigned int&, const unsigned int&, float*)> BlockScorer;
+	static void ScoreColumnTopK(const BlockScorer& scoreBlock, const unsigned int& thumbnailCount, const std::vector<InfoGrid>& targetColumn,
+		const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates);
+	static void ScoreColumnCascade(const ScoreCascade& cascade, const std::vector<InfoGrid>& targetColumn,
+		const unsigned int& candidateCount, std::vector<std::vector<TileScore>>& candidates, ScoreCascade::Statistics& statistics);
+
+	// Scores a run of consecutive rows from one column
+	typedef std::function<void(const std::vector<InfoGrid>&, std::vector<std::vector<TileScore>>&)> RunScorer;
+	static ScoreGrid ScoreInRuns(const TargetInfo& targetInfo, const RunScorer& scoreRun);
+	std::vector<std::vector<unsigned int>> ScoreAndSelect(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo) const;
+	std::vector<std::vector<unsigned int>> SelectFromCandidates(const ScoreGrid& scores, const TargetInfo& targetInfo,
+		const std::vector<ImageInfo>& thumbnailInfo) const;
+	static std::vector<std::vector<unsigned int>> ChooseTiles(const ScoreGrid& scores, const PhotomosaicConfig& config);
+	// Returns an empty grid if some locations can't be assigned
+	std::vector<std::vector<unsigned int>> ChooseUniqueTiles(const ScoreGrid& scores, const TargetInfo& targetInfo,
+		const std::vector<ImageInfo>& thumbnailInfo) const;
+	ScoreGrid FindUnusedCandidates(const TargetInfo& targetInfo, const std::vector<ImageInfo>& thumbnailInfo, const std::vector<bool>& used,
+		const unsigned int& candidateCount) const;
+	wxImage BuildOutputImage(const std::vector<std::vector<unsigned int>>& chosenTiles, const std::vector<ImageInfo>& thumbnailInfo) const;
+	bool WriteBandedOutputImage(const std::vector<std::vector<unsigned int>>& chosenTiles,
+		const std::vector<ImageInfo>& thumbnailInfo, const std::string& fileName) const;
+
+	// Where the pixels for one cell of the output come from
+	struct CellSource
+	{
+		const unsigned char* data;
+		size_t rowBytes;
+	};
+
+	typedef std::vector<std::vector<CellSource>> CellGrid;
+
+	CellGrid GetCellSources(const std::vector<std::vector<unsigned int>>& chosenTiles, const std::vector<ImageInfo>& thumbnailInfo,
+		std::vector<wxImage>& largeTiles) const;
+	static void CompositeTileRow(const CellGrid& cells, const unsigned int& tileRow, const unsigned int& thumbnailSize, unsigned char* rowData);
 	
 	std::vector<std::vector<double>> ScoreAllThumbnailsOnGrid(const TargetInfo& targetGrid, const InfoGrid& thumbnail) const;
 	double ComputeScore(const InfoGrid& targetSquare, const InfoGrid& thumbnail) const;
+	const EuclideanFeatures& GetEuclideanFeatures() const { return euclideanFeatures; }
+	static EuclideanFeatures MakeEuclideanFeatures(const PhotomosaicConfig& config);
+
+	// In CIELAB or YCbCr, ComputeScore() converts both grids on every call.  Grids which are compared many
+	// times are converted once up front instead, and compared with EuclideanFeatures::GetDistance().
+	typedef std::vector<std::vector<std::vector<float>>> ConvertedTargetInfo;
+	ConvertedTargetInfo ConvertTargetInfo(const TargetInfo& targetGrid) const;
+	static std::vector<std::vector<double>> ScoreAllThumbnailsOnGrid(const ConvertedTargetInfo& targetGrid, const std::vector<float>& thumbnail);
 	
 	enum class CropHint
 	{
@@ -83,70 +203,67 @@ private:
 		Right
 	};
 	
-	static bool ProcessThumbnailDirectoryEntry(const stdfs::directory_entry& entry, const std::string& thumbnailDirectory, const CropHint& cropHint,
-		ImageInfo& info, const unsigned int& thumbnailSize, const unsigned int& subSamples);
+	static bool GetIndexKey(const stdfs::directory_entry& entry, const CropHint& cropHint, LibraryIndex::Key& key);
+	static bool LoadThumbnailImage(const LibraryIndex::Key& source, const std::string& thumbnailDirectory,
+		const unsigned int& thumbnailSize, const ThumbnailScaler::Filter& filter, wxImage& image, bool& isImage);
+	static std::string GetThumbnailPath(const LibraryIndex::Key& source, const std::string& thumbnailDirectory);
+	static bool ReadFile(const std::string& fileName, std::vector<unsigned char>& data);
+	static bool DecodeImage(const std::vector<unsigned char>& data, const unsigned int& minimumSize, wxImage& image);
+	static void CropAndScale(const CropHint& cropHint, const unsigned int& thumbnailSize, const ThumbnailScaler::Filter& filter, wxImage& image);
+	ThumbnailScaler::Filter GetThumbnailFilter() const;
 		
 	static SquareInfo RGBToHSV(const double& red, const double& blue, const double& green);
 	static SquareInfo ComputeAverageColor(const std::vector<SquareInfo>& colors);
 	
-	class ThumbnailProcessJob : public ThreadPool::JobInfoBase
+	struct IngestResults
 	{
-	public:
-		ThumbnailProcessJob(const stdfs::directory_entry& entry, const PhotomosaicConfig& config,
-			const CropHint& cropHint, std::vector<Photomosaic::ImageInfo>& info, std::mutex& mutex) : entry(entry), config(config), cropHint(cropHint), info(info), mutex(mutex) {}
-		
-	protected:
-		const stdfs::directory_entry entry;
-		const PhotomosaicConfig& config;
-		const CropHint cropHint;
-		
-		std::vector<Photomosaic::ImageInfo>& info;
-		std::mutex& mutex;
-			
-		void DoJob() override
-		{
-			ImageInfo tempInfo;
-			if (ProcessThumbnailDirectoryEntry(entry, config.thumbnailDirectory, cropHint, tempInfo, config.thumbnailSize, config.subSamples))
-			{
-				std::lock_guard<std::mutex> lock(mutex);
-				info.push_back(std::move(tempInfo));
-			}
-		}
+		std::vector<ImageInfo> info;
+		std::vector<LibraryIndex::Entry> rejected;
+		unsigned int indexHits = 0;
+		std::mutex mutex;
 	};
-	
-	class TileProcessJob : public ThreadPool::JobInfoBase
+
+	// A library file on its way through the ingest pipeline (see GetThumbnailInfo())
+	struct IngestItem
 	{
-	public:
-		TileProcessJob(const wxImage&& subRect, const unsigned int& subSamples, InfoGrid& targetInfo) : subRect(std::move(subRect)), subSamples(subSamples), targetInfo(targetInfo) {}
-		
-	protected:
-		const wxImage subRect;
-		const unsigned int subSamples;
-		InfoGrid& targetInfo;
-		
-		void DoJob() override
-		{
-			targetInfo = GetColorInformation(subRect, subSamples);
-		}
+		ImageInfo thumbnail;
+		LibraryIndex::LookupResult lookup = LibraryIndex::LookupResult::Missing;
+		bool isImage = true;
+		bool ok = true;// False when the file is an image, but couldn't be processed (already reported)
+		bool fromThumbnailDirectory = false;
+		std::vector<unsigned char> fileData;
+		double processingSeconds = 0.0;// Excluding time spent waiting in queues
 	};
 
-	class ScoringJob : public ThreadPool::JobInfoBase
+	void RunIngestPipeline(const std::function<void(BoundedQueue<IngestItem>&, IngestResults&)>& enumerate, IngestResults& results);
+	void EnumerateLibrary(const LibraryIndex& index, BoundedQueue<IngestItem>& output, IngestResults& results);
+	void EnumerateDirectory(const std::string& directory, const CropHint& cropHint, const LibraryIndex& index,
+		BoundedQueue<IngestItem>& output, IngestResults& results);
+	void AddLibraryEntry(const stdfs::directory_entry& entry, const CropHint& cropHint, const LibraryIndex& index,
+		BoundedQueue<IngestItem>& output, IngestResults& results);
+	bool ReadLibraryFile(IngestItem& item) const;
+	bool DecodeLibraryImage(IngestItem& item) const;
+	bool ScaleLibraryImage(IngestItem& item) const;
+	bool ExtractLibraryFeatures(IngestItem& item) const;
+	void CacheLibraryThumbnail(IngestItem& item);
+	void FinishLibraryEntry(IngestItem& item, IngestResults& results) const;
+
+	// Everything needed to update the mosaic as library files come and go (see Watch())
+	struct LibraryState
 	{
-	public:
-		ScoringJob(const Photomosaic& self, const TargetInfo& targetInfo, const InfoGrid& thumbnail,
-			std::vector<std::vector<double>>& score) : self(self), targetInfo(targetInfo), thumbnail(thumbnail), score(score) {}
-
-	protected:
-		const Photomosaic& self;
-		const TargetInfo& targetInfo;
-		const InfoGrid& thumbnail;
-		std::vector<std::vector<double>>& score;
-
-		void DoJob() override
-		{
-			score = self.ScoreAllThumbnailsOnGrid(targetInfo, thumbnail);
-		}
+		TargetInfo targetInfo;
+		std::vector<ImageInfo> thumbnailInfo;
+		ScoreGrid candidates;// Best candidateCount thumbnails for each location (or fewer, after removals), in order
+		std::vector<std::vector<double>> bounds;// Thumbnails not in a location's candidate list score no better than this
 	};
+
+	void ScanLibrary(LibraryState& library);
+	double GetCandidateBound(const std::vector<TileScore>& candidates) const;
+	bool UpdateOutput(LibraryState& library, const std::string& outputFileName);
+	void ApplyLibraryChanges(const std::vector<LibraryWatcher::Change>& changes, LibraryState& library);
+	void RemoveThumbnails(const std::vector<bool>& removed, LibraryState& library) const;
+	void AddThumbnails(std::vector<ImageInfo>&& addedThumbnails, LibraryState& library) const;
+	void RefillCandidates(LibraryState& library) const;
 };
 
 #endif// PHOTOMOSAIC_H_
@@ -19,6 +19,13 @@
 
 struct PhotomosaicConfig
 {
+	enum class ColorSpace
+	{
+		HSV,
+		Lab,
+		YCbCr
+	};
+
 	std::string centerFocusSourceDirectory;
 	std::string leftFocusSourceDirectory;
 	std::string rightFocusSourceDirectory;
@@ -26,21 +33,52 @@ struct PhotomosaicConfig
 	std::string targetImageFileName;
 	std::string outputFileName;
 	std::string thumbnailDirectory;
+	std::string libraryIndexFileName;
+	std::string thumbnailAtlasFileName;
+	std::string reportFileName;
 	
 	int thumbnailSize = 0;
+	bool fastThumbnails = false;
 	int subDivisionSize = 0;
 	int subSamples = 0;
 	
 	bool recursiveSourceDirectories = false;
 	bool allowMultipleOccurrences = true;
 	bool greyscaleOutput = false;
+
+	bool removeDuplicates = false;
+	unsigned int duplicateHashDistance = 6;// [bits]
+	double duplicateColorThreshold = 0.05;// Mean score per subsample, in the units of the color space (see adaptiveThreshold)
+	std::string duplicateReportFileName;
+
+	bool useSearchIndex = false;
+	unsigned int candidateCount = 0;
+	bool useCascade = false;
+	double cascadeSlack = 0.0;
+	unsigned int quantizedBits = 0;
+
+	unsigned int adaptiveLevels = 0;
+	double adaptiveThreshold = 0.05;// Mean score per subsample:  weighted HSV error for HSV, squared distance for LAB or YCBCR
 	
 	double hueErrorWeight;
 	double saturationErrorWeight;
 	double valueErrorWeight;
+
+	std::string colorSpaceName = "HSV";
+	ColorSpace colorSpace = ColorSpace::HSV;// Set from colorSpaceName when the config file is read
+	double lightnessWeight = 1.0;// Weights for the Euclidean color spaces, which don't use the HSV weights
+	double chromaWeight = 1.0;
+	
+	unsigned int ingestReadThreads = 4;
+	unsigned int outputBandRows = 0;
+	unsigned int reportSlowDecodeCount = 10;
+	unsigned int watchQuietTime = 2000;// [msec]
+	unsigned int batchJobs = 4;
 	
 	unsigned int distancePenaltyCountThreshold;
 	double distancePenaltyScale;
+	unsigned int distancePenaltyRadius;
+	unsigned int distancePenaltyIterations;
 };
 
 #endif// PHOTOMOSAIC_CONFIG_H_
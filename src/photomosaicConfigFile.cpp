@@ -13,6 +13,7 @@
 
 // Local headers
 #include "photomosaicConfigFile.h"
+#include "perceptualHash.h"
 
 void PhotoMosaicConfigFile::BuildConfigItems()
 {
@@ -22,40 +23,92 @@ void PhotoMosaicConfigFile::BuildConfigItems()
 
 	AddConfigItem(_T("TARGET_IMAGE"), config.targetImageFileName);
 	AddConfigItem(_T("OUTPUT_FILE"), config.outputFileName);
+	AddConfigItem(_T("OUTPUT_BAND_ROWS"), config.outputBandRows);
 	AddConfigItem(_T("THUMBNAIL_DIR"), config.thumbnailDirectory);
+	AddConfigItem(_T("LIBRARY_INDEX"), config.libraryIndexFileName);
+	AddConfigItem(_T("THUMBNAIL_ATLAS"), config.thumbnailAtlasFileName);
+	AddConfigItem(_T("INGEST_READ_THREADS"), config.ingestReadThreads);
+	AddConfigItem(_T("REPORT_FILE"), config.reportFileName);
+	AddConfigItem(_T("REPORT_SLOW_DECODES"), config.reportSlowDecodeCount);
+	AddConfigItem(_T("WATCH_QUIET_TIME"), config.watchQuietTime);
+	AddConfigItem(_T("BATCH_JOBS"), config.batchJobs);
 	
 	AddConfigItem(_T("THUMBNAIL_SIZE"), config.thumbnailSize);
+	AddConfigItem(_T("FAST_THUMBNAILS"), config.fastThumbnails);
 	AddConfigItem(_T("SUBDIVISION_SIZE"), config.subDivisionSize);
 	AddConfigItem(_T("SUBSAMPLES"), config.subSamples);
+	AddConfigItem(_T("ADAPTIVE_LEVELS"), config.adaptiveLevels);
+	AddConfigItem(_T("ADAPTIVE_THRESHOLD"), config.adaptiveThreshold);
 	
 	AddConfigItem(_T("RECURSIVE"), config.recursiveSourceDirectories);
 	AddConfigItem(_T("MULTIPLE_USE"), config.allowMultipleOccurrences);
 	AddConfigItem(_T("GREYSCALE"), config.greyscaleOutput);
+
+	AddConfigItem(_T("REMOVE_DUPLICATES"), config.removeDuplicates);
+	AddConfigItem(_T("DUPLICATE_HASH_DISTANCE"), config.duplicateHashDistance);
+	AddConfigItem(_T("DUPLICATE_COLOR_THRESHOLD"), config.duplicateColorThreshold);
+	AddConfigItem(_T("DUPLICATE_REPORT"), config.duplicateReportFileName);
+
+	AddConfigItem(_T("SEARCH_INDEX"), config.useSearchIndex);
+	AddConfigItem(_T("CANDIDATE_COUNT"), config.candidateCount);
+	AddConfigItem(_T("CASCADE"), config.useCascade);
+	AddConfigItem(_T("CASCADE_SLACK"), config.cascadeSlack);
+	AddConfigItem(_T("QUANTIZED_BITS"), config.quantizedBits);
 	
 	AddConfigItem(_T("HUE_WEIGHT"), config.hueErrorWeight);
 	AddConfigItem(_T("SAT_WEIGHT"), config.saturationErrorWeight);
 	AddConfigItem(_T("VAL_WEIGHT"), config.valueErrorWeight);
+	AddConfigItem(_T("COLOR_SPACE"), config.colorSpaceName);
+	AddConfigItem(_T("LIGHTNESS_WEIGHT"), config.lightnessWeight);
+	AddConfigItem(_T("CHROMA_WEIGHT"), config.chromaWeight);
 
 	AddConfigItem(_T("DIST_COUNT_THRESHOLD"), config.distancePenaltyCountThreshold);
 	AddConfigItem(_T("DIST_PENALTY_SCALE"), config.distancePenaltyScale);
+	AddConfigItem(_T("DIST_PENALTY_RADIUS"), config.distancePenaltyRadius);
+	AddConfigItem(_T("DIST_PENALTY_ITERATIONS"), config.distancePenaltyIterations);
 }
 
 void PhotoMosaicConfigFile::AssignDefaults()
 {
+	config.ingestReadThreads = 4;
+	config.outputBandRows = 0;// Build the entire image in memory
+	config.reportSlowDecodeCount = 10;
+	config.watchQuietTime = 2000;// Wait for library changes to stop for 2 sec before updating
+	config.batchJobs = 4;// Mosaics built at once in batch and server modes; each holds its output in memory unless OUTPUT_BAND_ROWS is set
+
 	config.thumbnailSize = 0;
+	config.fastThumbnails = false;// Area-averaged thumbnails
 	config.subDivisionSize = 0;
 	config.subSamples = 0;
+	config.adaptiveLevels = 0;// Every tile is SUBDIVISION_SIZE
+	config.adaptiveThreshold = 0.05;
 	
 	config.recursiveSourceDirectories = false;
 	config.allowMultipleOccurrences = true;
 	config.greyscaleOutput = false;
+
+	config.removeDuplicates = false;
+	config.duplicateHashDistance = 6;// Out of 64 bits
+	config.duplicateColorThreshold = 0.05;// Mean score per subsample, as for ADAPTIVE_THRESHOLD
+	config.duplicateReportFileName.clear();// Only the number of thumbnails dropped is reported
+
+	config.useSearchIndex = false;
+	config.candidateCount = 0;// Keep scores for all thumbnails
+	config.useCascade = false;
+	config.cascadeSlack = 0.0;// Exact; otherwise candidate scores may be up to (1 + slack) times the best possible
+	config.quantizedBits = 0;// Score with single-precision features
 	
 	config.hueErrorWeight = 1.0;
 	config.saturationErrorWeight = 1.0;
 	config.valueErrorWeight = 1.0;
+	config.colorSpaceName = "HSV";// Or LAB or YCBCR, to score by squared Euclidean distance
+	config.lightnessWeight = 1.0;// LAB or YCBCR scores are squared distances, so ADAPTIVE_THRESHOLD and DUPLICATE_COLOR_THRESHOLD
+	config.chromaWeight = 1.0;// are too (a CIELAB difference of 10 is 0.01 per subsample)
 
 	config.distancePenaltyCountThreshold = 2;
 	config.distancePenaltyScale = 0.0;
+	config.distancePenaltyRadius = 8;
+	config.distancePenaltyIterations = 20;
 }
 
 bool PhotoMosaicConfigFile::ConfigIsOK()
@@ -68,19 +121,113 @@ bool PhotoMosaicConfigFile::ConfigIsOK()
 		ok = false;
 	}
 	
+	if (!config.thumbnailAtlasFileName.empty() && config.libraryIndexFileName.empty())
+	{
+		outStream << GetKey(config.thumbnailAtlasFileName) << " requires " << GetKey(config.libraryIndexFileName) << std::endl;
+		ok = false;
+	}
+	
 	ok = IsSpecified(config.targetImageFileName) && ok;
 	ok = IsSpecified(config.outputFileName) && ok;
 	
 	ok = IsStrictlyPositive(config.thumbnailSize) && ok;
 	ok = IsStrictlyPositive(config.subDivisionSize) && ok;
 	ok = IsPositive(config.subSamples) && ok;
+	ok = IsPositive(config.adaptiveThreshold) && ok;
+
+	const unsigned int maxAdaptiveLevels(8);
+	if (config.adaptiveLevels > maxAdaptiveLevels)
+	{
+		outStream << GetKey(config.adaptiveLevels) << " must be at most " << maxAdaptiveLevels << std::endl;
+		ok = false;
+	}
+
+	if (config.adaptiveLevels > 0 && config.distancePenaltyScale > 0.0)
+	{
+		outStream << GetKey(config.distancePenaltyScale) << " is not supported with " << GetKey(config.adaptiveLevels) << std::endl;
+		ok = false;
+	}
+	
+	ok = IsPositive(config.duplicateColorThreshold) && ok;
+	if (config.duplicateHashDistance > HammingIndex::maxSupportedDistance)
+	{
+		outStream << GetKey(config.duplicateHashDistance) << " must be at most " << HammingIndex::maxSupportedDistance << std::endl;
+		ok = false;
+	}
+
+	ok = IsStrictlyPositive(config.ingestReadThreads) && ok;
+	ok = IsStrictlyPositive(config.batchJobs) && ok;
 	
 	ok = IsPositive(config.hueErrorWeight) && ok;
 	ok = IsPositive(config.saturationErrorWeight) && ok;
 	ok = IsPositive(config.valueErrorWeight) && ok;
+	ok = IsPositive(config.lightnessWeight) && ok;
+	ok = IsPositive(config.chromaWeight) && ok;
+
+	if (config.colorSpaceName == "HSV")
+		config.colorSpace = PhotomosaicConfig::ColorSpace::HSV;
+	else if (config.colorSpaceName == "LAB")
+		config.colorSpace = PhotomosaicConfig::ColorSpace::Lab;
+	else if (config.colorSpaceName == "YCBCR")
+		config.colorSpace = PhotomosaicConfig::ColorSpace::YCbCr;
+	else
+	{
+		outStream << GetKey(config.colorSpaceName) << " must be HSV, LAB or YCBCR" << std::endl;
+		ok = false;
+	}
+
+	// Squared distances don't satisfy the triangle inequality, and the other scorers are specific to HSV
+	if (config.colorSpace != PhotomosaicConfig::ColorSpace::HSV && (config.useSearchIndex || config.useCascade || config.quantizedBits > 0))
+	{
+		outStream << GetKey(config.colorSpaceName) << " must be HSV with " << GetKey(config.useSearchIndex) << ", "
+			<< GetKey(config.useCascade) << " or " << GetKey(config.quantizedBits) << std::endl;
+		ok = false;
+	}
+
+	if (config.useSearchIndex)
+		ok = IsStrictlyPositive(config.candidateCount) && ok;
+
+	if (config.useCascade)
+	{
+		ok = IsStrictlyPositive(config.candidateCount) && ok;
+		if (config.useSearchIndex)
+		{
+			outStream << GetKey(config.useCascade) << " and " << GetKey(config.useSearchIndex) << " cannot both be enabled" << std::endl;
+			ok = false;
+		}
+	}
+
+	ok = IsPositive(config.cascadeSlack) && ok;
+
+	if (config.quantizedBits > 0)
+	{
+		ok = IsStrictlyPositive(config.candidateCount) && ok;
+		if (config.quantizedBits != 8 && config.quantizedBits != 16)
+		{
+			outStream << GetKey(config.quantizedBits) << " must be 8 or 16" << std::endl;
+			ok = false;
+		}
+
+		const int maxByteSubSamples(16);// Keeps 8-bit sums within 16 bits (see QuantizedKernel)
+		if (config.quantizedBits == 8 && config.subSamples > maxByteSubSamples)
+		{
+			outStream << GetKey(config.subSamples) << " must be at most " << maxByteSubSamples << " when "
+				<< GetKey(config.quantizedBits) << " is 8" << std::endl;
+			ok = false;
+		}
+
+		if (config.useCascade || config.useSearchIndex)
+		{
+			outStream << GetKey(config.quantizedBits) << " cannot be combined with " << GetKey(config.useCascade)
+				<< " or " << GetKey(config.useSearchIndex) << std::endl;
+			ok = false;
+		}
+	}
 
 	ok = IsPositive(config.distancePenaltyCountThreshold) && ok;
 	ok = IsPositive(config.distancePenaltyScale) && ok;
+	if (config.distancePenaltyScale > 0.0)
+		ok = IsStrictlyPositive(config.distancePenaltyRadius) && ok;
 	
 	return ok;
 }
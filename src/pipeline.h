@@ -0,0 +1,190 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  pipeline.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Bounded queues and thread stages for building streaming pipelines.
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+// Standard C++ headers
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// Multi-producer, multi-consumer FIFO.  Push() blocks while the queue is full, which limits the
+// number of items in flight between two stages and keeps a fast producer from running ahead of a
+// slow consumer.  The queue closes once every registered producer has called ProducerDone().
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(const size_t& capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+	void AddProducers(const unsigned int& count);
+	void ProducerDone();
+
+	void Push(T&& item);
+
+	// Blocks until an item is available; returns false once the queue is closed and empty
+	bool Pop(T& item);
+
+private:
+	const size_t capacity;
+	std::deque<T> items;
+	unsigned int producerCount = 0;
+	bool closed = false;
+
+	std::mutex mutex;
+	std::condition_variable notFull;
+	std::condition_variable notEmpty;
+};
+
+// Registers one producer for the lifetime of the guard, so the queue still closes (and the stages reading
+// from it still finish) if the producer throws
+template<typename T>
+class ProducerGuard
+{
+public:
+	explicit ProducerGuard(BoundedQueue<T>& queue) : queue(queue) { queue.AddProducers(1); }
+	~ProducerGuard() { queue.ProducerDone(); }
+
+	ProducerGuard(const ProducerGuard&) = delete;
+	ProducerGuard& operator=(const ProducerGuard&) = delete;
+
+private:
+	BoundedQueue<T>& queue;
+};
+
+// A fixed number of threads which each take items from an input queue until it closes.  When an
+// output queue is given, items for which body(item) returns true are passed on to it, and the
+// output is closed once all of this stage's threads are finished.
+class PipelineStage
+{
+public:
+	template<typename Input, typename Output, typename Body>
+	PipelineStage(const unsigned int& threadCount, BoundedQueue<Input>& input, BoundedQueue<Output>& output, const Body& body);
+
+	template<typename Input, typename Body>
+	PipelineStage(const unsigned int& threadCount, BoundedQueue<Input>& input, const Body& body);
+
+	~PipelineStage() { Join(); }
+
+	void Join();
+
+private:
+	std::vector<std::thread> threads;
+};
+
+template<typename T>
+void BoundedQueue<T>::AddProducers(const unsigned int& count)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	producerCount += count;
+}
+
+template<typename T>
+void BoundedQueue<T>::ProducerDone()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--producerCount > 0)
+			return;
+		closed = true;
+	}
+
+	notEmpty.notify_all();
+}
+
+template<typename T>
+void BoundedQueue<T>::Push(T&& item)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this]()
+		{
+			return items.size() < capacity;
+		});
+		items.push_back(std::move(item));
+	}
+
+	notEmpty.notify_one();
+}
+
+template<typename T>
+bool BoundedQueue<T>::Pop(T& item)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this]()
+		{
+			return closed || !items.empty();
+		});
+
+		if (items.empty())
+			return false;
+
+		item = std::move(items.front());
+		items.pop_front();
+	}
+
+	notFull.notify_one();
+	return true;
+}
+
+template<typename Input, typename Output, typename Body>
+PipelineStage::PipelineStage(const unsigned int& threadCount, BoundedQueue<Input>& input, BoundedQueue<Output>& output, const Body& body)
+{
+	const unsigned int count(std::max(threadCount, 1U));
+	output.AddProducers(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		threads.push_back(std::thread([&input, &output, body]()
+		{
+			Input item;
+			while (input.Pop(item))
+			{
+				if (body(item))
+					output.Push(std::move(item));
+			}
+
+			output.ProducerDone();
+		}));
+	}
+}
+
+template<typename Input, typename Body>
+PipelineStage::PipelineStage(const unsigned int& threadCount, BoundedQueue<Input>& input, const Body& body)
+{
+	const unsigned int count(std::max(threadCount, 1U));
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		threads.push_back(std::thread([&input, body]()
+		{
+			Input item;
+			while (input.Pop(item))
+				body(item);
+		}));
+	}
+}
+
+inline void PipelineStage::Join()
+{
+	for (auto& t : threads)
+	{
+		if (t.joinable())
+			t.join();
+	}
+}
+
+#endif// PIPELINE_H_
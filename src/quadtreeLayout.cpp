@@ -0,0 +1,43 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  quadtreeLayout.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Covers a grid of cells with square tiles of varying size.
+
+// Local headers
+#include "quadtreeLayout.h"
+
+void QuadtreeLayout::BuildRow(const unsigned int& xCells, const unsigned int& yCells, const unsigned int& levels,
+	const unsigned int& y, const UniformityTest& isUniform, std::vector<Tile>& tiles)
+{
+	const unsigned int rootSize(1U << levels);
+	for (unsigned int x = 0; x < xCells; x += rootSize)
+		Subdivide(Tile{ x, y, rootSize }, xCells, yCells, isUniform, tiles);
+}
+
+void QuadtreeLayout::Subdivide(const Tile& tile, const unsigned int& xCells, const unsigned int& yCells,
+	const UniformityTest& isUniform, std::vector<Tile>& tiles)
+{
+	if (tile.x >= xCells || tile.y >= yCells)
+		return;// Entirely off the grid
+
+	const bool fits(tile.x + tile.size <= xCells && tile.y + tile.size <= yCells);
+	if (tile.size == 1 || (fits && isUniform(tile)))
+	{
+		tiles.push_back(tile);
+		return;
+	}
+
+	const unsigned int half(tile.size / 2);
+	Subdivide(Tile{ tile.x, tile.y, half }, xCells, yCells, isUniform, tiles);
+	Subdivide(Tile{ tile.x + half, tile.y, half }, xCells, yCells, isUniform, tiles);
+	Subdivide(Tile{ tile.x, tile.y + half, half }, xCells, yCells, isUniform, tiles);
+	Subdivide(Tile{ tile.x + half, tile.y + half, half }, xCells, yCells, isUniform, tiles);
+}
@@ -0,0 +1,46 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  quadtreeLayout.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Covers a grid of cells with square tiles of varying size.
+
+#ifndef QUADTREE_LAYOUT_H_
+#define QUADTREE_LAYOUT_H_
+
+// Standard C++ headers
+#include <vector>
+#include <functional>
+
+// The grid is first covered with the largest tiles (2^levels cells on a side, aligned to multiples of
+// their size).  Each tile is split into four while isUniform() returns false for it, or while it extends
+// past the edge of the grid, down to tiles of a single cell.  Tiles are returned in depth-first order.
+class QuadtreeLayout
+{
+public:
+	struct Tile
+	{
+		unsigned int x;// First cell
+		unsigned int y;
+		unsigned int size;// In cells
+	};
+
+	typedef std::function<bool(const Tile&)> UniformityTest;
+
+	// Appends the tiles covering the row of largest tiles that starts at cell row y (a multiple of
+	// 2^levels); calling this for each such row in turn covers the whole grid
+	static void BuildRow(const unsigned int& xCells, const unsigned int& yCells, const unsigned int& levels,
+		const unsigned int& y, const UniformityTest& isUniform, std::vector<Tile>& tiles);
+
+private:
+	static void Subdivide(const Tile& tile, const unsigned int& xCells, const unsigned int& yCells,
+		const UniformityTest& isUniform, std::vector<Tile>& tiles);
+};
+
+#endif// QUADTREE_LAYOUT_H_
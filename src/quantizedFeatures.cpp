@@ -0,0 +1,264 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  quantizedFeatures.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Compact 8- or 16-bit library features and integer scoring kernels.
+
+// Local headers
+#include "quantizedFeatures.h"
+
+// Standard C++ headers
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHOTOMOSAIC_X86
+#include <immintrin.h>
+#endif
+
+// See scoringKernel.cpp
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define TARGET_AVX2
+#endif
+
+QuantizedPlanes::QuantizedPlanes(const unsigned int& bits) : bits(bits), levels(1U << bits)
+{
+	assert(bits == 8 || bits == 16);
+}
+
+void QuantizedPlanes::Build(const std::vector<const InfoGrid*>& thumbnails, const unsigned int& subSamples)
+{
+	count = static_cast<unsigned int>(thumbnails.size());
+	paddedCount = (count + padding - 1) / padding * padding;
+	sampleCount = subSamples * subSamples;
+
+	buffer.assign(GetSizeInBytes() + alignment, 0);
+	offset = (alignment - reinterpret_cast<uintptr_t>(buffer.data()) % alignment) % alignment;
+
+	if (bits == 8)
+		Fill<uint8_t>(thumbnails, subSamples);
+	else
+		Fill<uint16_t>(thumbnails, subSamples);
+}
+
+template<typename T>
+void QuantizedPlanes::Fill(const std::vector<const InfoGrid*>& thumbnails, const unsigned int& subSamples)
+{
+	T* data(reinterpret_cast<T*>(buffer.data() + offset));
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const InfoGrid& grid(*thumbnails[i]);
+		for (unsigned int x = 0; x < subSamples; ++x)
+		{
+			for (unsigned int y = 0; y < subSamples; ++y)
+			{
+				const unsigned int sample(x * subSamples + y);
+				data[(sample * 3) * paddedCount + i] = static_cast<T>(QuantizeHue(grid[x][y].hue));
+				data[(sample * 3 + 1) * paddedCount + i] = static_cast<T>(QuantizeLevel(grid[x][y].saturation));
+				data[(sample * 3 + 2) * paddedCount + i] = static_cast<T>(QuantizeLevel(grid[x][y].value));
+			}
+		}
+	}
+}
+
+std::vector<uint32_t> QuantizedPlanes::Quantize(const std::vector<float>& target) const
+{
+	std::vector<uint32_t> quantized(target.size());
+	for (unsigned int i = 0; i < target.size(); i += 3)
+	{
+		quantized[i] = QuantizeHue(target[i]);
+		quantized[i + 1] = QuantizeLevel(target[i + 1]);
+		quantized[i + 2] = QuantizeLevel(target[i + 2]);
+	}
+
+	return quantized;
+}
+
+// Hues may come from either [0, 1) or [-0.5, 0.5]; only the fraction of a turn matters
+uint32_t QuantizedPlanes::QuantizeHue(const double& hue) const
+{
+	return static_cast<uint32_t>(std::lround((hue - std::floor(hue)) * levels)) & (levels - 1);
+}
+
+uint32_t QuantizedPlanes::QuantizeLevel(const double& level) const
+{
+	return static_cast<uint32_t>(std::lround(std::min(std::max(level, 0.0), 1.0) * (levels - 1)));
+}
+
+namespace
+{
+
+// Negating the wrapped difference in the storage type gives the distance the other way around the circle
+template<typename T>
+void ScoreScalar(const uint32_t* target, const QuantizedPlanes& planes, const unsigned int& begin,
+	const unsigned int& count, const QuantizedKernel::Scales& scales, float* scores)
+{
+	std::fill(scores, scores + count, 0.0f);
+	for (unsigned int s = 0; s < planes.GetSampleCount(); ++s)
+	{
+		const T* hue(planes.GetPlane<T>(s, 0) + begin);
+		const T* saturation(planes.GetPlane<T>(s, 1) + begin);
+		const T* value(planes.GetPlane<T>(s, 2) + begin);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			const T hueDifference(static_cast<T>(target[s * 3] - hue[i]));
+			const T hueError(std::min(hueDifference, static_cast<T>(-hueDifference)));
+			scores[i] += hueError * scales.hue
+				+ std::abs(static_cast<int>(target[s * 3 + 1]) - static_cast<int>(saturation[i])) * scales.saturation
+				+ std::abs(static_cast<int>(target[s * 3 + 2]) - static_cast<int>(value[i])) * scales.value;
+		}
+	}
+}
+
+#ifdef PHOTOMOSAIC_X86
+
+// Weights eight integer sums of each channel
+TARGET_AVX2
+inline __m256 WeightSums(const __m256i& hueSum, const __m256i& saturationSum, const __m256i& valueSum, const QuantizedKernel::Scales& scales)
+{
+	__m256 score(_mm256_mul_ps(_mm256_cvtepi32_ps(hueSum), _mm256_set1_ps(scales.hue)));
+	score = _mm256_fmadd_ps(_mm256_cvtepi32_ps(saturationSum), _mm256_set1_ps(scales.saturation), score);
+	return _mm256_fmadd_ps(_mm256_cvtepi32_ps(valueSum), _mm256_set1_ps(scales.value), score);
+}
+
+TARGET_AVX2
+inline __m256i LowHalf(const __m256i& v)
+{
+	return _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+}
+
+TARGET_AVX2
+inline __m256i HighHalf(const __m256i& v)
+{
+	return _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+}
+
+// Bytes are widened to 16-bit lanes, which hold the sums for up to 257 subsamples
+TARGET_AVX2
+void ScoreAVX2Bytes(const uint32_t* target, const QuantizedPlanes& planes, const unsigned int& begin,
+	const unsigned int& count, const QuantizedKernel::Scales& scales, float* scores)
+{
+	const __m256i byteMask(_mm256_set1_epi16(0xff));
+	const __m256i turn(_mm256_set1_epi16(0x100));
+
+	for (unsigned int i = 0; i < count; i += 16)
+	{
+		__m256i hueSum(_mm256_setzero_si256());
+		__m256i saturationSum(_mm256_setzero_si256());
+		__m256i valueSum(_mm256_setzero_si256());
+		for (unsigned int s = 0; s < planes.GetSampleCount(); ++s)
+		{
+			const __m256i hue(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes.GetPlane<uint8_t>(s, 0) + begin + i))));
+			const __m256i saturation(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes.GetPlane<uint8_t>(s, 1) + begin + i))));
+			const __m256i value(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes.GetPlane<uint8_t>(s, 2) + begin + i))));
+
+			const __m256i hueDifference(_mm256_and_si256(_mm256_sub_epi16(_mm256_set1_epi16(static_cast<short>(target[s * 3])), hue), byteMask));
+			hueSum = _mm256_add_epi16(hueSum, _mm256_min_epi16(hueDifference, _mm256_sub_epi16(turn, hueDifference)));
+			saturationSum = _mm256_add_epi16(saturationSum, _mm256_abs_epi16(_mm256_sub_epi16(_mm256_set1_epi16(static_cast<short>(target[s * 3 + 1])), saturation)));
+			valueSum = _mm256_add_epi16(valueSum, _mm256_abs_epi16(_mm256_sub_epi16(_mm256_set1_epi16(static_cast<short>(target[s * 3 + 2])), value)));
+		}
+
+		_mm256_storeu_ps(scores + i, WeightSums(LowHalf(hueSum), LowHalf(saturationSum), LowHalf(valueSum), scales));
+		_mm256_storeu_ps(scores + i + 8, WeightSums(HighHalf(hueSum), HighHalf(saturationSum), HighHalf(valueSum), scales));
+	}
+}
+
+// 16-bit errors are widened to 32-bit lanes before they are summed
+TARGET_AVX2
+void ScoreAVX2Words(const uint32_t* target, const QuantizedPlanes& planes, const unsigned int& begin,
+	const unsigned int& count, const QuantizedKernel::Scales& scales, float* scores)
+{
+	for (unsigned int i = 0; i < count; i += 16)
+	{
+		__m256i hueLow(_mm256_setzero_si256()), hueHigh(_mm256_setzero_si256());
+		__m256i saturationLow(_mm256_setzero_si256()), saturationHigh(_mm256_setzero_si256());
+		__m256i valueLow(_mm256_setzero_si256()), valueHigh(_mm256_setzero_si256());
+		for (unsigned int s = 0; s < planes.GetSampleCount(); ++s)
+		{
+			const __m256i hue(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes.GetPlane<uint16_t>(s, 0) + begin + i)));
+			const __m256i saturation(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes.GetPlane<uint16_t>(s, 1) + begin + i)));
+			const __m256i value(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes.GetPlane<uint16_t>(s, 2) + begin + i)));
+			const __m256i targetSaturation(_mm256_set1_epi16(static_cast<short>(target[s * 3 + 1])));
+			const __m256i targetValue(_mm256_set1_epi16(static_cast<short>(target[s * 3 + 2])));
+
+			const __m256i hueDifference(_mm256_sub_epi16(_mm256_set1_epi16(static_cast<short>(target[s * 3])), hue));
+			const __m256i hueError(_mm256_min_epu16(hueDifference, _mm256_sub_epi16(_mm256_setzero_si256(), hueDifference)));
+			const __m256i saturationError(_mm256_sub_epi16(_mm256_max_epu16(targetSaturation, saturation), _mm256_min_epu16(targetSaturation, saturation)));
+			const __m256i valueError(_mm256_sub_epi16(_mm256_max_epu16(targetValue, value), _mm256_min_epu16(targetValue, value)));
+
+			hueLow = _mm256_add_epi32(hueLow, LowHalf(hueError));
+			hueHigh = _mm256_add_epi32(hueHigh, HighHalf(hueError));
+			saturationLow = _mm256_add_epi32(saturationLow, LowHalf(saturationError));
+			saturationHigh = _mm256_add_epi32(saturationHigh, HighHalf(saturationError));
+			valueLow = _mm256_add_epi32(valueLow, LowHalf(valueError));
+			valueHigh = _mm256_add_epi32(valueHigh, HighHalf(valueError));
+		}
+
+		_mm256_storeu_ps(scores + i, WeightSums(hueLow, saturationLow, valueLow, scales));
+		_mm256_storeu_ps(scores + i + 8, WeightSums(hueHigh, saturationHigh, valueHigh, scales));
+	}
+}
+
+#endif// PHOTOMOSAIC_X86
+
+}
+
+QuantizedKernel::QuantizedKernel(const double& hueWeight, const double& saturationWeight, const double& valueWeight,
+	const ScoringKernel::InstructionSet& instructionSet) : weights({ static_cast<float>(hueWeight),
+	static_cast<float>(saturationWeight), static_cast<float>(valueWeight) }), instructionSet(GetSupportedInstructionSet(instructionSet))
+{
+}
+
+void QuantizedKernel::Score(const std::vector<float>& target, const QuantizedPlanes& planes,
+	const unsigned int& begin, const unsigned int& count, float* scores) const
+{
+	assert(begin % QuantizedPlanes::padding == 0);
+	assert(target.size() == planes.GetSampleCount() * 3);
+	assert(planes.GetBits() == 16 || planes.GetSampleCount() <= 257);
+
+	const std::vector<uint32_t> quantizedTarget(planes.Quantize(target));
+	const float levels(static_cast<float>(1U << planes.GetBits()));
+	const Scales scales({ weights.hue / levels, weights.saturation / (levels - 1.0f), weights.value / (levels - 1.0f) });
+
+#ifdef PHOTOMOSAIC_X86
+	if (instructionSet == ScoringKernel::InstructionSet::AVX2)
+	{
+		if (planes.GetBits() == 8)
+			ScoreAVX2Bytes(quantizedTarget.data(), planes, begin, count, scales, scores);
+		else
+			ScoreAVX2Words(quantizedTarget.data(), planes, begin, count, scales, scores);
+		return;
+	}
+#endif// PHOTOMOSAIC_X86
+
+	if (planes.GetBits() == 8)
+		ScoreScalar<uint8_t>(quantizedTarget.data(), planes, begin, count, scales, scores);
+	else
+		ScoreScalar<uint16_t>(quantizedTarget.data(), planes, begin, count, scales, scores);
+}
+
+// One quantization step per channel per subsample, plus the single-precision tolerance of ScoringKernel
+double QuantizedKernel::GetTolerance(const QuantizedPlanes& planes) const
+{
+	const double levels(static_cast<double>(1U << planes.GetBits()));
+	const double stepError(weights.hue / levels + (weights.saturation + weights.value) / (levels - 1.0));
+	const double floatError(1.0e-5 * (weights.hue + weights.saturation + weights.value));
+	return (stepError + floatError) * planes.GetSampleCount();
+}
+
+ScoringKernel::InstructionSet QuantizedKernel::GetSupportedInstructionSet(const ScoringKernel::InstructionSet& instructionSet)
+{
+	if (instructionSet == ScoringKernel::InstructionSet::AVX512 || instructionSet == ScoringKernel::InstructionSet::AVX2)
+		return ScoringKernel::InstructionSet::AVX2;
+	return ScoringKernel::InstructionSet::Scalar;
+}
@@ -0,0 +1,104 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  quantizedFeatures.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Compact 8- or 16-bit library features and integer scoring kernels.
+
+#ifndef QUANTIZED_FEATURES_H_
+#define QUANTIZED_FEATURES_H_
+
+// Local headers
+#include "colorInfo.h"
+#include "scoringKernel.h"
+
+// Standard C++ headers
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Library color information in the same layout as FeaturePlanes, but with each channel quantized to
+// 8 or 16 bits, all in one contiguous buffer aligned to a cache line.  Hue is stored as a fraction of a
+// full turn, so the circular hue distance is just integer wraparound; saturation and value are stored
+// as fractions of full scale.
+class QuantizedPlanes
+{
+public:
+	static const unsigned int padding = FeaturePlanes::padding;
+	static const unsigned int alignment = 64;
+
+	explicit QuantizedPlanes(const unsigned int& bits);// 8 or 16
+
+	void Build(const std::vector<const InfoGrid*>& thumbnails, const unsigned int& subSamples);
+
+	unsigned int GetBits() const { return bits; }
+	unsigned int GetCount() const { return count; }
+	unsigned int GetPaddedCount() const { return paddedCount; }
+	unsigned int GetSampleCount() const { return sampleCount; }
+	size_t GetSizeInBytes() const { return static_cast<size_t>(sampleCount) * 3 * paddedCount * (bits / 8); }
+
+	template<typename T>
+	const T* GetPlane(const unsigned int& sample, const unsigned int& channel) const
+	{
+		return reinterpret_cast<const T*>(buffer.data() + offset) + (sample * 3 + channel) * paddedCount;
+	}
+
+	// Quantizes a flattened target (see FeaturePlanes::Flatten()) the same way as the library
+	std::vector<uint32_t> Quantize(const std::vector<float>& target) const;
+
+private:
+	const unsigned int bits;
+	const uint32_t levels;// Number of distinct hues; saturation and value use levels - 1 steps
+	unsigned int count = 0;
+	unsigned int paddedCount = 0;
+	unsigned int sampleCount = 0;
+
+	std::vector<unsigned char> buffer;
+	size_t offset = 0;// From the start of buffer to the first aligned byte
+
+	uint32_t QuantizeHue(const double& hue) const;
+	uint32_t QuantizeLevel(const double& level) const;
+
+	template<typename T>
+	void Fill(const std::vector<const InfoGrid*>& thumbnails, const unsigned int& subSamples);
+};
+
+// Computes the same cost as Photomosaic::ComputeScore() from quantized features.  The per-channel errors
+// are summed as integers, and only weighted (in single precision) once per thumbnail.  Quantization moves
+// each difference by at most one step, so results are within GetTolerance() of the double-precision path.
+class QuantizedKernel
+{
+public:
+	QuantizedKernel(const double& hueWeight, const double& saturationWeight, const double& valueWeight,
+		const ScoringKernel::InstructionSet& instructionSet = ScoringKernel::GetBestSupportedInstructionSet());
+
+	// Same requirements as ScoringKernel::Score().  8-bit planes support at most 257 subsamples.
+	void Score(const std::vector<float>& target, const QuantizedPlanes& planes,
+		const unsigned int& begin, const unsigned int& count, float* scores) const;
+
+	double GetTolerance(const QuantizedPlanes& planes) const;
+
+	// There are no SSE2 or AVX-512 versions; those machines use the scalar and AVX2 kernels, respectively
+	ScoringKernel::InstructionSet GetInstructionSet() const { return instructionSet; }
+
+	struct Scales
+	{
+		float hue;
+		float saturation;
+		float value;
+	};
+
+private:
+	const ScoringKernel::Weights weights;
+	const ScoringKernel::InstructionSet instructionSet;
+
+	static ScoringKernel::InstructionSet GetSupportedInstructionSet(const ScoringKernel::InstructionSet& instructionSet);
+};
+
+#endif// QUANTIZED_FEATURES_H_
@@ -0,0 +1,272 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  repeatOptimizer.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Local search for tile choices which discourages nearby repeats of the same thumbnail.
+
+#ifndef REPEAT_OPTIMIZER_H_
+#define REPEAT_OPTIMIZER_H_
+
+// Local headers
+#include "executor.h"
+
+// Standard C++ headers
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+// Chooses one candidate per grid location, minimizing the sum of the candidate scores plus a
+// "repulsive force" penalty between every pair of locations using the same thumbnail.  The penalty
+// for a pair is penaltyScale * refDistance / distance^2, where refDistance is the squared diagonal of
+// the grid.  Only pairs within radius (in tiles) of each other are considered, so each location
+// only needs to look at its own neighborhood on the grid, which serves as the spatial hash.
+//
+// Starting from the best-scoring candidate everywhere, each location is repeatedly moved to the
+// candidate with the lowest score plus penalty, until nothing changes (every move lowers the total,
+// so this converges) or maxIterations sweeps have been made.  Locations are processed in square
+// blocks with side radius; blocks are colored in a 2x2 pattern so that blocks of the same color are
+// far enough apart to be processed in parallel.  The use counts checked against countThreshold are
+// those at the start of each color's pass plus the block's own changes, so results don't depend on
+// the order in which blocks run.
+//
+// ScoreGrid must be indexable as scores[x][y][i], with each candidate list sorted by increasing
+// score and each candidate providing thumbnailIndex and score members.
+template<typename ScoreGrid>
+class RepeatOptimizer
+{
+public:
+	struct Parameters
+	{
+		double penaltyScale;
+		unsigned int countThreshold;// Thumbnails used fewer times than this are not penalized
+		unsigned int radius;
+		unsigned int maxIterations;
+	};
+
+	RepeatOptimizer(const ScoreGrid& scores, const Parameters& parameters);
+
+	std::vector<std::vector<unsigned int>> Optimize();
+
+	unsigned int GetIterationCount() const { return iterationCount; }
+
+private:
+	const ScoreGrid& scores;
+	const Parameters parameters;
+	const unsigned int xCount;
+	const unsigned int yCount;
+	const double refDistance;
+	const unsigned int blockSize;
+
+	std::vector<unsigned int> choice;// Index into each location's candidate list
+	std::vector<unsigned int> useCounts;
+
+	typedef std::vector<std::pair<unsigned int, int>> CountChanges;// (thumbnail, change in use count) made by one block
+	unsigned int iterationCount = 0;
+
+	unsigned int GetThumbnail(const unsigned int& x, const unsigned int& y) const
+	{
+		return scores[x][y][choice[x * yCount + y]].thumbnailIndex;
+	}
+
+	bool ProcessBlocks(const unsigned int& xParity, const unsigned int& yParity);
+	bool ImproveLocation(const unsigned int& x, const unsigned int& y, std::vector<std::pair<unsigned int, double>>& penalties,
+		CountChanges& countChanges);
+	double GetPenalty(const std::vector<std::pair<unsigned int, double>>& penalties,
+		const unsigned int& thumbnail, const bool& isCurrent, const CountChanges& countChanges) const;
+
+	static void AddCountChange(CountChanges& countChanges, const unsigned int& thumbnail, const int& change);
+};
+
+template<typename ScoreGrid>
+RepeatOptimizer<ScoreGrid>::RepeatOptimizer(const ScoreGrid& scores, const Parameters& parameters) : scores(scores),
+	parameters(parameters), xCount(scores.size()), yCount(scores.empty() ? 0 : scores.front().size()),
+	refDistance(static_cast<double>(xCount) * xCount + static_cast<double>(yCount) * yCount),
+	blockSize(std::max(parameters.radius, 1U)), choice(xCount * yCount, 0)
+{
+	unsigned int thumbnailCount(0);
+	for (const auto& column : scores)
+	{
+		for (const auto& candidates : column)
+		{
+			for (const auto& c : candidates)
+				thumbnailCount = std::max(thumbnailCount, c.thumbnailIndex + 1);
+		}
+	}
+
+	useCounts.resize(thumbnailCount, 0);
+	for (unsigned int x = 0; x < xCount; ++x)
+	{
+		for (unsigned int y = 0; y < yCount; ++y)
+			++useCounts[GetThumbnail(x, y)];
+	}
+}
+
+template<typename ScoreGrid>
+std::vector<std::vector<unsigned int>> RepeatOptimizer<ScoreGrid>::Optimize()
+{
+	for (iterationCount = 0; iterationCount < parameters.maxIterations; ++iterationCount)
+	{
+		bool changed(false);
+		for (unsigned int color = 0; color < 4; ++color)
+			changed = ProcessBlocks(color % 2, color / 2) || changed;
+
+		if (!changed)
+			break;
+	}
+
+	std::vector<std::vector<unsigned int>> chosenIndices(xCount, std::vector<unsigned int>(yCount));
+	for (unsigned int x = 0; x < xCount; ++x)
+	{
+		for (unsigned int y = 0; y < yCount; ++y)
+			chosenIndices[x][y] = GetThumbnail(x, y);
+	}
+
+	return chosenIndices;
+}
+
+// Blocks of the same color are separated by at least blockSize + 1 >= radius + 1 tiles, so no
+// location in one block can see a location in another
+template<typename ScoreGrid>
+bool RepeatOptimizer<ScoreGrid>::ProcessBlocks(const unsigned int& xParity, const unsigned int& yParity)
+{
+	const unsigned int xBlocks((xCount + blockSize - 1) / blockSize);
+	const unsigned int yBlocks((yCount + blockSize - 1) / blockSize);
+	std::vector<std::pair<unsigned int, unsigned int>> blocks;
+	for (unsigned int bx = xParity; bx < xBlocks; bx += 2)
+	{
+		for (unsigned int by = yParity; by < yBlocks; by += 2)
+			blocks.push_back(std::make_pair(bx, by));
+	}
+
+	std::atomic<bool> changed(false);
+	std::vector<CountChanges> blockCountChanges(blocks.size());
+	Executor::GetShared().ParallelFor(blocks.size(), [this, &blocks, &changed, &blockCountChanges](const size_t& b)
+	{
+		thread_local std::vector<std::pair<unsigned int, double>> penalties;
+		const unsigned int xEnd(std::min((blocks[b].first + 1) * blockSize, xCount));
+		const unsigned int yEnd(std::min((blocks[b].second + 1) * blockSize, yCount));
+		for (unsigned int x = blocks[b].first * blockSize; x < xEnd; ++x)
+		{
+			for (unsigned int y = blocks[b].second * blockSize; y < yEnd; ++y)
+			{
+				if (ImproveLocation(x, y, penalties, blockCountChanges[b]))
+					changed = true;
+			}
+		}
+	});
+
+	for (const auto& countChanges : blockCountChanges)
+	{
+		for (const auto& c : countChanges)
+			useCounts[c.first] += c.second;
+	}
+
+	return changed;
+}
+
+template<typename ScoreGrid>
+bool RepeatOptimizer<ScoreGrid>::ImproveLocation(const unsigned int& x, const unsigned int& y,
+	std::vector<std::pair<unsigned int, double>>& penalties, CountChanges& countChanges)
+{
+	// Collect the penalty each nearby location would impose on this location if they used the same thumbnail
+	penalties.clear();
+	const int r(static_cast<int>(parameters.radius));
+	for (int dx = -r; dx <= r; ++dx)
+	{
+		const int nx(static_cast<int>(x) + dx);
+		if (nx < 0 || nx >= static_cast<int>(xCount))
+			continue;
+
+		for (int dy = -r; dy <= r; ++dy)
+		{
+			const int ny(static_cast<int>(y) + dy);
+			const int distanceSquared(dx * dx + dy * dy);
+			if (ny < 0 || ny >= static_cast<int>(yCount) || distanceSquared == 0 || distanceSquared > r * r)
+				continue;
+
+			penalties.push_back(std::make_pair(GetThumbnail(nx, ny), parameters.penaltyScale * refDistance / distanceSquared));
+		}
+	}
+
+	const auto& candidates(scores[x][y]);
+	const unsigned int current(choice[x * yCount + y]);
+	unsigned int best(current);
+	double bestCost(candidates[current].score + GetPenalty(penalties, candidates[current].thumbnailIndex, true, countChanges));
+
+	// Penalties are never negative, so once a candidate's score alone is worse than the best total, so is every later candidate's
+	const double tolerance(1.0e-12 * (1.0 + std::abs(bestCost)));
+	for (unsigned int i = 0; i < candidates.size() && candidates[i].score < bestCost - tolerance; ++i)
+	{
+		if (i == current)
+			continue;
+
+		const double cost(candidates[i].score + GetPenalty(penalties, candidates[i].thumbnailIndex, false, countChanges));
+		if (cost < bestCost - tolerance)
+		{
+			best = i;
+			bestCost = cost;
+		}
+	}
+
+	if (best == current)
+		return false;
+
+	AddCountChange(countChanges, candidates[current].thumbnailIndex, -1);
+	AddCountChange(countChanges, candidates[best].thumbnailIndex, 1);
+	choice[x * yCount + y] = best;
+	return true;
+}
+
+template<typename ScoreGrid>
+double RepeatOptimizer<ScoreGrid>::GetPenalty(const std::vector<std::pair<unsigned int, double>>& penalties,
+	const unsigned int& thumbnail, const bool& isCurrent, const CountChanges& countChanges) const
+{
+	if (parameters.countThreshold > 0)
+	{
+		int count(static_cast<int>(useCounts[thumbnail]) + (isCurrent ? 0 : 1));
+		for (const auto& c : countChanges)
+		{
+			if (c.first == thumbnail)
+				count += c.second;
+		}
+
+		if (count < static_cast<int>(parameters.countThreshold))
+			return 0.0;
+	}
+
+	double penalty(0.0);
+	for (const auto& p : penalties)
+	{
+		if (p.first == thumbnail)
+			penalty += p.second;
+	}
+
+	return penalty;
+}
+
+// Blocks only make a few changes, so a short list is faster than a map
+template<typename ScoreGrid>
+void RepeatOptimizer<ScoreGrid>::AddCountChange(CountChanges& countChanges, const unsigned int& thumbnail, const int& change)
+{
+	for (auto& c : countChanges)
+	{
+		if (c.first == thumbnail)
+		{
+			c.second += change;
+			return;
+		}
+	}
+
+	countChanges.push_back(std::make_pair(thumbnail, change));
+}
+
+#endif// REPEAT_OPTIMIZER_H_
@@ -0,0 +1,208 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  scoreCascade.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Coarse-to-fine search for the best-scoring thumbnails, with early exit.
+
+// Local headers
+#include "scoreCascade.h"
+#include "topKSelector.h"
+
+// Standard C++ headers
+#include <limits>
+
+namespace
+{
+const double pi(3.14159265358979323846);
+
+// For hues which may come from different unit intervals
+float WrappedHueDistance(const float& a, const float& b)
+{
+	float hueError(std::fabs(a - b));
+	hueError -= std::floor(hueError);
+	return std::min(hueError, 1.0f - hueError);
+}
+
+}
+
+ScoreCascade::ScoreCascade(const double& hueWeight, const double& saturationWeight, const double& valueWeight, const double& slack)
+	: hueWeight(static_cast<float>(hueWeight)), saturationWeight(static_cast<float>(saturationWeight)),
+	valueWeight(static_cast<float>(valueWeight)), slack(slack), kernel(hueWeight, saturationWeight, valueWeight)
+{
+}
+
+void ScoreCascade::Build(const std::vector<const InfoGrid*>& thumbnails, const unsigned int& subSamples)
+{
+	planes.Build(thumbnails, subSamples);
+	count = planes.GetCount();
+	sampleCount = planes.GetSampleCount();
+
+	// Covers single-precision rounding in both the bounds and the scores (see ScoringKernel)
+	tolerance = 2.0e-5f * (hueWeight + saturationWeight + valueWeight) * sampleCount;
+
+	summaryHues.resize(count);
+	hueSpreads.resize(count);
+	saturationSums.resize(count);
+	valueSums.resize(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const Summary summary(Summarize(FeaturePlanes::Flatten(*thumbnails[i]).data()));
+		summaryHues[i] = summary.hue;
+		hueSpreads[i] = summary.hueSpread;
+		saturationSums[i] = summary.saturationSum;
+		valueSums[i] = summary.valueSum;
+	}
+}
+
+// Like ScoreColumnTopK(), every target is processed against one block of thumbnails at a time so the
+// block stays in cache
+void ScoreCascade::FindBest(const std::vector<std::vector<float>>& targets, const unsigned int& candidateCount,
+	std::vector<std::vector<Candidate>>& best, Statistics& statistics) const
+{
+	// Below this many survivors in a group, scoring them one at a time (with early exit) is cheaper than scoring the whole group
+	const unsigned int denseGroupCount(3);
+	const unsigned int groupSize(FeaturePlanes::padding);
+	const unsigned int blockSize(256 * groupSize);
+	std::vector<float> bounds(blockSize);
+	std::vector<float> scores(blockSize);
+
+	std::vector<Summary> summaries(targets.size());
+	for (unsigned int t = 0; t < targets.size(); ++t)
+		summaries[t] = Summarize(targets[t].data());
+
+	std::vector<TopKSelector<Candidate>> selectors(targets.size(), TopKSelector<Candidate>(candidateCount));
+	std::vector<float> limits(targets.size(), std::numeric_limits<float>::max());
+	for (unsigned int blockBegin = 0; blockBegin < count; blockBegin += blockSize)
+	{
+		const unsigned int blockEnd(std::min(blockBegin + blockSize, count));
+		for (unsigned int t = 0; t < targets.size(); ++t)
+		{
+			TopKSelector<Candidate>& selector(selectors[t]);
+			float& limit(limits[t]);
+			const auto push([&](const unsigned int& i, const float& score)
+			{
+				selector.Push(Candidate{ i, score });
+				if (selector.IsFull())
+					limit = GetLimit(selector.GetWorst().score);
+			});
+
+			// Consecutive dense groups are scored together
+			const auto scoreRun([&](const unsigned int& begin, const unsigned int& end)
+			{
+				if (begin == end)
+					return;
+
+				kernel.Score(targets[t], planes, begin, end - begin, scores.data());
+				for (unsigned int i = begin; i < end; ++i)
+				{
+					if (scores[i - begin] <= limit)
+						push(i, scores[i - begin]);
+				}
+
+				statistics.scored += end - begin;
+				statistics.completed += end - begin;
+			});
+
+			ComputeBounds(summaries[t], blockBegin, blockEnd, bounds.data());
+			unsigned int runBegin(blockBegin);
+			for (unsigned int groupBegin = blockBegin; groupBegin < blockEnd; groupBegin += groupSize)
+			{
+				const unsigned int groupEnd(std::min(groupBegin + groupSize, blockEnd));
+				unsigned int survivorCount(0);
+				for (unsigned int i = groupBegin; i < groupEnd; ++i)
+					survivorCount += bounds[i - blockBegin] <= limit ? 1 : 0;
+
+				if (survivorCount >= denseGroupCount)
+					continue;
+
+				scoreRun(runBegin, groupBegin);
+				runBegin = groupEnd;
+				for (unsigned int i = groupBegin; survivorCount > 0 && i < groupEnd; ++i)
+				{
+					if (bounds[i - blockBegin] > limit)
+						continue;
+
+					++statistics.scored;
+					float score;
+					if (Score(targets[t].data(), i, limit, score))
+					{
+						++statistics.completed;
+						push(i, score);
+					}
+				}
+			}
+
+			scoreRun(runBegin, blockEnd);
+		}
+	}
+
+	best.resize(targets.size());
+	for (unsigned int t = 0; t < targets.size(); ++t)
+		best[t] = selectors[t].TakeSorted();
+	statistics.bounded += static_cast<uint64_t>(count) * targets.size();
+}
+
+// Sum over subsamples of |t - u| is at least |sum of t - sum of u|.  For hue, the triangle inequality
+// on the circle gives d(t, u) >= d(tHue, uHue) - d(t, tHue) - d(u, uHue) for each subsample.
+ScoreCascade::Summary ScoreCascade::Summarize(const float* squareFeatures) const
+{
+	double hueX(0.0), hueY(0.0);
+	Summary summary{ 0.0f, 0.0f, 0.0f, 0.0f };
+	for (unsigned int s = 0; s < sampleCount; ++s)
+	{
+		hueX += std::cos(2.0 * pi * squareFeatures[s * 3]);
+		hueY += std::sin(2.0 * pi * squareFeatures[s * 3]);
+		summary.saturationSum += squareFeatures[s * 3 + 1];
+		summary.valueSum += squareFeatures[s * 3 + 2];
+	}
+
+	// Any representative hue gives a valid bound; the circular mean keeps the spread small.  Summary hues
+	// are only compared with each other, and are all in [-0.5, 0.5].
+	summary.hue = static_cast<float>(std::atan2(hueY, hueX) / 2.0 / pi);
+	for (unsigned int s = 0; s < sampleCount; ++s)
+		summary.hueSpread += WrappedHueDistance(squareFeatures[s * 3], summary.hue);
+
+	return summary;
+}
+
+void ScoreCascade::ComputeBounds(const Summary& target, const unsigned int& begin, const unsigned int& end, float* bounds) const
+{
+	const float samples(static_cast<float>(sampleCount));
+	for (unsigned int i = begin; i < end; ++i)
+	{
+		const float hueBound(std::max(0.0f, samples * HueDistance(target.hue, summaryHues[i]) - target.hueSpread - hueSpreads[i]));
+		bounds[i - begin] = hueBound * hueWeight
+			+ std::fabs(target.saturationSum - saturationSums[i]) * saturationWeight
+			+ std::fabs(target.valueSum - valueSums[i]) * valueWeight;
+	}
+}
+
+// Accumulates in the same order as ScoringKernel's scalar path.  Returns false (with a partial score) as
+// soon as the score exceeds limit.
+bool ScoreCascade::Score(const float* target, const unsigned int& index, const float& limit, float& score) const
+{
+	score = 0.0f;
+	for (unsigned int s = 0; s < sampleCount; ++s)
+	{
+		score += HueDistance(target[s * 3], planes.GetPlane(s, 0)[index]) * hueWeight
+			+ std::fabs(target[s * 3 + 1] - planes.GetPlane(s, 1)[index]) * saturationWeight
+			+ std::fabs(target[s * 3 + 2] - planes.GetPlane(s, 2)[index]) * valueWeight;
+		if (score > limit)
+			return false;
+	}
+
+	return true;
+}
+
+// Anything scoring worse than this can't make the list (or, with slack, can't improve it by more than the slack allows)
+float ScoreCascade::GetLimit(const float& worstScore) const
+{
+	return static_cast<float>(worstScore / (1.0 + slack)) + tolerance;
+}
@@ -0,0 +1,102 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  scoreCascade.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Coarse-to-fine search for the best-scoring thumbnails, with early exit.
+
+#ifndef SCORE_CASCADE_H_
+#define SCORE_CASCADE_H_
+
+// Local headers
+#include "colorInfo.h"
+#include "scoringKernel.h"
+
+// Standard C++ headers
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Finds the best-scoring thumbnails for each target square while computing as few full scores as
+// possible.  Each thumbnail first gets a lower bound on its score from a one-sample summary:  the sums
+// of saturation and value over its subsamples, and a representative hue together with the total
+// circular distance of the subsample hues from it.  Only thumbnails whose bound is no worse than the
+// current K-th best score are scored in full.  Thumbnails are scored in groups of FeaturePlanes::padding:
+// groups with several survivors are scored with the vectorized ScoringKernel, and lone survivors one
+// subsample at a time, stopping as soon as the partial sum is worse (every term is non-negative).
+//
+// With slack = 0 the result is exact, to within ScoringKernel's single-precision tolerance.
+// With slack > 0, thumbnails are rejected once their bound or partial score exceeds K-th best / (1 + slack),
+// so each returned score is at most (1 + slack) times the exact score at the same rank.
+class ScoreCascade
+{
+public:
+	ScoreCascade(const double& hueWeight, const double& saturationWeight, const double& valueWeight, const double& slack);
+
+	void Build(const std::vector<const InfoGrid*>& thumbnails, const unsigned int& subSamples);
+
+	unsigned int GetCount() const { return count; }
+
+	struct Candidate
+	{
+		unsigned int index;
+		float score;
+
+		bool operator<(const Candidate& c) const { return score < c.score; }
+	};
+
+	struct Statistics
+	{
+		uint64_t bounded = 0;// Target/thumbnail pairs considered
+		uint64_t scored = 0;// Pairs which weren't ruled out by their bound
+		uint64_t completed = 0;// Pairs which were scored without stopping early
+	};
+
+	// Targets are flattened as by FeaturePlanes::Flatten()
+	void FindBest(const std::vector<std::vector<float>>& targets, const unsigned int& candidateCount,
+		std::vector<std::vector<Candidate>>& best, Statistics& statistics) const;
+
+private:
+	const float hueWeight;
+	const float saturationWeight;
+	const float valueWeight;
+	const double slack;
+	float tolerance = 0.0f;// Covers rounding in the bounds, so an exact search never rejects a thumbnail it should keep
+
+	const ScoringKernel kernel;
+	FeaturePlanes planes;
+	unsigned int count = 0;
+	unsigned int sampleCount = 0;
+
+	struct Summary
+	{
+		float hue;// Circular mean, in [-0.5, 0.5]
+		float hueSpread;
+		float saturationSum;
+		float valueSum;
+	};
+
+	// One array per member of Summary, so the bounds can be computed for a block of thumbnails at a time
+	std::vector<float> summaryHues;
+	std::vector<float> hueSpreads;
+	std::vector<float> saturationSums;
+	std::vector<float> valueSums;
+
+	Summary Summarize(const float* squareFeatures) const;
+	void ComputeBounds(const Summary& target, const unsigned int& begin, const unsigned int& end, float* bounds) const;
+	bool Score(const float* target, const unsigned int& index, const float& limit, float& score) const;
+	float GetLimit(const float& worstScore) const;
+
+	// Hues being compared always come from the same unit interval ([-0.5, 0.5] from ColorStatistics), so
+	// unlike ScoringKernel there is no need to wrap the difference with floor()
+	static float HueDistance(const float& a, const float& b) { return std::min(std::fabs(a - b), 1.0f - std::fabs(a - b)); }
+};
+
+#endif// SCORE_CASCADE_H_
@@ -0,0 +1,287 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  scoringKernel.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Vectorized scoring of one target square against many thumbnails.
+
+// Local headers
+#include "scoringKernel.h"
+
+// Standard C++ headers
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHOTOMOSAIC_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif// _MSC_VER
+#endif
+
+// GCC and clang require the instruction set to be enabled per-function; MSVC allows any intrinsic anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+void FeaturePlanes::Build(const std::vector<const InfoGrid*>& thumbnails, const unsigned int& subSamples)
+{
+	count = static_cast<unsigned int>(thumbnails.size());
+	paddedCount = (count + padding - 1) / padding * padding;
+	sampleCount = subSamples * subSamples;
+	data.assign(static_cast<size_t>(sampleCount) * 3 * paddedCount, 0.0f);
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const InfoGrid& grid(*thumbnails[i]);
+		for (unsigned int x = 0; x < subSamples; ++x)
+		{
+			for (unsigned int y = 0; y < subSamples; ++y)
+			{
+				const unsigned int sample(x * subSamples + y);
+				data[(sample * 3) * paddedCount + i] = static_cast<float>(grid[x][y].hue);
+				data[(sample * 3 + 1) * paddedCount + i] = static_cast<float>(grid[x][y].saturation);
+				data[(sample * 3 + 2) * paddedCount + i] = static_cast<float>(grid[x][y].value);
+			}
+		}
+	}
+}
+
+std::vector<float> FeaturePlanes::Flatten(const InfoGrid& square)
+{
+	std::vector<float> flat;
+	flat.reserve(square.size() * square.size() * 3);
+	for (const auto& column : square)
+	{
+		for (const auto& s : column)
+		{
+			flat.push_back(static_cast<float>(s.hue));
+			flat.push_back(static_cast<float>(s.saturation));
+			flat.push_back(static_cast<float>(s.value));
+		}
+	}
+
+	return flat;
+}
+
+namespace
+{
+
+// Circular hue distance is computed branch-free as d = |a - b| - floor(|a - b|); min(d, 1 - d),
+// which is equivalent to the fmod()/compare in Photomosaic::ComputeScore().
+void ScoreScalar(const float* target, const FeaturePlanes& planes, const unsigned int& begin,
+	const unsigned int& count, const ScoringKernel::Weights& weights, float* scores)
+{
+	std::fill(scores, scores + count, 0.0f);
+	for (unsigned int s = 0; s < planes.GetSampleCount(); ++s)
+	{
+		const float* hue(planes.GetPlane(s, 0) + begin);
+		const float* saturation(planes.GetPlane(s, 1) + begin);
+		const float* value(planes.GetPlane(s, 2) + begin);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			float hueError(std::fabs(target[s * 3] - hue[i]));
+			hueError -= std::floor(hueError);
+			hueError = std::min(hueError, 1.0f - hueError);
+			scores[i] += hueError * weights.hue
+				+ std::fabs(target[s * 3 + 1] - saturation[i]) * weights.saturation
+				+ std::fabs(target[s * 3 + 2] - value[i]) * weights.value;
+		}
+	}
+}
+
+#ifdef PHOTOMOSAIC_X86
+
+void ScoreSSE2(const float* target, const FeaturePlanes& planes, const unsigned int& begin,
+	const unsigned int& count, const ScoringKernel::Weights& weights, float* scores)
+{
+	const __m128 absMask(_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+	const __m128 one(_mm_set1_ps(1.0f));
+	const __m128 hueWeight(_mm_set1_ps(weights.hue));
+	const __m128 saturationWeight(_mm_set1_ps(weights.saturation));
+	const __m128 valueWeight(_mm_set1_ps(weights.value));
+
+	for (unsigned int i = 0; i < count; i += 4)
+	{
+		__m128 score(_mm_setzero_ps());
+		for (unsigned int s = 0; s < planes.GetSampleCount(); ++s)
+		{
+			// SSE2 has no floor, but the difference is non-negative so truncation is equivalent
+			__m128 hueError(_mm_and_ps(_mm_sub_ps(_mm_set1_ps(target[s * 3]), _mm_loadu_ps(planes.GetPlane(s, 0) + begin + i)), absMask));
+			hueError = _mm_sub_ps(hueError, _mm_cvtepi32_ps(_mm_cvttps_epi32(hueError)));
+			hueError = _mm_min_ps(hueError, _mm_sub_ps(one, hueError));
+			const __m128 saturationError(_mm_and_ps(_mm_sub_ps(_mm_set1_ps(target[s * 3 + 1]), _mm_loadu_ps(planes.GetPlane(s, 1) + begin + i)), absMask));
+			const __m128 valueError(_mm_and_ps(_mm_sub_ps(_mm_set1_ps(target[s * 3 + 2]), _mm_loadu_ps(planes.GetPlane(s, 2) + begin + i)), absMask));
+			score = _mm_add_ps(score, _mm_mul_ps(hueError, hueWeight));
+			score = _mm_add_ps(score, _mm_mul_ps(saturationError, saturationWeight));
+			score = _mm_add_ps(score, _mm_mul_ps(valueError, valueWeight));
+		}
+
+		_mm_storeu_ps(scores + i, score);
+	}
+}
+
+TARGET_AVX2
+void ScoreAVX2(const float* target, const FeaturePlanes& planes, const unsigned int& begin,
+	const unsigned int& count, const ScoringKernel::Weights& weights, float* scores)
+{
+	const __m256 absMask(_mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+	const __m256 one(_mm256_set1_ps(1.0f));
+	const __m256 hueWeight(_mm256_set1_ps(weights.hue));
+	const __m256 saturationWeight(_mm256_set1_ps(weights.saturation));
+	const __m256 valueWeight(_mm256_set1_ps(weights.value));
+
+	for (unsigned int i = 0; i < count; i += 8)
+	{
+		__m256 score(_mm256_setzero_ps());
+		for (unsigned int s = 0; s < planes.GetSampleCount(); ++s)
+		{
+			__m256 hueError(_mm256_and_ps(_mm256_sub_ps(_mm256_set1_ps(target[s * 3]), _mm256_loadu_ps(planes.GetPlane(s, 0) + begin + i)), absMask));
+			hueError = _mm256_sub_ps(hueError, _mm256_floor_ps(hueError));
+			hueError = _mm256_min_ps(hueError, _mm256_sub_ps(one, hueError));
+			const __m256 saturationError(_mm256_and_ps(_mm256_sub_ps(_mm256_set1_ps(target[s * 3 + 1]), _mm256_loadu_ps(planes.GetPlane(s, 1) + begin + i)), absMask));
+			const __m256 valueError(_mm256_and_ps(_mm256_sub_ps(_mm256_set1_ps(target[s * 3 + 2]), _mm256_loadu_ps(planes.GetPlane(s, 2) + begin + i)), absMask));
+			score = _mm256_fmadd_ps(hueError, hueWeight, score);
+			score = _mm256_fmadd_ps(saturationError, saturationWeight, score);
+			score = _mm256_fmadd_ps(valueError, valueWeight, score);
+		}
+
+		_mm256_storeu_ps(scores + i, score);
+	}
+}
+
+TARGET_AVX512
+void ScoreAVX512(const float* target, const FeaturePlanes& planes, const unsigned int& begin,
+	const unsigned int& count, const ScoringKernel::Weights& weights, float* scores)
+{
+	const __m512 one(_mm512_set1_ps(1.0f));
+	const __m512 hueWeight(_mm512_set1_ps(weights.hue));
+	const __m512 saturationWeight(_mm512_set1_ps(weights.saturation));
+	const __m512 valueWeight(_mm512_set1_ps(weights.value));
+
+	for (unsigned int i = 0; i < count; i += 16)
+	{
+		__m512 score(_mm512_setzero_ps());
+		for (unsigned int s = 0; s < planes.GetSampleCount(); ++s)
+		{
+			__m512 hueError(_mm512_abs_ps(_mm512_sub_ps(_mm512_set1_ps(target[s * 3]), _mm512_loadu_ps(planes.GetPlane(s, 0) + begin + i))));
+			hueError = _mm512_sub_ps(hueError, _mm512_roundscale_ps(hueError, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+			hueError = _mm512_min_ps(hueError, _mm512_sub_ps(one, hueError));
+			const __m512 saturationError(_mm512_abs_ps(_mm512_sub_ps(_mm512_set1_ps(target[s * 3 + 1]), _mm512_loadu_ps(planes.GetPlane(s, 1) + begin + i))));
+			const __m512 valueError(_mm512_abs_ps(_mm512_sub_ps(_mm512_set1_ps(target[s * 3 + 2]), _mm512_loadu_ps(planes.GetPlane(s, 2) + begin + i))));
+			score = _mm512_fmadd_ps(hueError, hueWeight, score);
+			score = _mm512_fmadd_ps(saturationError, saturationWeight, score);
+			score = _mm512_fmadd_ps(valueError, valueWeight, score);
+		}
+
+		_mm512_storeu_ps(scores + i, score);
+	}
+}
+
+#endif// PHOTOMOSAIC_X86
+
+}
+
+ScoringKernel::ScoringKernel(const double& hueWeight, const double& saturationWeight, const double& valueWeight,
+	const InstructionSet& instructionSet) : weights({ static_cast<float>(hueWeight), static_cast<float>(saturationWeight),
+	static_cast<float>(valueWeight) }), instructionSet(instructionSet)
+{
+	switch (instructionSet)
+	{
+#ifdef PHOTOMOSAIC_X86
+	case InstructionSet::AVX512:
+		kernel = &ScoreAVX512;
+		break;
+
+	case InstructionSet::AVX2:
+		kernel = &ScoreAVX2;
+		break;
+
+	case InstructionSet::SSE2:
+		kernel = &ScoreSSE2;
+		break;
+#endif// PHOTOMOSAIC_X86
+
+	default:
+		kernel = &ScoreScalar;
+	}
+}
+
+void ScoringKernel::Score(const std::vector<float>& target, const FeaturePlanes& planes,
+	const unsigned int& begin, const unsigned int& count, float* scores) const
+{
+	assert(begin % FeaturePlanes::padding == 0);
+	assert(target.size() == planes.GetSampleCount() * 3);
+	kernel(target.data(), planes, begin, count, weights, scores);
+}
+
+ScoringKernel::InstructionSet ScoringKernel::GetBestSupportedInstructionSet()
+{
+#ifdef PHOTOMOSAIC_X86
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return InstructionSet::AVX512;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return InstructionSet::AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return InstructionSet::SSE2;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf(info[0]);
+	__cpuid(info, 1);
+	const bool hasSSE2((info[3] & (1 << 26)) != 0);
+	const bool hasFMA((info[2] & (1 << 12)) != 0);
+	const bool osSavesYMM((info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6);
+	const bool osSavesZMM(osSavesYMM && (_xgetbv(0) & 0xe6) == 0xe6);
+	bool hasAVX2(false);
+	bool hasAVX512(false);
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		hasAVX2 = (info[1] & (1 << 5)) != 0;
+		hasAVX512 = (info[1] & (1 << 16)) != 0;
+	}
+
+	if (hasAVX512 && osSavesZMM)
+		return InstructionSet::AVX512;
+	if (hasAVX2 && hasFMA && osSavesYMM)
+		return InstructionSet::AVX2;
+	if (hasSSE2)
+		return InstructionSet::SSE2;
+#endif
+#endif// PHOTOMOSAIC_X86
+
+	return InstructionSet::Scalar;
+}
+
+const char* ScoringKernel::GetName(const InstructionSet& instructionSet)
+{
+	switch (instructionSet)
+	{
+	case InstructionSet::AVX512:
+		return "AVX-512";
+
+	case InstructionSet::AVX2:
+		return "AVX2";
+
+	case InstructionSet::SSE2:
+		return "SSE2";
+
+	default:
+		return "scalar";
+	}
+}
@@ -0,0 +1,96 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  scoringKernel.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Vectorized scoring of one target square against many thumbnails.
+
+#ifndef SCORING_KERNEL_H_
+#define SCORING_KERNEL_H_
+
+// Local headers
+#include "colorInfo.h"
+
+// Standard C++ headers
+#include <vector>
+
+// Library color information in structure-of-arrays form:  for each subsample, one contiguous
+// plane each of hue, saturation and value, with one float per thumbnail.  Planes are padded
+// with zeros to a multiple of the widest vector width so kernels never need a remainder loop.
+class FeaturePlanes
+{
+public:
+	static const unsigned int padding = 16;
+
+	void Build(const std::vector<const InfoGrid*>& thumbnails, const unsigned int& subSamples);
+
+	unsigned int GetCount() const { return count; }
+	unsigned int GetPaddedCount() const { return paddedCount; }
+	unsigned int GetSampleCount() const { return sampleCount; }
+
+	const float* GetPlane(const unsigned int& sample, const unsigned int& channel) const
+	{
+		return data.data() + (sample * 3 + channel) * paddedCount;
+	}
+
+	// Flattens a target square to (hue, saturation, value) per subsample, in the same order as the planes
+	static std::vector<float> Flatten(const InfoGrid& square);
+
+private:
+	unsigned int count = 0;
+	unsigned int paddedCount = 0;
+	unsigned int sampleCount = 0;
+	std::vector<float> data;
+};
+
+// Computes the same cost as Photomosaic::ComputeScore(), but in single precision.  Results agree with
+// the double-precision scalar path to within
+//   1e-5 * (hueWeight + saturationWeight + valueWeight) * subSamples * subSamples
+// (the features themselves are rounded to float, and each subsample contributes at most one unit of
+// error per weight in the sum).
+class ScoringKernel
+{
+public:
+	enum class InstructionSet
+	{
+		Scalar,
+		SSE2,
+		AVX2,
+		AVX512
+	};
+
+	ScoringKernel(const double& hueWeight, const double& saturationWeight, const double& valueWeight,
+		const InstructionSet& instructionSet = GetBestSupportedInstructionSet());
+
+	// Scores target against thumbnails [begin, begin + count).  begin must be a multiple of FeaturePlanes::padding
+	// and scores must have room for count rounded up to a multiple of FeaturePlanes::padding.
+	void Score(const std::vector<float>& target, const FeaturePlanes& planes,
+		const unsigned int& begin, const unsigned int& count, float* scores) const;
+
+	static InstructionSet GetBestSupportedInstructionSet();
+	static const char* GetName(const InstructionSet& instructionSet);
+	InstructionSet GetInstructionSet() const { return instructionSet; }
+
+	struct Weights
+	{
+		float hue;
+		float saturation;
+		float value;
+	};
+
+private:
+	const Weights weights;
+	const InstructionSet instructionSet;
+
+	typedef void (*KernelFunction)(const float* target, const FeaturePlanes& planes, const unsigned int& begin,
+		const unsigned int& count, const Weights& weights, float* scores);
+	KernelFunction kernel;
+};
+
+#endif// SCORING_KERNEL_H_
@@ -0,0 +1,112 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  targetAnalysis.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Summed-area tables of target image color statistics, allowing the average
+//        color of any rectangle to be computed in constant time.
+
+// Local headers
+#include "targetAnalysis.h"
+#include "colorStatistics.h"
+#include "executor.h"
+
+// Standard C++ headers
+#include <algorithm>
+
+namespace
+{
+
+// Computes the prefix sums along a row; sums has width + 1 entries of four doubles, the first of which is already zero
+void SumRow(const unsigned char* row, const unsigned int& width, double* sums)
+{
+	for (unsigned int x = 0; x < width; ++x)
+	{
+		const ColorStatistics::PixelStatistics p(ColorStatistics::ComputePixel(row + x * 3));
+		double* previous(sums + x * 4);
+		double* current(previous + 4);
+		current[0] = previous[0] + p.hueX;
+		current[1] = previous[1] + p.hueY;
+		current[2] = previous[2] + p.saturation;
+		current[3] = previous[3] + p.value;
+	}
+}
+
+// Accumulates row sums down a strip of columns
+void SumColumns(double* table, const unsigned int& rowStride, const unsigned int& height, const unsigned int& begin, const unsigned int& end)
+{
+	for (unsigned int y = 1; y <= height; ++y)
+	{
+		const double* previous(table + static_cast<size_t>(y - 1) * rowStride);
+		double* current(table + static_cast<size_t>(y) * rowStride);
+		for (unsigned int i = begin; i < end; ++i)
+			current[i] += previous[i];
+	}
+}
+
+}
+
+void TargetAnalysis::Analyze(const unsigned char* data, const unsigned int& width, const unsigned int& firstRow, const unsigned int& rowCount)
+{
+	this->width = width;
+	this->firstRow = firstRow;
+	table.assign(static_cast<size_t>(width + 1) * (rowCount + 1), Sums{ 0.0, 0.0, 0.0, 0.0 });
+
+	static_assert(sizeof(Sums) == 4 * sizeof(double), "Sums must be four packed doubles");
+	double* rawTable(reinterpret_cast<double*>(table.data()));
+	const unsigned int rowStride((width + 1) * 4);
+
+	// Rows are independent, then strips of columns are independent
+	Executor& executor(Executor::GetShared());
+	const unsigned char* bandData(data + static_cast<size_t>(firstRow) * width * 3);
+	executor.ParallelFor(rowCount, [bandData, width, rawTable, rowStride](const size_t& y)
+	{
+		SumRow(bandData + y * width * 3, width, rawTable + (y + 1) * rowStride);
+	});
+
+	const unsigned int stripWidth(64);
+	executor.ParallelFor((rowStride + stripWidth - 1) / stripWidth, [rawTable, rowStride, rowCount, stripWidth](const size_t& strip)
+	{
+		const unsigned int begin(static_cast<unsigned int>(strip) * stripWidth);
+		SumColumns(rawTable, rowStride, rowCount, begin, std::min(begin + stripWidth, rowStride));
+	});
+}
+
+SquareInfo TargetAnalysis::GetAverage(const unsigned int& x0, const unsigned int& y0, const unsigned int& w, const unsigned int& h) const
+{
+	const Sums& a(At(x0, y0));
+	const Sums& b(At(x0 + w, y0));
+	const Sums& c(At(x0, y0 + h));
+	const Sums& d(At(x0 + w, y0 + h));
+
+	ColorStatistics::Accumulator accumulator;
+	accumulator.hueX = d.hueX - b.hueX - c.hueX + a.hueX;
+	accumulator.hueY = d.hueY - b.hueY - c.hueY + a.hueY;
+	accumulator.saturation = d.saturation - b.saturation - c.saturation + a.saturation;
+	accumulator.value = static_cast<uint64_t>(d.value - b.value - c.value + a.value);
+	accumulator.count = w * h;
+	return accumulator.GetAverage();
+}
+
+void TargetAnalysis::GetInfoGrid(const unsigned int& x0, const unsigned int& y0, const unsigned int& size,
+	const unsigned int& subSamples, InfoGrid& info) const
+{
+	if (info.size() != subSamples)
+		info.resize(subSamples);
+
+	const unsigned int sampleDimension(size / subSamples);
+	for (unsigned int x = 0; x < subSamples; ++x)
+	{
+		if (info[x].size() != subSamples)
+			info[x].resize(subSamples);
+
+		for (unsigned int y = 0; y < subSamples; ++y)
+			info[x][y] = GetAverage(x0 + x * sampleDimension, y0 + y * sampleDimension, sampleDimension, sampleDimension);
+	}
+}
@@ -0,0 +1,59 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  targetAnalysis.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Summed-area tables of target image color statistics, allowing the average
+//        color of any rectangle to be computed in constant time.
+
+#ifndef TARGET_ANALYSIS_H_
+#define TARGET_ANALYSIS_H_
+
+// Local headers
+#include "colorInfo.h"
+
+// Standard C++ headers
+#include <vector>
+#include <cstddef>
+
+class TargetAnalysis
+{
+public:
+	// Data is packed 8-bit RGB with no padding between rows.  Only rows [firstRow, firstRow + rowCount)
+	// are analyzed; the table costs 32 bytes per pixel, so callers should analyze the target a band at a
+	// time rather than all at once.  Coordinates passed to the methods below are still relative to the
+	// whole image, and must lie within the band.
+	void Analyze(const unsigned char* data, const unsigned int& width, const unsigned int& firstRow, const unsigned int& rowCount);
+
+	SquareInfo GetAverage(const unsigned int& x0, const unsigned int& y0, const unsigned int& w, const unsigned int& h) const;
+
+	// Equivalent to ColorStatistics::ComputeInfoGrid() on the original image
+	void GetInfoGrid(const unsigned int& x0, const unsigned int& y0, const unsigned int& size,
+		const unsigned int& subSamples, InfoGrid& info) const;
+
+private:
+	unsigned int width = 0;
+	unsigned int firstRow = 0;
+
+	// Sums over all pixels in the band above and to the left of each point (exclusive), so the table is
+	// (width + 1) x (rowCount + 1).  Stored together so a rectangle lookup touches four cache lines.
+	struct Sums
+	{
+		double hueX;
+		double hueY;
+		double saturation;
+		double value;// Integer valued; exact in a double for any practical image size
+	};
+
+	std::vector<Sums> table;
+
+	const Sums& At(const unsigned int& x, const unsigned int& y) const { return table[static_cast<size_t>(y - firstRow) * (width + 1) + x]; }
+};
+
+#endif// TARGET_ANALYSIS_H_
@@ -0,0 +1,201 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  thumbnailAtlas.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Packed, memory mapped file of fixed-size RGB thumbnails.
+
+// Local headers
+#include "thumbnailAtlas.h"
+
+// Standard C++ headers
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+
+const unsigned int ThumbnailAtlas::noSlot(std::numeric_limits<unsigned int>::max());
+const char ThumbnailAtlas::fileMagic[8] = { 'P', 'M', 'A', 'T', 'L', 'A', 'S', '1' };
+const uint32_t ThumbnailAtlas::fileVersion(1);
+const uint64_t ThumbnailAtlas::dataOffset(4096);// Page aligned so thumbnails can be mapped efficiently
+
+bool ThumbnailAtlas::Open(const std::string& fileName, const unsigned int& thumbnailSize)
+{
+	Close();
+	file.open(fileName, std::ios::binary | std::ios::in | std::ios::out);
+	if (!file.is_open())
+		return false;
+
+	FileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file.good() || memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != fileVersion ||
+		header.thumbnailSize != thumbnailSize || header.dataOffset != dataOffset)
+	{
+		Close();
+		return false;
+	}
+
+	this->fileName = fileName;
+	this->thumbnailSize = thumbnailSize;
+	stride = thumbnailSize * thumbnailSize * 3;
+	id = header.id;
+	count = header.count;
+	if (count > 0)
+	{
+		if (!mapping.Open(fileName) || mapping.GetSize() < dataOffset + stride * count)
+		{
+			std::cerr << "Thumbnail atlas '" << fileName << "' is truncated; ignoring" << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	mappedCount = count;
+	return true;
+}
+
+bool ThumbnailAtlas::Create(const std::string& fileName, const unsigned int& thumbnailSize)
+{
+	Close();
+	file.open(fileName, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to create thumbnail atlas '" << fileName << "'" << std::endl;
+		return false;
+	}
+
+	this->fileName = fileName;
+	this->thumbnailSize = thumbnailSize;
+	stride = thumbnailSize * thumbnailSize * 3;
+	id = GenerateId();
+	count = 0;
+	mappedCount = 0;
+	return WriteHeader();
+}
+
+void ThumbnailAtlas::Close()
+{
+	mapping.Close();
+	if (file.is_open())
+		file.close();
+	file.clear();
+	count = 0;
+	mappedCount = 0;
+	id = 0;
+}
+
+const unsigned char* ThumbnailAtlas::GetThumbnail(const unsigned int& slot) const
+{
+	if (slot >= mappedCount)
+		return nullptr;
+	return mapping.GetData() + dataOffset + stride * slot;
+}
+
+unsigned int ThumbnailAtlas::Append(const unsigned char* rgb)
+{
+	std::lock_guard<std::mutex> lock(fileMutex);
+	file.seekp(dataOffset + stride * count);
+	file.write(reinterpret_cast<const char*>(rgb), stride);
+	if (!file.good())
+	{
+		std::cerr << "Failed to write to thumbnail atlas '" << fileName << "'" << std::endl;
+		file.clear();
+		return noSlot;
+	}
+
+	return count++;
+}
+
+bool ThumbnailAtlas::Commit()
+{
+	if (count == mappedCount)
+		return true;
+
+	// Thumbnail data must be on disk before the header claims it exists
+	file.flush();
+	if (!WriteHeader())
+		return false;
+
+	mapping.Close();
+	if (!mapping.Open(fileName) || mapping.GetSize() < dataOffset + stride * count)
+	{
+		std::cerr << "Failed to map thumbnail atlas '" << fileName << "'" << std::endl;
+		mappedCount = 0;
+		return false;
+	}
+
+	mappedCount = count;
+	return true;
+}
+
+bool ThumbnailAtlas::Compact(const std::vector<unsigned int>& liveSlots)
+{
+	if (!Commit())
+		return false;
+
+	const std::string tempFileName(fileName + ".tmp");
+	ThumbnailAtlas compacted;
+	if (!compacted.Create(tempFileName, thumbnailSize))
+		return false;
+
+	for (const auto& slot : liveSlots)
+	{
+		if (compacted.Append(GetThumbnail(slot)) == noSlot)
+			return false;
+	}
+
+	if (!compacted.Commit())
+		return false;
+	compacted.Close();
+
+	const std::string originalFileName(fileName);
+	Close();
+#ifdef _WIN32
+	std::remove(originalFileName.c_str());// rename() does not replace existing files under MSW
+#endif// _WIN32
+	if (std::rename(tempFileName.c_str(), originalFileName.c_str()) != 0)
+	{
+		std::cerr << "Failed to rename '" << tempFileName << "' to '" << originalFileName << "'" << std::endl;
+		return false;
+	}
+
+	return Open(originalFileName, thumbnailSize);
+}
+
+bool ThumbnailAtlas::WriteHeader()
+{
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, fileMagic, sizeof(fileMagic));
+	header.version = fileVersion;
+	header.thumbnailSize = thumbnailSize;
+	header.count = count;
+	header.id = id;
+	header.dataOffset = dataOffset;
+
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.flush();
+	if (!file.good())
+	{
+		std::cerr << "Failed to write thumbnail atlas header to '" << fileName << "'" << std::endl;
+		file.clear();
+		return false;
+	}
+
+	return true;
+}
+
+uint64_t ThumbnailAtlas::GenerateId()
+{
+	std::random_device device;
+	const uint64_t randomPart((static_cast<uint64_t>(device()) << 32) | device());
+	return randomPart ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
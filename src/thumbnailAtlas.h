@@ -0,0 +1,90 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  thumbnailAtlas.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Packed, memory mapped file of fixed-size RGB thumbnails.
+
+#ifndef THUMBNAIL_ATLAS_H_
+#define THUMBNAIL_ATLAS_H_
+
+// Local headers
+#include "memoryMappedFile.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+#include <limits>
+
+class ThumbnailAtlas
+{
+public:
+	static const unsigned int noSlot;
+
+	// Open() maps an existing atlas (fails if missing or built for a different thumbnail size);
+	// Create() replaces any existing file with an empty atlas
+	bool Open(const std::string& fileName, const unsigned int& thumbnailSize);
+	bool Create(const std::string& fileName, const unsigned int& thumbnailSize);
+	void Close();
+
+	bool IsOpen() const { return file.is_open(); }
+	uint64_t GetId() const { return id; }
+	unsigned int GetCount() const { return count; }
+	size_t GetStride() const { return stride; }
+
+	// Valid only for slots which existed at the last Open() or Commit()
+	const unsigned char* GetThumbnail(const unsigned int& slot) const;
+
+	// Thread-safe; returns the slot index, or noSlot on failure.  Appended thumbnails
+	// become readable via GetThumbnail() after Commit().
+	unsigned int Append(const unsigned char* rgb);
+	bool Commit();
+
+	// Rewrites the atlas to contain only the specified slots (in order), under a new ID
+	bool Compact(const std::vector<unsigned int>& liveSlots);
+
+private:
+	// File layout (native byte order):
+	//   FileHeader, padded to dataOffset
+	//   count x (thumbnailSize * thumbnailSize * 3 bytes, row-major RGB)
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t thumbnailSize;
+		uint32_t count;
+		uint32_t reserved;
+		uint64_t id;
+		uint64_t dataOffset;
+	};
+
+	static const char fileMagic[8];
+	static const uint32_t fileVersion;
+	static const uint64_t dataOffset;
+
+	std::string fileName;
+	unsigned int thumbnailSize = 0;
+	size_t stride = 0;
+	uint64_t id = 0;
+
+	std::mutex fileMutex;
+	std::fstream file;
+	unsigned int count = 0;// Protected by fileMutex while appending
+
+	MemoryMappedFile mapping;
+	unsigned int mappedCount = 0;
+
+	bool WriteHeader();
+	static uint64_t GenerateId();
+};
+
+#endif// THUMBNAIL_ATLAS_H_
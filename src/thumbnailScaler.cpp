@@ -0,0 +1,168 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  thumbnailScaler.cpp
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Single-pass crop and downscale of library images to thumbnails.
+
+// Local headers
+#include "thumbnailScaler.h"
+
+// Standard C++ headers
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHOTOMOSAIC_X86
+#include <immintrin.h>
+#endif
+
+void ThumbnailScaler::CropAndScale(const unsigned char* source, const size_t& rowBytes, const unsigned int& left, const unsigned int& top,
+	const unsigned int& cropSize, const unsigned int& size, const Filter& filter, unsigned char* destination)
+{
+	const unsigned char* corner(source + top * rowBytes + left * 3);
+	if (filter == Filter::Area)
+		ScaleArea(corner, rowBytes, cropSize, size, destination);
+	else
+		ScaleBox(corner, rowBytes, cropSize, size, destination);
+}
+
+// Positions are measured in units of 1 / size source pixels, so thumbnail pixel i spans [i * cropSize, (i + 1) * cropSize)
+// and source pixel j spans [j * size, (j + 1) * size).  The overlaps are then integers, and every sum is exact.
+void ThumbnailScaler::ScaleArea(const unsigned char* source, const size_t& rowBytes, const unsigned int& cropSize,
+	const unsigned int& size, unsigned char* destination)
+{
+	struct Span
+	{
+		unsigned int first;
+		std::vector<unsigned int> weights;
+	};
+
+	std::vector<Span> spans(size);
+	for (unsigned int i = 0; i < size; ++i)
+	{
+		const uint64_t begin(static_cast<uint64_t>(i) * cropSize);
+		const uint64_t end(begin + cropSize);
+		spans[i].first = static_cast<unsigned int>(begin / size);
+		for (uint64_t j = spans[i].first; j * size < end; ++j)
+			spans[i].weights.push_back(static_cast<unsigned int>(std::min(end, (j + 1) * size) - std::max(begin, j * size)));
+	}
+
+	const size_t rowValues(static_cast<size_t>(cropSize) * 3);
+	const double normalization(1.0 / (static_cast<double>(cropSize) * cropSize));
+	std::vector<float> columnSums(rowValues);
+	for (unsigned int y = 0; y < size; ++y)
+	{
+		std::fill(columnSums.begin(), columnSums.end(), 0.0f);
+		for (unsigned int j = 0; j < spans[y].weights.size(); ++j)
+			AddWeightedRow(source + (spans[y].first + j) * rowBytes, rowValues, static_cast<float>(spans[y].weights[j]), columnSums.data());
+
+		unsigned char* output(destination + static_cast<size_t>(y) * size * 3);
+		for (unsigned int x = 0; x < size; ++x)
+		{
+			double sum[3] = { 0.0, 0.0, 0.0 };
+			const float* column(columnSums.data() + static_cast<size_t>(spans[x].first) * 3);
+			for (unsigned int j = 0; j < spans[x].weights.size(); ++j)
+			{
+				for (unsigned int c = 0; c < 3; ++c)
+					sum[c] += static_cast<double>(spans[x].weights[j]) * column[j * 3 + c];
+			}
+
+			for (unsigned int c = 0; c < 3; ++c)
+				output[x * 3 + c] = static_cast<unsigned char>(std::min(255.0, sum[c] * normalization + 0.5));
+		}
+	}
+}
+
+// Thumbnail pixel i averages the block of source pixels starting at floor(i * cropSize / size), with side
+// max(1, floor(cropSize / size)).  Some source pixels between blocks are skipped when the scale isn't an integer.
+void ThumbnailScaler::ScaleBox(const unsigned char* source, const size_t& rowBytes, const unsigned int& cropSize,
+	const unsigned int& size, unsigned char* destination)
+{
+	const unsigned int block(std::max(cropSize / size, 1U));
+	std::vector<unsigned int> starts(size);
+	for (unsigned int i = 0; i < size; ++i)
+		starts[i] = static_cast<unsigned int>(static_cast<uint64_t>(i) * cropSize / size);
+
+	const size_t rowValues(static_cast<size_t>(cropSize) * 3);
+	const unsigned int blockArea(block * block);
+	std::vector<unsigned int> columnSums(rowValues);
+	for (unsigned int y = 0; y < size; ++y)
+	{
+		std::fill(columnSums.begin(), columnSums.end(), 0U);
+		for (unsigned int j = 0; j < block; ++j)
+			AddRow(source + (starts[y] + j) * rowBytes, rowValues, columnSums.data());
+
+		unsigned char* output(destination + static_cast<size_t>(y) * size * 3);
+		for (unsigned int x = 0; x < size; ++x)
+		{
+			unsigned int sum[3] = { 0, 0, 0 };
+			const unsigned int* column(columnSums.data() + static_cast<size_t>(starts[x]) * 3);
+			for (unsigned int j = 0; j < block * 3; j += 3)
+			{
+				sum[0] += column[j];
+				sum[1] += column[j + 1];
+				sum[2] += column[j + 2];
+			}
+
+			for (unsigned int c = 0; c < 3; ++c)
+				output[x * 3 + c] = static_cast<unsigned char>((sum[c] + blockArea / 2) / blockArea);
+		}
+	}
+}
+
+void ThumbnailScaler::AddWeightedRow(const unsigned char* row, const size_t& count, const float& weight, float* sums)
+{
+	size_t i(0);
+#ifdef PHOTOMOSAIC_X86
+	const __m128i zero(_mm_setzero_si128());
+	const __m128 w(_mm_set1_ps(weight));
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+		const __m128i low(_mm_unpacklo_epi8(bytes, zero));
+		const __m128i high(_mm_unpackhi_epi8(bytes, zero));
+		const __m128i words[4] = { _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+			_mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero) };
+		for (unsigned int j = 0; j < 4; ++j)
+		{
+			float* s(sums + i + j * 4);
+			_mm_storeu_ps(s, _mm_add_ps(_mm_loadu_ps(s), _mm_mul_ps(_mm_cvtepi32_ps(words[j]), w)));
+		}
+	}
+#endif// PHOTOMOSAIC_X86
+
+	for (; i < count; ++i)
+		sums[i] += row[i] * weight;
+}
+
+void ThumbnailScaler::AddRow(const unsigned char* row, const size_t& count, unsigned int* sums)
+{
+	size_t i(0);
+#ifdef PHOTOMOSAIC_X86
+	const __m128i zero(_mm_setzero_si128());
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+		const __m128i low(_mm_unpacklo_epi8(bytes, zero));
+		const __m128i high(_mm_unpackhi_epi8(bytes, zero));
+		const __m128i words[4] = { _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+			_mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero) };
+		for (unsigned int j = 0; j < 4; ++j)
+		{
+			__m128i* s(reinterpret_cast<__m128i*>(sums + i + j * 4));
+			_mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), words[j]));
+		}
+	}
+#endif// PHOTOMOSAIC_X86
+
+	for (; i < count; ++i)
+		sums[i] += row[i];
+}
@@ -0,0 +1,48 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  thumbnailScaler.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Single-pass crop and downscale of library images to thumbnails.
+
+#ifndef THUMBNAIL_SCALER_H_
+#define THUMBNAIL_SCALER_H_
+
+// Standard C++ headers
+#include <cstddef>
+
+// Crops a square from an 8-bit RGB image and scales it to the thumbnail size in one pass over the
+// source rows, without making any intermediate images.  Each source row is added into a single row
+// of column sums (the vectorized part), and each completed row of sums is then reduced horizontally
+// to one row of the thumbnail.
+class ThumbnailScaler
+{
+public:
+	enum class Filter
+	{
+		Area,// Exact area average; source pixels straddling a thumbnail pixel boundary are split between them
+		Box// Average of the whole source pixels within each thumbnail pixel; faster, for previews
+	};
+
+	// Scales the cropSize x cropSize square with its top left corner at (left, top) in source, which has
+	// rowBytes bytes per row, to size x size pixels (packed, with no padding between rows) in destination
+	static void CropAndScale(const unsigned char* source, const size_t& rowBytes, const unsigned int& left, const unsigned int& top,
+		const unsigned int& cropSize, const unsigned int& size, const Filter& filter, unsigned char* destination);
+
+private:
+	static void ScaleArea(const unsigned char* source, const size_t& rowBytes, const unsigned int& cropSize,
+		const unsigned int& size, unsigned char* destination);
+	static void ScaleBox(const unsigned char* source, const size_t& rowBytes, const unsigned int& cropSize,
+		const unsigned int& size, unsigned char* destination);
+
+	static void AddWeightedRow(const unsigned char* row, const size_t& count, const float& weight, float* sums);
+	static void AddRow(const unsigned char* row, const size_t& count, unsigned int* sums);
+};
+
+#endif// THUMBNAIL_SCALER_H_
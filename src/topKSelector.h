@@ -0,0 +1,66 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  topKSelector.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Bounded heap which retains the k smallest of a stream of values.
+
+#ifndef TOP_K_SELECTOR_H_
+#define TOP_K_SELECTOR_H_
+
+// Standard C++ headers
+#include <vector>
+#include <algorithm>
+
+template<typename T>
+class TopKSelector
+{
+public:
+	explicit TopKSelector(const unsigned int& k) : k(k) { items.reserve(k); }
+
+	void Push(const T& t);
+
+	bool IsFull() const { return items.size() == k; }
+	const T& GetWorst() const { return items.front(); }
+
+	// Leaves the selector empty
+	std::vector<T> TakeSorted();
+
+private:
+	const unsigned int k;
+	std::vector<T> items;// Max-heap, so the worst retained item is always at the front
+};
+
+template<typename T>
+void TopKSelector<T>::Push(const T& t)
+{
+	if (items.size() < k)
+	{
+		items.push_back(t);
+		std::push_heap(items.begin(), items.end());
+	}
+	else if (k > 0 && t < items.front())
+	{
+		std::pop_heap(items.begin(), items.end());
+		items.back() = t;
+		std::push_heap(items.begin(), items.end());
+	}
+}
+
+template<typename T>
+std::vector<T> TopKSelector<T>::TakeSorted()
+{
+	std::sort_heap(items.begin(), items.end());
+	std::vector<T> sorted;
+	sorted.swap(items);
+	items.reserve(k);
+	return sorted;
+}
+
+#endif// TOP_K_SELECTOR_H_
@@ -0,0 +1,173 @@
+/*===================================================================================
+                                      Photomosaic
+                          Copyright Kerry R. Loux 2009-2020
+
+  This code is licensed under the MIT License (http://opensource.org/licenses/MIT).
+
+===================================================================================*/
+
+// File:  vpTree.h
+// Auth:  K. Loux
+// Date:  10/16/2026
+// Desc:  Vantage-point tree for k-nearest-neighbor searches in arbitrary metric spaces.
+//        Items are identified by index; the tree never sees the items themselves, only
+//        distances between them, so any distance satisfying the triangle inequality
+//        (including ones with circular terms, like hue) can be used without embedding.
+
+#ifndef VP_TREE_H_
+#define VP_TREE_H_
+
+// Standard C++ headers
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <limits>
+
+class VPTree
+{
+public:
+	struct Neighbor
+	{
+		unsigned int index;
+		double distance;
+
+		bool operator<(const Neighbor& n) const { return distance < n.distance; }
+	};
+
+	// ItemDistance is callable as double(unsigned int, unsigned int)
+	template<typename ItemDistance>
+	VPTree(const unsigned int& itemCount, const ItemDistance& distance);
+
+	// QueryDistance is callable as double(unsigned int) and returns the distance from the
+	// query to the specified item.  Results are sorted nearest-first.
+	template<typename QueryDistance>
+	void FindNearest(const unsigned int& k, const QueryDistance& distance, std::vector<Neighbor>& neighbors) const;
+
+	unsigned int GetItemCount() const { return static_cast<unsigned int>(nodes.size()); }
+
+private:
+	static const unsigned int noChild = std::numeric_limits<unsigned int>::max();
+
+	struct Node
+	{
+		unsigned int item;
+		double threshold = 0.0;// Median distance from this node's item to the items in its subtree
+		unsigned int inside = noChild;// Subtree with distances < threshold
+		unsigned int outside = noChild;// Subtree with distances >= threshold
+	};
+
+	std::vector<Node> nodes;
+
+	template<typename ItemDistance>
+	unsigned int Build(std::vector<Neighbor>& items, const unsigned int& begin, const unsigned int& end,
+		const ItemDistance& distance, std::mt19937& generator);
+
+	template<typename QueryDistance>
+	void Search(const unsigned int& node, const unsigned int& k, const QueryDistance& distance,
+		std::priority_queue<Neighbor>& best, double& tau) const;
+};
+
+template<typename ItemDistance>
+VPTree::VPTree(const unsigned int& itemCount, const ItemDistance& distance)
+{
+	std::vector<Neighbor> items(itemCount);
+	for (unsigned int i = 0; i < itemCount; ++i)
+		items[i].index = i;
+
+	nodes.reserve(itemCount);
+	std::mt19937 generator(itemCount);// Fixed seed so results are repeatable
+	Build(items, 0, itemCount, distance, generator);
+}
+
+template<typename ItemDistance>
+unsigned int VPTree::Build(std::vector<Neighbor>& items, const unsigned int& begin, const unsigned int& end,
+	const ItemDistance& distance, std::mt19937& generator)
+{
+	if (begin == end)
+		return noChild;
+
+	const unsigned int nodeIndex(static_cast<unsigned int>(nodes.size()));
+	nodes.push_back(Node());
+
+	// Random vantage points perform about as well as more elaborate selection schemes
+	std::uniform_int_distribution<unsigned int> distribution(begin, end - 1);
+	std::swap(items[begin], items[distribution(generator)]);
+	nodes[nodeIndex].item = items[begin].index;
+
+	if (end - begin == 1)
+		return nodeIndex;
+
+	for (unsigned int i = begin + 1; i < end; ++i)
+		items[i].distance = distance(items[begin].index, items[i].index);
+
+	const unsigned int median((begin + 1 + end) / 2);
+	std::nth_element(items.begin() + begin + 1, items.begin() + median, items.begin() + end);
+	nodes[nodeIndex].threshold = items[median].distance;
+
+	const unsigned int inside(Build(items, begin + 1, median, distance, generator));
+	const unsigned int outside(Build(items, median, end, distance, generator));
+	nodes[nodeIndex].inside = inside;
+	nodes[nodeIndex].outside = outside;
+
+	return nodeIndex;
+}
+
+template<typename QueryDistance>
+void VPTree::FindNearest(const unsigned int& k, const QueryDistance& distance, std::vector<Neighbor>& neighbors) const
+{
+	neighbors.clear();
+	if (nodes.empty() || k == 0)
+		return;
+
+	std::priority_queue<Neighbor> best;// Max-heap, so the worst of the current k is on top
+	double tau(std::numeric_limits<double>::max());
+	Search(0, k, distance, best, tau);
+
+	neighbors.resize(best.size());
+	for (auto it = neighbors.rbegin(); it != neighbors.rend(); ++it)
+	{
+		*it = best.top();
+		best.pop();
+	}
+}
+
+template<typename QueryDistance>
+void VPTree::Search(const unsigned int& nodeIndex, const unsigned int& k, const QueryDistance& distance,
+	std::priority_queue<Neighbor>& best, double& tau) const
+{
+	if (nodeIndex == noChild)
+		return;
+
+	const Node& node(nodes[nodeIndex]);
+	const double d(distance(node.item));
+	if (d < tau)
+	{
+		if (best.size() == k)
+			best.pop();
+		best.push(Neighbor{ node.item, d });
+		if (best.size() == k)
+			tau = best.top().distance;
+	}
+
+	// Descend into the more promising side first so tau shrinks as early as possible.  By the
+	// triangle inequality, a subtree can only contain neighbors closer than tau if the query's
+	// tau-ball crosses the threshold sphere.
+	if (d < node.threshold)
+	{
+		if (d - tau < node.threshold)
+			Search(node.inside, k, distance, best, tau);
+		if (d + tau >= node.threshold)
+			Search(node.outside, k, distance, best, tau);
+	}
+	else
+	{
+		if (d + tau >= node.threshold)
+			Search(node.outside, k, distance, best, tau);
+		if (d - tau < node.threshold)
+			Search(node.inside, k, distance, best, tau);
+	}
+}
+
+#endif// VP_TREE_H_